@@ -1,6 +1,19 @@
+#include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <time.h>
 #include <hb/stadium.h>
+#include <hb/hash.h>
+#include <hb/cache.h>
+#include <hb/diff.h>
+#include <hb/builder.h>
+#include <hb/cast.h>
+#include <hb/geometry.h>
+#include <hb/joints.h>
+#include <hb/optimize.h>
+#include <hb/sdf.h>
+#include <hb/tessellation.h>
+#include <hb/world.h>
 
 #define benchmark(fn) \
 do { \
@@ -27,11 +40,349 @@ static void
 parse_fish_hunt_stadium(void) {
 	parse_stadium_and_free("stadiums/fish_hunt.json"); }
 
+static void
+stadium_to_json_100_times(const char *p)
+{
+	struct hb_stadium *s;
+	int i;
+	s = hb_stadium_from_file(p);
+	for (i = 0; i < 100; ++i)
+		free(hb_stadium_to_json(s));
+	hb_stadium_free(s);
+}
+
+static void
+big_stadium_to_json_100_times(void) {
+	stadium_to_json_100_times("stadiums/big.json"); }
+
+static void
+fish_hunt_stadium_to_json_100_times(void) {
+	stadium_to_json_100_times("stadiums/fish_hunt.json"); }
+
+static void
+hash_fish_hunt_stadium_1000_times(void)
+{
+	struct hb_stadium *s;
+	int i;
+	s = hb_stadium_from_file("stadiums/fish_hunt.json");
+	for (i = 0; i < 1000; ++i)
+		hb_stadium_hash(s);
+	hb_stadium_free(s);
+}
+
+static void
+cache_hit_1000000_times(void)
+{
+	struct hb_stadium_cache *cache;
+	struct hb_hash128 key;
+	const struct hb_stadium *s;
+	int i;
+	cache = hb_stadium_cache_create(1 << 20);
+	s = hb_stadium_cache_insert(cache, hb_stadium_from_file("stadiums/futsal.json"));
+	key = hb_stadium_hash(s);
+	for (i = 0; i < 1000000; ++i)
+		hb_stadium_cache_release(cache, hb_stadium_cache_lookup(cache, key));
+	hb_stadium_cache_release(cache, s);
+	hb_stadium_cache_free(cache);
+}
+
+static void
+diff_and_patch_one_vertex_1000_times(void)
+{
+	struct hb_stadium *a, *b;
+	struct hb_stadium_delta *delta;
+	int i;
+	a = hb_stadium_from_file("stadiums/fish_hunt.json");
+	b = hb_stadium_from_file("stadiums/fish_hunt.json");
+	for (i = 0; i < 1000; ++i) {
+		b->vertexes[i % 100]->x += 1;
+		delta = hb_stadium_diff(a, b);
+		hb_stadium_patch(a, delta);
+		hb_stadium_delta_free(delta);
+	}
+	hb_stadium_free(a);
+	hb_stadium_free(b);
+}
+
+static void
+clone_fish_hunt_stadium_10000_times(void)
+{
+	struct hb_stadium *s;
+	int i;
+	s = hb_stadium_from_file("stadiums/fish_hunt.json");
+	for (i = 0; i < 10000; ++i)
+		hb_stadium_free(hb_stadium_clone(s, HB_STADIUM_SECTION_JOINTS));
+	hb_stadium_free(s);
+}
+
+static void
+build_100000_segment_stadium(void)
+{
+	struct hb_stadium_builder *b;
+	struct hb_vertex v = { .b_coef = 1, .c_mask = HB_COLLISION_ALL };
+	struct hb_segment seg = { .b_coef = 1, .vis = true };
+	int i;
+	b = hb_stadium_builder_create();
+	for (i = 0; i <= 100000; ++i) {
+		v.x = i;
+		v.y = i & 1;
+		hb_stadium_builder_add_vertex(b, &v);
+	}
+	for (i = 0; i < 100000; ++i) {
+		seg.v0 = i;
+		seg.v1 = i + 1;
+		hb_stadium_builder_add_segment(b, &seg);
+	}
+	hb_stadium_free(hb_stadium_builder_finalize(b));
+	hb_stadium_builder_free(b);
+}
+
+static void
+compile_big_stadium_1000_times(void)
+{
+	struct hb_stadium *s;
+	int i;
+	s = hb_stadium_from_file("stadiums/big.json");
+	for (i = 0; i < 1000; ++i)
+		hb_geometry_free(hb_stadium_compile(s));
+	hb_stadium_free(s);
+}
+
+static void
+optimize_chairs_stadium_1000_times(void)
+{
+	struct hb_stadium *s, *c;
+	int i;
+	s = hb_stadium_from_file("stadiums/chairs.json");
+	for (i = 0; i < 1000; ++i) {
+		c = hb_stadium_clone(s, 0);
+		hb_stadium_optimize(c, HB_OPTIMIZE_ALL, NULL);
+		hb_stadium_free(c);
+	}
+	hb_stadium_free(s);
+}
+
+static void
+mirror_big_stadium_1000_times(void)
+{
+	struct hb_stadium *s;
+	const double mirror[6] = { -1, 0, 0, 0, 1, 0 };
+	int i;
+	s = hb_stadium_from_file("stadiums/big.json");
+	for (i = 0; i < 1000; ++i)
+		hb_stadium_transform(s, mirror);
+	hb_stadium_free(s);
+}
+
+static void
+tessellate_big_stadium_1000_times(void)
+{
+	struct hb_stadium *s;
+	int i;
+	s = hb_stadium_from_file("stadiums/big.json");
+	for (i = 0; i < 1000; ++i) {
+		hb_stadium_invalidate(s);
+		hb_stadium_tessellate(s, 0.5);
+	}
+	hb_stadium_free(s);
+}
+
+static void
+step_world(const char *path, int steps)
+{
+	struct hb_stadium *s;
+	struct hb_world *w;
+	unsigned inputs[8];
+	int i, p;
+	s = hb_stadium_from_file(path);
+	w = hb_world_create(s);
+	hb_stadium_free(s);
+	for (p = 0; p < 8; ++p)
+		hb_world_add_player(w, p & 1 ? HB_TEAM_BLUE : HB_TEAM_RED,
+				p & 1 ? 200 : -200, (p / 2) * 40 - 60);
+	for (i = 0; i < steps; ++i) {
+		for (p = 0; p < 8; ++p)
+			inputs[p] = (i / 60 + p * 7) % 32;
+		hb_world_step(w, inputs);
+	}
+	hb_world_free(w);
+}
+
+static void
+step_futsal_world_100000_times(void) {
+	step_world("stadiums/futsal.json", 100000); }
+
+static void
+step_fish_hunt_world_10000_times(void) {
+	step_world("stadiums/fish_hunt.json", 10000); }
+
+static void
+step_crowded_world_10000_times(void)
+{
+	struct hb_stadium *s;
+	struct hb_world *w;
+	unsigned inputs[64];
+	int i, p;
+	s = hb_stadium_from_file("stadiums/futsal.json");
+	w = hb_world_create(s);
+	hb_stadium_free(s);
+	for (p = 0; p < 64; ++p)
+		hb_world_add_player(w, p & 1 ? HB_TEAM_BLUE : HB_TEAM_RED,
+				(p % 16) * 40 - 300, (p / 16) * 40 - 60);
+	for (i = 0; i < 10000; ++i) {
+		for (p = 0; p < 64; ++p)
+			inputs[p] = (i / 60 + p * 7) % 32;
+		hb_world_step(w, inputs);
+	}
+	hb_world_free(w);
+}
+
+static void
+step_fish_hunt_world_no_grid_1000_times(void)
+{
+	struct hb_stadium *s;
+	struct hb_world *w;
+	unsigned inputs[8];
+	int i, p;
+	s = hb_stadium_from_file("stadiums/fish_hunt.json");
+	w = hb_world_create(s);
+	hb_stadium_free(s);
+	/* every wall goes through the narrowphase in full batches */
+	hb_static_grid_free(w->grid);
+	w->grid = NULL;
+	for (p = 0; p < 8; ++p)
+		hb_world_add_player(w, p & 1 ? HB_TEAM_BLUE : HB_TEAM_RED,
+				p & 1 ? 200 : -200, (p / 2) * 40 - 60);
+	for (i = 0; i < 1000; ++i) {
+		for (p = 0; p < 8; ++p)
+			inputs[p] = (i / 60 + p * 7) % 32;
+		hb_world_step(w, inputs);
+	}
+	hb_world_free(w);
+}
+
+/* a 32 by 32 net of discs tied to their right and lower neighbours,
+   sagging a little more every pass */
+static void
+solve_net_joints_10000_times(void)
+{
+	struct hb_stadium_builder *b;
+	struct hb_stadium *s;
+	struct hb_joints *j;
+	struct hb_disc d = { .radius = 5, .inv_mass = 1 };
+	struct hb_joint joint = { .length = { .kind = HB_JOINT_LENGTH_RANGE,
+		.val.range = { 18, 22 } }, .strength = { .is_rigid = true } };
+	double x[1024], y[1024], sx[1024], sy[1024], m[1024];
+	int i, k;
+	b = hb_stadium_builder_create();
+	for (k = 0; k < 1024; ++k) {
+		d.pos[0] = x[k] = (k % 32) * 20;
+		d.pos[1] = y[k] = (k / 32) * 20;
+		sx[k] = sy[k] = 0;
+		m[k] = k < 32 ? 0 : 1;
+		hb_stadium_builder_add_disc(b, &d);
+		joint.d0 = k;
+		/* every other joint pulls instead of holding */
+		joint.strength.is_rigid = k & 1;
+		joint.strength.val = 0.1;
+		if (k % 32 < 31) {
+			joint.d1 = k + 1;
+			hb_stadium_builder_add_joint(b, &joint);
+		}
+		if (k < 1024 - 32) {
+			joint.d1 = k + 32;
+			hb_stadium_builder_add_joint(b, &joint);
+		}
+	}
+	s = hb_stadium_builder_finalize(b);
+	hb_stadium_builder_free(b);
+	j = hb_joints_build(s, x, y, 1024);
+	hb_stadium_free(s);
+	for (i = 0; i < 10000; ++i) {
+		for (k = 32; k < 1024; ++k)
+			sy[k] += 0.01;
+		hb_joints_solve(j, x, y, sx, sy, m);
+	}
+	hb_joints_free(j);
+}
+
+static void
+predict_ball_120_ticks_10000_times(void)
+{
+	struct hb_stadium *s;
+	struct hb_world *w;
+	double positions[2 * 120];
+	int i;
+	s = hb_stadium_from_file("stadiums/fish_hunt.json");
+	w = hb_world_create(s);
+	hb_stadium_free(s);
+	for (i = 0; i < 10000; ++i) {
+		w->speed_x[0] = (i % 100) * 0.3 - 15;
+		w->speed_y[0] = (i / 100) * 0.3 - 15;
+		hb_world_predict_disc(w, 0, 120, positions);
+	}
+	hb_world_free(w);
+}
+
+static void
+build_fish_hunt_sdf_10_times(void)
+{
+	struct hb_stadium *s;
+	int i;
+	s = hb_stadium_from_file("stadiums/fish_hunt.json");
+	for (i = 0; i < 10; ++i)
+		hb_sdf_free(hb_stadium_build_sdf(s, 5, HB_COLLISION_BALL));
+	hb_stadium_free(s);
+}
+
+/* fans of 64 rays of 400 units from points across the stadium */
+static void
+raycast_fish_hunt_100000_rays(void)
+{
+	struct hb_stadium *s;
+	struct hb_cast_index *index;
+	struct hb_ray rays[64];
+	struct hb_cast_hit hits[64];
+	int i, j;
+	s = hb_stadium_from_file("stadiums/fish_hunt.json");
+	index = hb_cast_index_build(s, 40);
+	hb_stadium_free(s);
+	for (i = 0; i < 1563; ++i) {
+		for (j = 0; j < 64; ++j) {
+			rays[j].x = (i % 40) * 40 - 800;
+			rays[j].y = (i / 40 % 20) * 40 - 400;
+			rays[j].dx = cos(j * 0.0982) * 400;
+			rays[j].dy = sin(j * 0.0982) * 400;
+		}
+		hb_raycast_batch(index, rays, 64, HB_COLLISION_BALL, hits);
+	}
+	hb_cast_index_free(index);
+}
+
 int
 main(void)
 {
 	printf("\n");
 	benchmark(parse_big_stadium);
 	benchmark(parse_fish_hunt_stadium);
+	benchmark(big_stadium_to_json_100_times);
+	benchmark(fish_hunt_stadium_to_json_100_times);
+	benchmark(hash_fish_hunt_stadium_1000_times);
+	benchmark(cache_hit_1000000_times);
+	benchmark(diff_and_patch_one_vertex_1000_times);
+	benchmark(clone_fish_hunt_stadium_10000_times);
+	benchmark(build_100000_segment_stadium);
+	benchmark(compile_big_stadium_1000_times);
+	benchmark(optimize_chairs_stadium_1000_times);
+	benchmark(mirror_big_stadium_1000_times);
+	benchmark(tessellate_big_stadium_1000_times);
+	benchmark(step_futsal_world_100000_times);
+	benchmark(step_fish_hunt_world_10000_times);
+	benchmark(step_crowded_world_10000_times);
+	benchmark(step_fish_hunt_world_no_grid_1000_times);
+	benchmark(solve_net_joints_10000_times);
+	benchmark(predict_ball_120_ticks_10000_times);
+	benchmark(build_fish_hunt_sdf_10_times);
+	benchmark(raycast_fish_hunt_100000_rays);
 	return 0;
 }
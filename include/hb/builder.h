@@ -0,0 +1,112 @@
+#ifndef __LIBHB_BUILDER_H__
+#define __LIBHB_BUILDER_H__
+
+#include <stddef.h>
+#include <hb/stadium.h>
+
+/* a stadium under construction, every list is a growable array of
+   values. header holds the name, the scalar fields, bg and player
+   physics, its lists are not used. the first disc is the ball */
+
+struct hb_stadium_builder {
+	struct hb_stadium                header;
+	struct hb_vertex              *vertexes;
+	size_t                   vertexes_count;
+	size_t                vertexes_capacity;
+	struct hb_segment             *segments;
+	size_t                   segments_count;
+	size_t                segments_capacity;
+	struct hb_goal                   *goals;
+	size_t                      goals_count;
+	size_t                   goals_capacity;
+	struct hb_disc                   *discs;
+	size_t                      discs_count;
+	size_t                   discs_capacity;
+	struct hb_plane                 *planes;
+	size_t                     planes_count;
+	size_t                  planes_capacity;
+	struct hb_joint                 *joints;
+	size_t                     joints_count;
+	size_t                  joints_capacity;
+	struct hb_point       *red_spawn_points;
+	size_t           red_spawn_points_count;
+	size_t        red_spawn_points_capacity;
+	struct hb_point      *blue_spawn_points;
+	size_t          blue_spawn_points_count;
+	size_t       blue_spawn_points_capacity;
+};
+
+/* starts with the same defaults hb_stadium_parse falls back to, and
+   a ball */
+extern struct hb_stadium_builder *
+hb_stadium_builder_create(void);
+
+/* traits are not kept, the elements already carry their values */
+extern struct hb_stadium_builder *
+hb_stadium_builder_from(const struct hb_stadium *s);
+
+extern void
+hb_stadium_builder_free(struct hb_stadium_builder *b);
+
+extern int
+hb_stadium_builder_set_name(struct hb_stadium_builder *b, const char *name);
+
+/* the add functions return the index of the new element or -1 */
+extern long
+hb_stadium_builder_add_vertex(struct hb_stadium_builder *b, const struct hb_vertex *v);
+
+extern long
+hb_stadium_builder_add_segment(struct hb_stadium_builder *b, const struct hb_segment *seg);
+
+extern long
+hb_stadium_builder_add_goal(struct hb_stadium_builder *b, const struct hb_goal *g);
+
+extern long
+hb_stadium_builder_add_disc(struct hb_stadium_builder *b, const struct hb_disc *d);
+
+extern long
+hb_stadium_builder_add_plane(struct hb_stadium_builder *b, const struct hb_plane *p);
+
+extern long
+hb_stadium_builder_add_joint(struct hb_stadium_builder *b, const struct hb_joint *j);
+
+extern long
+hb_stadium_builder_add_red_spawn_point(struct hb_stadium_builder *b, const struct hb_point *p);
+
+extern long
+hb_stadium_builder_add_blue_spawn_point(struct hb_stadium_builder *b, const struct hb_point *p);
+
+/* removing swaps the last element into the hole. segments using a
+   removed vertex and joints using a removed disc are removed too, the
+   ones using the moved element are fixed up */
+extern int
+hb_stadium_builder_remove_vertex(struct hb_stadium_builder *b, size_t index);
+
+extern int
+hb_stadium_builder_remove_segment(struct hb_stadium_builder *b, size_t index);
+
+extern int
+hb_stadium_builder_remove_goal(struct hb_stadium_builder *b, size_t index);
+
+/* the ball can't be removed */
+extern int
+hb_stadium_builder_remove_disc(struct hb_stadium_builder *b, size_t index);
+
+extern int
+hb_stadium_builder_remove_plane(struct hb_stadium_builder *b, size_t index);
+
+extern int
+hb_stadium_builder_remove_joint(struct hb_stadium_builder *b, size_t index);
+
+extern int
+hb_stadium_builder_remove_red_spawn_point(struct hb_stadium_builder *b, size_t index);
+
+extern int
+hb_stadium_builder_remove_blue_spawn_point(struct hb_stadium_builder *b, size_t index);
+
+/* packs everything into a single allocation, the builder can still be
+   used afterwards. the stadium is freed with hb_stadium_free */
+extern struct hb_stadium *
+hb_stadium_builder_finalize(const struct hb_stadium_builder *b);
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef __LIBHB_CACHE_H__
+#define __LIBHB_CACHE_H__
+
+#include <stddef.h>
+#include <hb/hash.h>
+#include <hb/stadium.h>
+
+/* a thread safe cache of immutable stadiums keyed by hb_stadium_hash,
+   every stadium it hands out holds a reference that has to be given
+   back with hb_stadium_cache_release. once the stadiums held go over
+   the byte budget the least recently used unreferenced ones are freed */
+
+struct hb_stadium_cache;
+
+extern struct hb_stadium_cache *
+hb_stadium_cache_create(size_t budget);
+
+/* every stadium must have been released before */
+extern void
+hb_stadium_cache_free(struct hb_stadium_cache *cache);
+
+/* returns NULL on a miss */
+extern const struct hb_stadium *
+hb_stadium_cache_lookup(struct hb_stadium_cache *cache, struct hb_hash128 key);
+
+/* takes ownership of s, when a stadium with the same content is cached
+   already s is freed and the cached one is returned instead */
+extern const struct hb_stadium *
+hb_stadium_cache_insert(struct hb_stadium_cache *cache, struct hb_stadium *s);
+
+/* remembers the raw bytes it was given, so parsing the same input again
+   does not even hash the stadium */
+extern const struct hb_stadium *
+hb_stadium_cache_parse(struct hb_stadium_cache *cache, const char *in);
+
+/* s has to come from this cache and is released once for every time it
+   was handed out. a stadium the cache does not hold is ignored */
+extern void
+hb_stadium_cache_release(struct hb_stadium_cache *cache, const struct hb_stadium *s);
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef __LIBHB_CAST_H__
+#define __LIBHB_CAST_H__
+
+#include <stddef.h>
+#include <hb/collision_flags.h>
+#include <hb/geometry.h>
+#include <hb/grid.h>
+#include <hb/stadium.h>
+
+/* ray and circle casts against the walls of a stadium. a cast starts at
+   x, y and goes as far as x + dx, y + dy, and stops at the first wall
+   whose mask holds one of the flags asked for, the walls a disc of that
+   group collides with. a circle meets the walls as hb_ccd does for a
+   moving disc, a ray is a circle of radius 0 and goes through
+   vertexes. casts are done a packet of neighbours at a time, the
+   packet asks the grid once and is tested against each wall with AVX
+   or SSE2 when the build targets them */
+
+struct hb_cast_index {
+	struct hb_geometry            *geometry;
+	struct hb_static_grid             *grid;
+};
+
+struct hb_ray {
+	double                                x;
+	double                                y;
+	double                               dx;
+	double                               dy;
+};
+
+enum hb_cast_element {
+	HB_CAST_NONE,
+	HB_CAST_PLANE,
+	HB_CAST_SEGMENT,
+	HB_CAST_VERTEX
+};
+
+/* t is how much of dx, dy was travelled, distance how far that is.
+   the normal faces the caster and index is that of the element in the
+   index's geometry. a cast that hits nothing has an element of
+   HB_CAST_NONE and a t of 1 */
+struct hb_cast_hit {
+	double                                t;
+	double                         distance;
+	double                         normal_x;
+	double                         normal_y;
+	enum hb_cast_element            element;
+	size_t                            index;
+};
+
+extern struct hb_cast_index *
+hb_cast_index_build(const struct hb_stadium *s, double cell_size);
+
+extern void
+hb_cast_index_free(struct hb_cast_index *index);
+
+/* fills one hit per ray, returns how many rays hit a wall or -1 */
+extern long
+hb_raycast_batch(const struct hb_cast_index *index, const struct hb_ray *rays,
+		size_t n, enum hb_collision_flags mask, struct hb_cast_hit *hits);
+
+/* the same for circles of the given radius moving along the rays */
+extern long
+hb_circle_cast_batch(const struct hb_cast_index *index, const struct hb_ray *rays,
+		size_t n, double radius, enum hb_collision_flags mask,
+		struct hb_cast_hit *hits);
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef __LIBHB_CCD_H__
+#define __LIBHB_CCD_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <hb/geometry.h>
+
+/* swept circle tests against the walls of the compiled geometry. a disc
+   of radius r at x, y moving by dx, dy hits a wall at t, between 0 and
+   1, when it comes to touch it from outside while moving into it. a
+   disc already into a wall is left to the collision step and does not
+   hit it. the normal points from the wall towards the disc. segments
+   keep to their bias and, like in hb_world_step, only their inside
+   counts, their ends are the vertexes' business */
+
+struct hb_ccd_hit {
+	double                                t;
+	double                         normal_x;
+	double                         normal_y;
+};
+
+extern bool
+hb_ccd_plane(const struct hb_geometry *g, size_t k, double x, double y,
+		double dx, double dy, double r, struct hb_ccd_hit *hit);
+
+extern bool
+hb_ccd_segment(const struct hb_geometry *g, size_t k, double x, double y,
+		double dx, double dy, double r, struct hb_ccd_hit *hit);
+
+extern bool
+hb_ccd_vertex(const struct hb_geometry *g, size_t k, double x, double y,
+		double dx, double dy, double r, struct hb_ccd_hit *hit);
+
+#endif
@@ -0,0 +1,38 @@
+#ifndef __LIBHB_COLLISION_TABLE_H__
+#define __LIBHB_COLLISION_TABLE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <hb/collision_flags.h>
+
+/* every distinct pair of c_group and c_mask is a class, and whether two
+   classes collide is one bit of a matrix worked out when the class is
+   added. collision code keeps the class of each disc and wall around
+   and tests it instead of the masks */
+
+struct hb_collision_table {
+	size_t                            count;
+	size_t                         capacity;
+	/* 64 bit words in a row of bits */
+	size_t                            words;
+	enum hb_collision_flags        *c_group;
+	enum hb_collision_flags         *c_mask;
+	uint64_t                          *bits;
+};
+
+extern struct hb_collision_table *
+hb_collision_table_create(void);
+
+extern void
+hb_collision_table_free(struct hb_collision_table *t);
+
+/* returns the class of c_group and c_mask, added when new, or -1 */
+extern long
+hb_collision_table_add(struct hb_collision_table *t,
+		enum hb_collision_flags c_group, enum hb_collision_flags c_mask);
+
+#define hb_collision_table_test(t,a,b) \
+	((t)->bits[(size_t)(a) * (t)->words + (b) / 64] >> ((b) % 64) & 1)
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef __LIBHB_DIFF_H__
+#define __LIBHB_DIFF_H__
+
+#include <stddef.h>
+#include <hb/stadium.h>
+
+/* an element level delta between two stadiums. every list is matched by
+   its common prefix and suffix, what is left in between is updated in
+   place field by field and the rest is removed or inserted. segment and
+   joint indexes are remapped when vertexes or discs move. the encoding
+   does not depend on the host, doubles are stored as little endian bits
+   so a patched stadium is bitwise equal to the one the delta came from.
+   traits are not part of the delta, an element's trait goes by name and
+   becomes the patched stadium's trait of that name, or none, and a field
+   an update sets joins the element's overrides. borrowed sections are
+   unshared before they change and the ball is expected to be the first
+   disc as hb_stadium_parse leaves it */
+
+struct hb_stadium_delta {
+	size_t                             size;
+	unsigned char                     *data;
+};
+
+extern struct hb_stadium_delta *
+hb_stadium_diff(const struct hb_stadium *a, const struct hb_stadium *b);
+
+/* turns a into b, on failure s is left untouched */
+extern int
+hb_stadium_patch(struct hb_stadium *s, const struct hb_stadium_delta *delta);
+
+extern void
+hb_stadium_delta_free(struct hb_stadium_delta *delta);
+
+#endif
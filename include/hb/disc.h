@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <hb/collision_flags.h>
+#include <hb/trait.h>
 
 struct hb_disc {
 	double                           pos[2];
@@ -15,6 +16,9 @@ struct hb_disc {
 	double                           b_coef;
 	enum hb_collision_flags          c_mask;
 	enum hb_collision_flags         c_group;
+	/* see hb/trait.h */
+	const struct hb_trait            *trait;
+	unsigned                      overrides;
 };
 
 #endif
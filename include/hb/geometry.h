@@ -0,0 +1,86 @@
+#ifndef __LIBHB_GEOMETRY_H__
+#define __LIBHB_GEOMETRY_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <hb/collision_flags.h>
+#include <hb/collision_table.h>
+#include <hb/stadium.h>
+
+/* the static part of a stadium laid out as flat arrays for collision
+   code, one array per field. segments with a negative curve have their
+   ends swapped and their bias negated, and a curve outside of (10, 340)
+   degrees is treated as straight, like the game does. for arcs t0 and
+   t1 are the tangents at v0 and v1, pointing into the arc, both flipped
+   when the arc is wider than half a circle. the classes are left at 0
+   until hb_geometry_classify fills them in */
+
+struct hb_geometry {
+	size_t                   segments_count;
+	bool                               *arc;
+	double                            *v0_x;
+	double                            *v0_y;
+	double                            *v1_x;
+	double                            *v1_y;
+	double                        *normal_x;
+	double                        *normal_y;
+	double                        *center_x;
+	double                        *center_y;
+	double                          *radius;
+	double                             *cot;
+	double                            *t0_x;
+	double                            *t0_y;
+	double                            *t1_x;
+	double                            *t1_y;
+	double                           *min_x;
+	double                           *min_y;
+	double                           *max_x;
+	double                           *max_y;
+	double                            *bias;
+	double                          *b_coef;
+	enum hb_collision_flags        *c_group;
+	enum hb_collision_flags         *c_mask;
+	uint32_t                        *c_class;
+	size_t                   vertexes_count;
+	double                        *vertex_x;
+	double                        *vertex_y;
+	double                   *vertex_b_coef;
+	enum hb_collision_flags *vertex_c_group;
+	enum hb_collision_flags  *vertex_c_mask;
+	uint32_t                 *vertex_c_class;
+	size_t                     planes_count;
+	double                  *plane_normal_x;
+	double                  *plane_normal_y;
+	double                      *plane_dist;
+	double                    *plane_b_coef;
+	enum hb_collision_flags  *plane_c_group;
+	enum hb_collision_flags   *plane_c_mask;
+	uint32_t                  *plane_c_class;
+};
+
+extern struct hb_geometry *
+hb_stadium_compile(const struct hb_stadium *s);
+
+extern void
+hb_geometry_free(struct hb_geometry *g);
+
+/* whether the direction (dx, dy), seen from the center of arc i, falls
+   within the arc */
+extern bool
+hb_geometry_arc_contains(const struct hb_geometry *g, size_t i,
+		double dx, double dy);
+
+/* adds the masks of every segment, vertex and plane to t and keeps
+   their class */
+extern int
+hb_geometry_classify(struct hb_geometry *g, struct hb_collision_table *t);
+
+/* drops the segments, vertexes and planes of a class that collides with
+   none of the count classes given, the rest keep their order. returns
+   how many were dropped */
+extern size_t
+hb_geometry_drop_unreachable(struct hb_geometry *g,
+		const struct hb_collision_table *t, const uint32_t *classes, size_t count);
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef __LIBHB_GRID_H__
+#define __LIBHB_GRID_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <hb/geometry.h>
+#include <hb/stadium.h>
+
+/* a uniform grid over the segments and vertexes of a stadium. each cell
+   lists the elements whose box touches it, all cells share one index
+   array and cell i owns the entries from start[i] to start[i + 1]. a
+   segment's box is its bounds grown by its bias, as a biased segment
+   reaches that far behind its line. planes have no bounds and are not
+   in the grid */
+
+struct hb_static_grid {
+	double                            min_x;
+	double                            min_y;
+	double                        cell_size;
+	size_t                          columns;
+	size_t                             rows;
+	size_t                   segments_count;
+	size_t                   vertexes_count;
+	size_t                   *segment_start;
+	uint32_t                 *segment_index;
+	size_t                    *vertex_start;
+	uint32_t                  *vertex_index;
+	/* the first cell of every element, a query only reports an element
+	   from the first cell it shares with the box */
+	uint32_t                *segment_column;
+	uint32_t                   *segment_row;
+	uint32_t                 *vertex_column;
+	uint32_t                    *vertex_row;
+};
+
+extern struct hb_static_grid *
+hb_static_grid_build(const struct hb_stadium *s, double cell_size);
+
+/* the same over geometry that was already compiled, indexes are those
+   of g */
+extern struct hb_static_grid *
+hb_static_grid_from_geometry(const struct hb_geometry *g, double cell_size);
+
+extern void
+hb_static_grid_free(struct hb_static_grid *grid);
+
+/* writes every segment and vertex that may touch the box into segments
+   and vertexes, in increasing order and each once. the arrays have to
+   hold segments_count and vertexes_count entries, their lengths are
+   stored in *nsegments and *nvertexes */
+extern void
+hb_static_grid_query(const struct hb_static_grid *grid,
+		double min_x, double min_y, double max_x, double max_y,
+		uint32_t *segments, size_t *nsegments,
+		uint32_t *vertexes, size_t *nvertexes);
+
+#endif
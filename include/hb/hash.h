@@ -0,0 +1,32 @@
+#ifndef __LIBHB_HASH_H__
+#define __LIBHB_HASH_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <hb/stadium.h>
+
+struct hb_hash128 {
+	uint64_t                           h[2];
+};
+
+extern struct hb_hash128
+hb_hash_bytes(const void *data, size_t len);
+
+/* hashes a canonical encoding of every field of the stadium. the list
+   of traits is left out since the parser already folds them into the
+   elements, but every element's trait name and overrides are kept as
+   hb_stadium_set_trait_field tells elements apart by them. -0 is
+   treated as 0, so two stadiums that only differ in formatting, key
+   order or the order of their traits hash the same */
+extern struct hb_hash128
+hb_stadium_hash(const struct hb_stadium *s);
+
+/* same canonical comparison hb_stadium_hash is built on */
+extern bool
+hb_stadium_equal(const struct hb_stadium *a, const struct hb_stadium *b);
+
+#define hb_hash128_equal(a,b) \
+	((a).h[0] == (b).h[0] && (a).h[1] == (b).h[1])
+
+#endif
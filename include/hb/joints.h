@@ -0,0 +1,42 @@
+#ifndef __LIBHB_JOINTS_H__
+#define __LIBHB_JOINTS_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <hb/stadium.h>
+
+/* the joints of a stadium ready to be solved. auto lengths are the
+   distance between the discs when built and rigid joints have an
+   infinite strength. joints are grouped in batches, no two joints of a
+   batch sharing a disc, so a whole batch can be solved at once: batch
+   b runs from start[b] to start[b + 1], each batch keeps the order of
+   the stadium and the batches are solved in turn */
+
+struct hb_joints {
+	size_t                            count;
+	size_t                    batches_count;
+	size_t                           *start;
+	uint32_t                            *d0;
+	uint32_t                            *d1;
+	double                             *min;
+	double                             *max;
+	double                        *strength;
+};
+
+/* x and y hold the positions of the discs_count discs the joints refer
+   to, in the order of the stadium. joints with a disc out of range are
+   left out */
+extern struct hb_joints *
+hb_joints_build(const struct hb_stadium *s, const double *x, const double *y,
+		size_t discs_count);
+
+extern void
+hb_joints_free(struct hb_joints *j);
+
+/* one pass over every joint, batch after batch, with AVX or SSE2 when
+   the build targets them and plain code otherwise */
+extern void
+hb_joints_solve(const struct hb_joints *j, double *x, double *y,
+		double *speed_x, double *speed_y, const double *inv_mass);
+
+#endif
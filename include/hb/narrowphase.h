@@ -0,0 +1,30 @@
+#ifndef __LIBHB_NARROWPHASE_H__
+#define __LIBHB_NARROWPHASE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <hb/geometry.h>
+
+/* tests one disc against up to HB_NARROWPHASE_BATCH walls of the
+   compiled geometry at once, the walls named by their indexes. bit j
+   of the result is set when the disc at x, y of radius r is into wall
+   index[j], and depth[j], unless depth is NULL, is then how far. the
+   tests are the ones hb_world_step does one wall at a time, with AVX2
+   or SSE2 when the build targets them and plain code otherwise */
+
+#define HB_NARROWPHASE_BATCH 8
+
+extern unsigned
+hb_narrowphase_planes(const struct hb_geometry *g, const uint32_t *index,
+		size_t count, double x, double y, double r, double *depth);
+
+/* straight segments and arcs alike, bias included */
+extern unsigned
+hb_narrowphase_segments(const struct hb_geometry *g, const uint32_t *index,
+		size_t count, double x, double y, double r, double *depth);
+
+extern unsigned
+hb_narrowphase_vertexes(const struct hb_geometry *g, const uint32_t *index,
+		size_t count, double x, double y, double r, double *depth);
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef __LIBHB_OPTIMIZE_H__
+#define __LIBHB_OPTIMIZE_H__
+
+#include <stddef.h>
+#include <hb/stadium.h>
+
+/* passes of hb_stadium_optimize. only changes that leave collisions as
+   they were are made: vertexes are welded when every collision field
+   matches, a segment is unreachable when it is invisible and its mask
+   or group is empty, and straight segments are merged when they run on
+   in the same direction through a shared vertex with every field equal,
+   the vertex in between is kept */
+
+enum hb_optimize_flags {
+	HB_OPTIMIZE_WELD_VERTEXES =           1 << 0,
+	HB_OPTIMIZE_DROP_DEGENERATE =         1 << 1,
+	HB_OPTIMIZE_DROP_UNREACHABLE =        1 << 2,
+	HB_OPTIMIZE_MERGE_COLLINEAR =         1 << 3,
+	HB_OPTIMIZE_ALL =              (1 << 4) - 1
+};
+
+struct hb_optimize_report {
+	size_t                  vertexes_welded;
+	size_t             vertexes_unreachable;
+	size_t              segments_degenerate;
+	size_t             segments_unreachable;
+	size_t                  segments_merged;
+};
+
+/* runs the passes in the opts mask of enum hb_optimize_flags over s and
+   remaps segment indexes, report may be NULL. on failure s is left
+   untouched */
+extern int
+hb_stadium_optimize(struct hb_stadium *s, unsigned opts,
+		struct hb_optimize_report *report);
+
+#endif
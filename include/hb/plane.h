@@ -2,6 +2,7 @@
 #define __LIBHB_PLANE_H__
 
 #include <hb/collision_flags.h>
+#include <hb/trait.h>
 
 struct hb_plane {
 	double                        normal[2];
@@ -9,6 +10,9 @@ struct hb_plane {
 	double                           b_coef;
 	enum hb_collision_flags          c_mask;
 	enum hb_collision_flags         c_group;
+	/* see hb/trait.h */
+	const struct hb_trait            *trait;
+	unsigned                      overrides;
 };
 
 #endif
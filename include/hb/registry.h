@@ -0,0 +1,62 @@
+#ifndef __LIBHB_REGISTRY_H__
+#define __LIBHB_REGISTRY_H__
+
+#include <stddef.h>
+#include <hb/stadium.h>
+
+/* maps names to immutable stadiums that can be replaced while other
+   threads read them. readers load the current version with a plain
+   acquire load and announce a quiescent state (for instance at every
+   kick-off) once they no longer hold any stadium they got before it.
+   a replaced version is freed after every online reader went through
+   a quiescent state */
+
+struct hb_stadium_registry;
+struct hb_stadium_slot;
+struct hb_stadium_reader;
+
+extern struct hb_stadium_registry *
+hb_stadium_registry_create(void);
+
+/* no reader may be registered anymore */
+extern void
+hb_stadium_registry_free(struct hb_stadium_registry *reg);
+
+/* returns the slot for name creating an empty one if needed, slots live
+   as long as the registry so readers look them up once */
+extern struct hb_stadium_slot *
+hb_stadium_registry_slot(struct hb_stadium_registry *reg, const char *name);
+
+/* takes ownership of s, the previous version is retired */
+extern int
+hb_stadium_registry_publish(struct hb_stadium_registry *reg, const char *name,
+		struct hb_stadium *s);
+
+/* frees every retired version no reader can hold anymore, returns how
+   many are still waiting */
+extern size_t
+hb_stadium_registry_reclaim(struct hb_stadium_registry *reg);
+
+/* the returned stadium stays valid until the calling reader's next
+   quiescent state */
+extern const struct hb_stadium *
+hb_stadium_slot_get(const struct hb_stadium_slot *slot);
+
+extern struct hb_stadium_reader *
+hb_stadium_reader_register(struct hb_stadium_registry *reg);
+
+extern void
+hb_stadium_reader_unregister(struct hb_stadium_reader *reader);
+
+extern void
+hb_stadium_reader_quiescent(struct hb_stadium_reader *reader);
+
+/* an offline reader holds no stadium and does not hold back reclaiming,
+   for threads about to block */
+extern void
+hb_stadium_reader_offline(struct hb_stadium_reader *reader);
+
+extern void
+hb_stadium_reader_online(struct hb_stadium_reader *reader);
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef __LIBHB_SDF_H__
+#define __LIBHB_SDF_H__
+
+#include <stddef.h>
+#include <hb/collision_flags.h>
+#include <hb/stadium.h>
+
+/* the distance from points of a stadium to its nearest wall, sampled on
+   a grid of spacing resolution over the stadium's bounds and its walls.
+   only the walls whose mask holds one of the flags asked for count,
+   that is the ones a disc of that group collides with. the distance
+   goes negative past a plane, and behind a segment with a bias for as
+   far as the bias reaches, the side hb_ccd pushes discs away from.
+   further behind, past the ends of a segment, along segments without a
+   bias and around vertexes it stays positive. sample (column, row) is
+   at min_x + column * resolution, min_y + row * resolution, row by
+   row */
+
+struct hb_sdf {
+	double                            min_x;
+	double                            min_y;
+	double                       resolution;
+	size_t                          columns;
+	size_t                             rows;
+	double                        *distance;
+};
+
+/* the rows are shared out between a few threads. a resolution small
+   next to the stadium is made larger to keep the grid to a sane size,
+   a stadium without any such wall is INFINITY everywhere */
+extern struct hb_sdf *
+hb_stadium_build_sdf(const struct hb_stadium *s, double resolution,
+		enum hb_collision_flags mask);
+
+extern void
+hb_sdf_free(struct hb_sdf *sdf);
+
+/* the distance at x, y, interpolated between the four samples around
+   it. points off the grid take the value at its nearest edge */
+extern double
+hb_sdf_sample(const struct hb_sdf *sdf, double x, double y);
+
+#endif
@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <hb/collision_flags.h>
+#include <hb/trait.h>
 
 struct hb_segment {
 	int                                  v0;
@@ -15,6 +16,9 @@ struct hb_segment {
 	enum hb_collision_flags          c_mask;
 	bool                                vis;
 	uint32_t                          color;
+	/* see hb/trait.h */
+	const struct hb_trait            *trait;
+	unsigned                      overrides;
 };
 
 #endif
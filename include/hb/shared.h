@@ -0,0 +1,118 @@
+#ifndef __LIBHB_SHARED_H__
+#define __LIBHB_SHARED_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <hb/stadium.h>
+
+/* a stadium flattened into one position independent image, every list is
+   stored as an array at an offset from the start of the image. images are
+   only meant to be shared between processes on the same host, element
+   sizes are recorded and checked when mapping */
+
+#define HB_SHARED_STADIUM_MAGIC       0x53534248u
+#define HB_SHARED_STADIUM_VERSION              1u
+
+struct hb_shared_section {
+	uint64_t                         offset;
+	uint64_t                          count;
+	uint64_t                           size;
+};
+
+struct hb_shared_stadium {
+	uint32_t                          magic;
+	uint32_t                        version;
+	uint64_t                           size;
+	uint64_t                    name_offset;
+	double                            width;
+	double                           height;
+	double                     camera_width;
+	double                    camera_height;
+	double                   max_view_width;
+	enum hb_camera_follow     camera_follow;
+	double                   spawn_distance;
+	bool                      can_be_stored;
+	enum hb_kick_off_reset   kick_off_reset;
+	struct hb_background                 bg;
+	struct hb_disc             ball_physics;
+	struct hb_player_physics player_physics;
+	struct hb_shared_section       vertexes;
+	struct hb_shared_section       segments;
+	struct hb_shared_section          goals;
+	struct hb_shared_section          discs;
+	struct hb_shared_section         planes;
+	struct hb_shared_section         joints;
+	struct hb_shared_section red_spawn_points;
+	struct hb_shared_section blue_spawn_points;
+};
+
+extern int
+hb_stadium_export_shared(const struct hb_stadium *s, int fd);
+
+/* returns NULL unless fd holds an image whose sections are aligned, lie
+   within it and only refer to vertexes and discs that it has */
+extern const struct hb_shared_stadium *
+hb_stadium_map_shared(int fd);
+
+extern void
+hb_stadium_unmap_shared(const struct hb_shared_stadium *ss);
+
+#define hb_shared_stadium_at(ss,section,type) \
+	((const type *)((const char *)(ss) + (ss)->section.offset))
+
+#define hb_shared_stadium_name(ss) \
+	((const char *)(ss) + (ss)->name_offset)
+
+#define hb_shared_stadium_vertexes(ss) \
+	hb_shared_stadium_at(ss, vertexes, struct hb_vertex)
+
+#define hb_shared_stadium_segments(ss) \
+	hb_shared_stadium_at(ss, segments, struct hb_segment)
+
+#define hb_shared_stadium_goals(ss) \
+	hb_shared_stadium_at(ss, goals, struct hb_goal)
+
+#define hb_shared_stadium_discs(ss) \
+	hb_shared_stadium_at(ss, discs, struct hb_disc)
+
+#define hb_shared_stadium_planes(ss) \
+	hb_shared_stadium_at(ss, planes, struct hb_plane)
+
+#define hb_shared_stadium_joints(ss) \
+	hb_shared_stadium_at(ss, joints, struct hb_joint)
+
+#define hb_shared_stadium_red_spawn_points(ss) \
+	hb_shared_stadium_at(ss, red_spawn_points, struct hb_point)
+
+#define hb_shared_stadium_blue_spawn_points(ss) \
+	hb_shared_stadium_at(ss, blue_spawn_points, struct hb_point)
+
+#define hb_shared_stadium_foreach(ss,section,type,t) \
+	for (const type *t = hb_shared_stadium_at(ss, section, type), \
+			*t##_end = t + (ss)->section.count; t < t##_end; ++t)
+
+#define hb_shared_stadium_vertexes_foreach(ss,t) \
+	hb_shared_stadium_foreach(ss, vertexes, struct hb_vertex, t)
+
+#define hb_shared_stadium_segments_foreach(ss,t) \
+	hb_shared_stadium_foreach(ss, segments, struct hb_segment, t)
+
+#define hb_shared_stadium_goals_foreach(ss,t) \
+	hb_shared_stadium_foreach(ss, goals, struct hb_goal, t)
+
+#define hb_shared_stadium_discs_foreach(ss,t) \
+	hb_shared_stadium_foreach(ss, discs, struct hb_disc, t)
+
+#define hb_shared_stadium_planes_foreach(ss,t) \
+	hb_shared_stadium_foreach(ss, planes, struct hb_plane, t)
+
+#define hb_shared_stadium_joints_foreach(ss,t) \
+	hb_shared_stadium_foreach(ss, joints, struct hb_joint, t)
+
+#define hb_shared_stadium_red_spawn_points_foreach(ss,t) \
+	hb_shared_stadium_foreach(ss, red_spawn_points, struct hb_point, t)
+
+#define hb_shared_stadium_blue_spawn_points_foreach(ss,t) \
+	hb_shared_stadium_foreach(ss, blue_spawn_points, struct hb_point, t)
+
+#endif
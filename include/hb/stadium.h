@@ -23,6 +23,29 @@ enum hb_kick_off_reset {
 	HB_KICK_OFF_RESET_FULL
 };
 
+struct hb_tessellation;
+
+enum hb_stadium_json_flags {
+	HB_STADIUM_JSON_COMPACT =         1 << 0,
+	HB_STADIUM_JSON_TRAITS =          1 << 1
+};
+
+enum hb_stadium_section {
+	HB_STADIUM_SECTION_NAME =              1 << 0,
+	HB_STADIUM_SECTION_BG =                1 << 1,
+	HB_STADIUM_SECTION_TRAITS =            1 << 2,
+	HB_STADIUM_SECTION_VERTEXES =          1 << 3,
+	HB_STADIUM_SECTION_SEGMENTS =          1 << 4,
+	HB_STADIUM_SECTION_GOALS =             1 << 5,
+	HB_STADIUM_SECTION_DISCS =             1 << 6,
+	HB_STADIUM_SECTION_PLANES =            1 << 7,
+	HB_STADIUM_SECTION_JOINTS =            1 << 8,
+	HB_STADIUM_SECTION_RED_SPAWN_POINTS =  1 << 9,
+	HB_STADIUM_SECTION_BLUE_SPAWN_POINTS = 1 << 10,
+	HB_STADIUM_SECTION_PLAYER_PHYSICS =    1 << 11,
+	HB_STADIUM_SECTION_ALL =              (1 << 12) - 1
+};
+
 struct hb_stadium {
 	char                                  *name;
 	double                                width;
@@ -46,6 +69,13 @@ struct hb_stadium {
 	struct hb_point          **red_spawn_points;
 	struct hb_point         **blue_spawn_points;
 	struct hb_player_physics    *player_physics;
+	/* mask of enum hb_stadium_section that hb_stadium_free leaves alone,
+	   they belong to another stadium or live in this one's allocation */
+	unsigned                           borrowed;
+	/* bumped by hb_stadium_invalidate whenever the geometry changes */
+	unsigned long                       version;
+	/* built by hb_stadium_tessellate, dropped along with the version */
+	struct hb_tessellation        *tessellation;
 };
 
 extern struct hb_stadium *
@@ -54,15 +84,59 @@ hb_stadium_parse(const char *in);
 extern struct hb_stadium *
 hb_stadium_from_file(const char *file);
 
+/* NULL when out of memory */
 extern char *
 hb_stadium_to_json(const struct hb_stadium *s);
 
+/* flags is a mask of enum hb_stadium_json_flags, HB_STADIUM_JSON_COMPACT
+   leaves out every field that hb_stadium_parse would fall back to anyway,
+   HB_STADIUM_JSON_TRAITS implies it and also factors repeated properties
+   out into synthesized traits (the stadium's own traits are not kept).
+   returns NULL when out of memory */
+extern char *
+hb_stadium_to_json_ex(const struct hb_stadium *s, int flags);
+
 extern void
 hb_stadium_print(const struct hb_stadium *s);
 
 extern void
 hb_stadium_free(struct hb_stadium *s);
 
+/* drops whatever was derived from the geometry of s and bumps its
+   version. the functions in this library that change a stadium call
+   it themselves, code that writes to the elements directly has to */
+extern void
+hb_stadium_invalidate(struct hb_stadium *s);
+
+/* copies the discs, plus the sections in the copy mask of enum
+   hb_stadium_section, into a single allocation and shares everything
+   else with s, which has to outlive the clone. the clone is freed with
+   hb_stadium_free as usual */
+extern struct hb_stadium *
+hb_stadium_clone(const struct hb_stadium *s, unsigned copy);
+
+/* gives s its own copy of the sections in the mask that it borrows so
+   they can be modified */
+extern int
+hb_stadium_unshare(struct hb_stadium *s, unsigned sections);
+
+/* sets a field of the named trait and passes it on to every element
+   using that trait that does not set the field itself, the same way
+   hb_stadium_parse would have resolved it. value is converted to the
+   field's type */
+extern int
+hb_stadium_set_trait_field(struct hb_stadium *s, const char *trait,
+		enum hb_trait_field field, double value);
+
+/* maps every position in s through x' = m[0] x + m[1] y + m[2] and
+   y' = m[3] x + m[4] y + m[5], speeds and gravity through the linear
+   part. radii, biases and joint lengths scale by the square root of
+   the determinant, so arcs stay exact under rotations, mirrors and
+   uniform scales. a mirror flips curves and biases so every segment
+   keeps the side it bounces from */
+extern int
+hb_stadium_transform(struct hb_stadium *s, const double m[6]);
+
 #define hb_stadium_traits_foreach(s,t) \
 	if (s->traits) \
 		for (struct hb_trait *t, **v = s->traits; (t = *v); ++v) \
@@ -0,0 +1,42 @@
+#ifndef __LIBHB_SWEEP_H__
+#define __LIBHB_SWEEP_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <hb/collision_table.h>
+
+/* sort and sweep over moving discs. discs are kept sorted by the left
+   edge of their box, which an insertion sort keeps up to date cheaply
+   while they move a little between updates. pairs whose boxes, grown
+   by margin, overlap on both axes and whose classes collide are
+   handed out per disc: the partners of disc i come after it, in
+   increasing order, from partner[start[i]] to partner[start[i + 1]] */
+
+struct hb_sweep {
+	size_t                            count;
+	size_t                         capacity;
+	uint32_t                         *order;
+	double                             *key;
+	size_t                      pairs_count;
+	size_t                   pairs_capacity;
+	uint32_t                        *pair_a;
+	uint32_t                        *pair_b;
+	size_t                           *start;
+	uint32_t                       *partner;
+};
+
+extern struct hb_sweep *
+hb_sweep_create(void);
+
+extern void
+hb_sweep_free(struct hb_sweep *sp);
+
+/* brings the order up to date with n discs and finds their pairs. when
+   n changed since the last update the discs that are gone are dropped
+   and the new ones sorted in */
+extern int
+hb_sweep_update(struct hb_sweep *sp, size_t n, const double *x, const double *y,
+		const double *radius, const uint32_t *c_class,
+		const struct hb_collision_table *t, double margin);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef __LIBHB_TESSELLATION_H__
+#define __LIBHB_TESSELLATION_H__
+
+#include <stddef.h>
+#include <hb/stadium.h>
+
+/* every segment of a stadium as a polyline, all points in one pair of
+   arrays. segment i owns count[i] points starting at offset[i] and runs
+   from its v0 to its v1. arcs get as few points as keep every chord
+   within max_error of the arc, segments the game treats as straight
+   get their two ends */
+
+/* how many results for different max_error a stadium keeps */
+#define HB_TESSELLATION_CACHE 4
+
+struct hb_tessellation {
+	double                        max_error;
+	size_t                   segments_count;
+	size_t                     points_count;
+	size_t                          *offset;
+	size_t                           *count;
+	double                               *x;
+	double                               *y;
+	struct hb_tessellation            *next;
+};
+
+/* returns the polylines cached on s for max_error, building them when
+   that max_error is not among the HB_TESSELLATION_CACHE most recently
+   asked for since the geometry changed. a result belongs to s and lives
+   until the next hb_stadium_invalidate or until as many other values of
+   max_error have been asked for since it was last returned. not safe to
+   call on a stadium other threads are reading */
+extern const struct hb_tessellation *
+hb_stadium_tessellate(struct hb_stadium *s, double max_error);
+
+#endif
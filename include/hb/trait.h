@@ -4,6 +4,22 @@
 #include <stdbool.h>
 #include <hb/collision_flags.h>
 
+/* vertexes, segments, discs and planes keep the trait they were parsed
+   with in trait, and in overrides a mask of enum hb_trait_field for the
+   fields they set themselves rather than take from the trait */
+
+enum hb_trait_field {
+	HB_TRAIT_FIELD_CURVE =                 1 << 0,
+	HB_TRAIT_FIELD_DAMPING =               1 << 1,
+	HB_TRAIT_FIELD_INV_MASS =              1 << 2,
+	HB_TRAIT_FIELD_RADIUS =                1 << 3,
+	HB_TRAIT_FIELD_B_COEF =                1 << 4,
+	HB_TRAIT_FIELD_COLOR =                 1 << 5,
+	HB_TRAIT_FIELD_VIS =                   1 << 6,
+	HB_TRAIT_FIELD_C_GROUP =               1 << 7,
+	HB_TRAIT_FIELD_C_MASK =                1 << 8
+};
+
 struct hb_trait {
 	char                              *name;
 	bool                          has_curve;
@@ -2,6 +2,7 @@
 #define __LIBHB_VERTEX_H__
 
 #include <hb/collision_flags.h>
+#include <hb/trait.h>
 
 struct hb_vertex {
 	double                                x;
@@ -9,6 +10,9 @@ struct hb_vertex {
 	double                           b_coef;
 	enum hb_collision_flags         c_group;
 	enum hb_collision_flags          c_mask;
+	/* see hb/trait.h */
+	const struct hb_trait            *trait;
+	unsigned                      overrides;
 };
 
 #endif
@@ -0,0 +1,126 @@
+#ifndef __LIBHB_WORLD_H__
+#define __LIBHB_WORLD_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <hb/collision_flags.h>
+#include <hb/collision_table.h>
+#include <hb/geometry.h>
+#include <hb/grid.h>
+#include <hb/joints.h>
+#include <hb/stadium.h>
+#include <hb/sweep.h>
+#include <hb/team.h>
+
+/* a running match on a stadium. every disc lives in one slot of the
+   arrays below, the stadium's own discs first with the ball at 0 and
+   one disc per player after them. a step is one tick of the game: the
+   players act on their input, every disc moves, then collides with the
+   discs after it and with planes, segments and vertexes, and joints
+   are solved twice, batch by batch. the world keeps its own
+   copy of everything it needs, the stadium may be freed after
+   hb_world_create */
+
+enum hb_input {
+	HB_INPUT_UP =                 1 << 0,
+	HB_INPUT_DOWN =               1 << 1,
+	HB_INPUT_LEFT =               1 << 2,
+	HB_INPUT_RIGHT =              1 << 3,
+	HB_INPUT_KICK =               1 << 4
+};
+
+enum hb_world_event {
+	HB_WORLD_EVENT_GOAL =         1 << 0,
+	HB_WORLD_EVENT_KICK =         1 << 1
+};
+
+struct hb_world {
+	/* walls no disc or player can collide with are left out of it */
+	struct hb_geometry            *geometry;
+	/* the classes of the discs and of the walls, a disc changing its
+	   masks has to have its class looked up again */
+	struct hb_collision_table      *classes;
+	/* narrows down the walls each disc is tested against, NULL tests
+	   them all. the outcome is the same either way */
+	struct hb_static_grid             *grid;
+	uint32_t             *segment_candidates;
+	uint32_t              *vertex_candidates;
+	/* narrows down the disc pairs the same way, NULL tests them all.
+	   sweep_x and sweep_y are where the discs were when it was updated */
+	struct hb_sweep                  *sweep;
+	double                         *sweep_x;
+	double                         *sweep_y;
+	struct hb_player_physics  player_physics;
+	/* off unless set, a disc faster than its radius per tick then
+	   moves up to the walls on its way and bounces off them instead
+	   of going through the thin ones, which the game does not do */
+	bool                               ccd;
+	unsigned long                      tick;
+	/* the goal the ball went through on the last step, or -1 */
+	long                               goal;
+	size_t                      discs_count;
+	size_t                   discs_capacity;
+	double                               *x;
+	double                               *y;
+	double                         *speed_x;
+	double                         *speed_y;
+	double                       *gravity_x;
+	double                       *gravity_y;
+	double                          *radius;
+	double                        *inv_mass;
+	double                         *damping;
+	double                          *b_coef;
+	enum hb_collision_flags        *c_group;
+	enum hb_collision_flags         *c_mask;
+	uint32_t                        *c_class;
+	size_t                    players_count;
+	enum hb_team                      *team;
+	unsigned                         *input;
+	bool                        *kick_armed;
+	struct hb_joints                *joints;
+	size_t                      goals_count;
+	double                        *goal_p0x;
+	double                        *goal_p0y;
+	double                        *goal_p1x;
+	double                        *goal_p1y;
+	enum hb_team                 *goal_team;
+};
+
+extern struct hb_world *
+hb_world_create(const struct hb_stadium *s);
+
+extern void
+hb_world_free(struct hb_world *w);
+
+/* adds a still player disc at x, y built from the stadium's player
+   physics, returns the index of the player, its disc is at
+   discs_count - players_count + player */
+extern long
+hb_world_add_player(struct hb_world *w, enum hb_team team, double x, double y);
+
+/* the last player takes the place of the removed one */
+extern void
+hb_world_remove_player(struct hb_world *w, size_t player);
+
+/* advances the world by one tick, inputs holds a mask of enum hb_input
+   per player and may be NULL. returns a mask of enum hb_world_event */
+extern unsigned
+hb_world_step(struct hb_world *w, const unsigned *inputs);
+
+/* where disc goes in the next ticks if it met nothing but the walls:
+   it moves, damps, falls and bounces off planes, segments and vertexes
+   as hb_world_step would move it, the other discs, the players and the
+   joints being left out. its position after every tick is written to
+   positions, x then y, up to the tick it crosses a goal line. returns
+   how many ticks were written, 0 when out of memory. the disc moves on
+   scratch of its own, the world is only read and may be predicted on
+   from several threads at once as long as none of them steps it */
+extern size_t
+hb_world_predict_disc(const struct hb_world *w, size_t disc, size_t ticks,
+		double *positions);
+
+#define hb_world_player_disc(w,player) \
+	((w)->discs_count - (w)->players_count + (player))
+
+#endif
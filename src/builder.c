@@ -0,0 +1,458 @@
+#include <hb/builder.h>
+#include <hb/stadium.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define _HB_BUILDER_ALIGN(n) (((n) + 15) & ~(size_t)15)
+
+static void *
+_hb_builder_grow(void *data, size_t *capacity, size_t size)
+{
+	void *grown;
+	size_t n;
+
+	n = *capacity ? *capacity * 2 : 16;
+	if (NULL == (grown = realloc(data, n * size)))
+		return NULL;
+
+	*capacity = n;
+	return grown;
+}
+
+static void
+_hb_builder_swap_remove(void *data, size_t *count, size_t index, size_t size)
+{
+	--*count;
+	if (index != *count)
+		memcpy((char *)data + index * size, (char *)data + *count * size, size);
+}
+
+static size_t
+_hb_builder_count(void *const *list)
+{
+	size_t count;
+	count = 0;
+	if (list)
+		while (list[count])
+			++count;
+	return count;
+}
+
+#define _HB_BUILDER_ADD(list,elem) \
+	do { \
+		void *grown; \
+		if (b->list##_count == b->list##_capacity) { \
+			if (NULL == (grown = _hb_builder_grow(b->list, \
+							&b->list##_capacity, sizeof(*b->list)))) \
+				return -1; \
+			b->list = grown; \
+		} \
+		b->list[b->list##_count] = *(elem); \
+		return b->list##_count++; \
+	} while (0)
+
+#define _HB_BUILDER_REMOVE(list,index) \
+	do { \
+		if ((index) >= b->list##_count) \
+			return -1; \
+		_hb_builder_swap_remove(b->list, &b->list##_count, (index), \
+				sizeof(*b->list)); \
+		return 0; \
+	} while (0)
+
+/* copies a parsed list into a value array of exactly the right size */
+#define _HB_BUILDER_FROM(list) \
+	do { \
+		size_t i, count; \
+		count = _hb_builder_count((void *const *)s->list); \
+		if (count > 0) { \
+			if (NULL == (b->list = malloc(count * sizeof(*b->list)))) \
+				goto err; \
+			for (i = 0; i < count; ++i) \
+				b->list[i] = *s->list[i]; \
+		} \
+		b->list##_count = b->list##_capacity = count; \
+	} while (0)
+
+#define _HB_BUILDER_DROP_TRAITS(list) \
+	do { \
+		size_t i; \
+		for (i = 0; i < b->list##_count; ++i) { \
+			b->list[i].trait = NULL; \
+			b->list[i].overrides = 0; \
+		} \
+	} while (0)
+
+extern struct hb_stadium_builder *
+hb_stadium_builder_from(const struct hb_stadium *s)
+{
+	struct hb_stadium_builder *b;
+
+	if (NULL == (b = calloc(1, sizeof(*b))))
+		return NULL;
+
+	b->header.name = NULL;
+	b->header.width = s->width;
+	b->header.height = s->height;
+	b->header.camera_width = s->camera_width;
+	b->header.camera_height = s->camera_height;
+	b->header.max_view_width = s->max_view_width;
+	b->header.camera_follow = s->camera_follow;
+	b->header.spawn_distance = s->spawn_distance;
+	b->header.can_be_stored = s->can_be_stored;
+	b->header.kick_off_reset = s->kick_off_reset;
+
+	if (NULL == (b->header.name = strdup(s->name)))
+		goto err;
+
+	if (s->bg) {
+		if (NULL == (b->header.bg = malloc(sizeof(*s->bg))))
+			goto err;
+		*b->header.bg = *s->bg;
+	}
+
+	if (s->player_physics) {
+		if (NULL == (b->header.player_physics = malloc(sizeof(*s->player_physics))))
+			goto err;
+		*b->header.player_physics = *s->player_physics;
+	}
+
+	_HB_BUILDER_FROM(vertexes);
+	_HB_BUILDER_FROM(segments);
+	_HB_BUILDER_FROM(goals);
+	_HB_BUILDER_FROM(discs);
+	_HB_BUILDER_FROM(planes);
+	_HB_BUILDER_FROM(joints);
+	_HB_BUILDER_FROM(red_spawn_points);
+	_HB_BUILDER_FROM(blue_spawn_points);
+
+	_HB_BUILDER_DROP_TRAITS(vertexes);
+	_HB_BUILDER_DROP_TRAITS(segments);
+	_HB_BUILDER_DROP_TRAITS(discs);
+	_HB_BUILDER_DROP_TRAITS(planes);
+
+	return b;
+
+err:
+	hb_stadium_builder_free(b);
+	return NULL;
+}
+
+extern struct hb_stadium_builder *
+hb_stadium_builder_create(void)
+{
+	struct hb_stadium_builder *b;
+	struct hb_stadium *s;
+
+	/* let the parser fill in its fallbacks rather than repeating them */
+	if (NULL == (s = hb_stadium_parse("{\"name\":\"\",\"width\":0,\"height\":0}")))
+		return NULL;
+
+	b = hb_stadium_builder_from(s);
+	hb_stadium_free(s);
+
+	return b;
+}
+
+extern void
+hb_stadium_builder_free(struct hb_stadium_builder *b)
+{
+	free(b->header.name);
+	free(b->header.bg);
+	free(b->header.player_physics);
+	free(b->vertexes);
+	free(b->segments);
+	free(b->goals);
+	free(b->discs);
+	free(b->planes);
+	free(b->joints);
+	free(b->red_spawn_points);
+	free(b->blue_spawn_points);
+	free(b);
+}
+
+extern int
+hb_stadium_builder_set_name(struct hb_stadium_builder *b, const char *name)
+{
+	char *copy;
+
+	if (NULL == (copy = strdup(name)))
+		return -1;
+
+	free(b->header.name);
+	b->header.name = copy;
+
+	return 0;
+}
+
+/////////////add
+extern long
+hb_stadium_builder_add_vertex(struct hb_stadium_builder *b, const struct hb_vertex *v)
+{
+	struct hb_vertex copy;
+	copy = *v;
+	copy.trait = NULL;
+	copy.overrides = 0;
+	_HB_BUILDER_ADD(vertexes, &copy);
+}
+
+extern long
+hb_stadium_builder_add_segment(struct hb_stadium_builder *b, const struct hb_segment *seg)
+{
+	struct hb_segment copy;
+	if (seg->v0 < 0 || (size_t)seg->v0 >= b->vertexes_count ||
+			seg->v1 < 0 || (size_t)seg->v1 >= b->vertexes_count)
+		return -1;
+	copy = *seg;
+	copy.trait = NULL;
+	copy.overrides = 0;
+	_HB_BUILDER_ADD(segments, &copy);
+}
+
+extern long
+hb_stadium_builder_add_goal(struct hb_stadium_builder *b, const struct hb_goal *g)
+{
+	_HB_BUILDER_ADD(goals, g);
+}
+
+extern long
+hb_stadium_builder_add_disc(struct hb_stadium_builder *b, const struct hb_disc *d)
+{
+	struct hb_disc copy;
+	copy = *d;
+	copy.trait = NULL;
+	copy.overrides = 0;
+	_HB_BUILDER_ADD(discs, &copy);
+}
+
+extern long
+hb_stadium_builder_add_plane(struct hb_stadium_builder *b, const struct hb_plane *p)
+{
+	struct hb_plane copy;
+	copy = *p;
+	copy.trait = NULL;
+	copy.overrides = 0;
+	_HB_BUILDER_ADD(planes, &copy);
+}
+
+extern long
+hb_stadium_builder_add_joint(struct hb_stadium_builder *b, const struct hb_joint *j)
+{
+	if (j->d0 < 0 || (size_t)j->d0 >= b->discs_count ||
+			j->d1 < 0 || (size_t)j->d1 >= b->discs_count)
+		return -1;
+	_HB_BUILDER_ADD(joints, j);
+}
+
+extern long
+hb_stadium_builder_add_red_spawn_point(struct hb_stadium_builder *b, const struct hb_point *p)
+{
+	_HB_BUILDER_ADD(red_spawn_points, p);
+}
+
+extern long
+hb_stadium_builder_add_blue_spawn_point(struct hb_stadium_builder *b, const struct hb_point *p)
+{
+	_HB_BUILDER_ADD(blue_spawn_points, p);
+}
+
+/////////////remove
+extern int
+hb_stadium_builder_remove_vertex(struct hb_stadium_builder *b, size_t index)
+{
+	struct hb_segment *seg;
+	int removed, moved;
+	size_t i;
+
+	if (index >= b->vertexes_count)
+		return -1;
+
+	removed = index;
+	moved = b->vertexes_count - 1;
+	_hb_builder_swap_remove(b->vertexes, &b->vertexes_count, index,
+			sizeof(*b->vertexes));
+
+	for (i = 0; i < b->segments_count; ) {
+		seg = &b->segments[i];
+		if (seg->v0 == removed || seg->v1 == removed) {
+			_hb_builder_swap_remove(b->segments, &b->segments_count, i,
+					sizeof(*b->segments));
+			continue;
+		}
+		if (seg->v0 == moved) seg->v0 = removed;
+		if (seg->v1 == moved) seg->v1 = removed;
+		++i;
+	}
+
+	return 0;
+}
+
+extern int
+hb_stadium_builder_remove_segment(struct hb_stadium_builder *b, size_t index)
+{
+	_HB_BUILDER_REMOVE(segments, index);
+}
+
+extern int
+hb_stadium_builder_remove_goal(struct hb_stadium_builder *b, size_t index)
+{
+	_HB_BUILDER_REMOVE(goals, index);
+}
+
+extern int
+hb_stadium_builder_remove_disc(struct hb_stadium_builder *b, size_t index)
+{
+	struct hb_joint *j;
+	int removed, moved;
+	size_t i;
+
+	if (index == 0 || index >= b->discs_count)
+		return -1;
+
+	removed = index;
+	moved = b->discs_count - 1;
+	_hb_builder_swap_remove(b->discs, &b->discs_count, index,
+			sizeof(*b->discs));
+
+	for (i = 0; i < b->joints_count; ) {
+		j = &b->joints[i];
+		if (j->d0 == removed || j->d1 == removed) {
+			_hb_builder_swap_remove(b->joints, &b->joints_count, i,
+					sizeof(*b->joints));
+			continue;
+		}
+		if (j->d0 == moved) j->d0 = removed;
+		if (j->d1 == moved) j->d1 = removed;
+		++i;
+	}
+
+	return 0;
+}
+
+extern int
+hb_stadium_builder_remove_plane(struct hb_stadium_builder *b, size_t index)
+{
+	_HB_BUILDER_REMOVE(planes, index);
+}
+
+extern int
+hb_stadium_builder_remove_joint(struct hb_stadium_builder *b, size_t index)
+{
+	_HB_BUILDER_REMOVE(joints, index);
+}
+
+extern int
+hb_stadium_builder_remove_red_spawn_point(struct hb_stadium_builder *b, size_t index)
+{
+	_HB_BUILDER_REMOVE(red_spawn_points, index);
+}
+
+extern int
+hb_stadium_builder_remove_blue_spawn_point(struct hb_stadium_builder *b, size_t index)
+{
+	_HB_BUILDER_REMOVE(blue_spawn_points, index);
+}
+
+/////////////finalize
+static size_t
+_hb_builder_list_size(size_t count, size_t size)
+{
+	return _HB_BUILDER_ALIGN((count + 1) * sizeof(void *)) +
+		_HB_BUILDER_ALIGN(count * size);
+}
+
+/* lays out a NULL terminated pointer list followed by its elements */
+static void *
+_hb_builder_pack(char *block, size_t *offset, const void *data, size_t count,
+		size_t size)
+{
+	void **list;
+	char *elems;
+	size_t i;
+
+	list = (void **)(block + *offset);
+	elems = block + *offset + _HB_BUILDER_ALIGN((count + 1) * sizeof(void *));
+
+	if (count > 0)
+		memcpy(elems, data, count * size);
+
+	for (i = 0; i < count; ++i)
+		list[i] = elems + i * size;
+	list[count] = NULL;
+
+	*offset += _hb_builder_list_size(count, size);
+
+	return list;
+}
+
+#define _HB_BUILDER_LIST_SIZE(list) \
+	_hb_builder_list_size(b->list##_count, sizeof(*b->list))
+
+#define _HB_BUILDER_PACK(list) \
+	s->list = _hb_builder_pack(block, &offset, b->list, b->list##_count, \
+			sizeof(*b->list))
+
+extern struct hb_stadium *
+hb_stadium_builder_finalize(const struct hb_stadium_builder *b)
+{
+	struct hb_stadium *s;
+	char *block;
+	size_t size, offset, name_len;
+
+	name_len = strlen(b->header.name) + 1;
+
+	size = _HB_BUILDER_ALIGN(sizeof(*s));
+	size += _HB_BUILDER_ALIGN(name_len);
+	size += _HB_BUILDER_ALIGN(sizeof(*s->bg));
+	size += _HB_BUILDER_ALIGN(sizeof(*s->player_physics));
+	size += _hb_builder_list_size(0, sizeof(*s->traits));
+	size += _HB_BUILDER_LIST_SIZE(vertexes);
+	size += _HB_BUILDER_LIST_SIZE(segments);
+	size += _HB_BUILDER_LIST_SIZE(goals);
+	size += _HB_BUILDER_LIST_SIZE(discs);
+	size += _HB_BUILDER_LIST_SIZE(planes);
+	size += _HB_BUILDER_LIST_SIZE(joints);
+	size += _HB_BUILDER_LIST_SIZE(red_spawn_points);
+	size += _HB_BUILDER_LIST_SIZE(blue_spawn_points);
+
+	if (NULL == (block = malloc(size)))
+		return NULL;
+
+	s = (struct hb_stadium *)block;
+	*s = b->header;
+	s->borrowed = HB_STADIUM_SECTION_ALL;
+	offset = _HB_BUILDER_ALIGN(sizeof(*s));
+
+	s->name = block + offset;
+	memcpy(s->name, b->header.name, name_len);
+	offset += _HB_BUILDER_ALIGN(name_len);
+
+	s->bg = NULL;
+	if (b->header.bg) {
+		s->bg = (struct hb_background *)(block + offset);
+		*s->bg = *b->header.bg;
+	}
+	offset += _HB_BUILDER_ALIGN(sizeof(*s->bg));
+
+	s->player_physics = NULL;
+	if (b->header.player_physics) {
+		s->player_physics = (struct hb_player_physics *)(block + offset);
+		*s->player_physics = *b->header.player_physics;
+	}
+	offset += _HB_BUILDER_ALIGN(sizeof(*s->player_physics));
+
+	s->traits = _hb_builder_pack(block, &offset, NULL, 0, sizeof(*s->traits));
+	_HB_BUILDER_PACK(vertexes);
+	_HB_BUILDER_PACK(segments);
+	_HB_BUILDER_PACK(goals);
+	_HB_BUILDER_PACK(discs);
+	_HB_BUILDER_PACK(planes);
+	_HB_BUILDER_PACK(joints);
+	_HB_BUILDER_PACK(red_spawn_points);
+	_HB_BUILDER_PACK(blue_spawn_points);
+
+	s->ball_physics = s->discs[0];
+
+	return s;
+}
@@ -0,0 +1,437 @@
+#include <hb/cache.h>
+#include <hb/hash.h>
+#include <hb/stadium.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct _hb_cache_entry {
+	struct hb_stadium                   *s;
+	struct hb_hash128                  key;
+	size_t                           bytes;
+	atomic_long                       refs;
+	atomic_ullong                    stamp;
+};
+
+/* open addressing with linear probing, a slot is empty when its entry
+   is NULL and removals shift the rest of the cluster back */
+struct _hb_cache_map {
+	struct hb_hash128                *keys;
+	struct _hb_cache_entry        **values;
+	size_t                           count;
+	size_t                        capacity;
+};
+
+struct hb_stadium_cache {
+	pthread_rwlock_t                  lock;
+	size_t                          budget;
+	size_t                           bytes;
+	atomic_ullong                     tick;
+	struct _hb_cache_map           content;
+	struct _hb_cache_map             alias;
+	struct _hb_cache_map           address;
+	struct _hb_cache_entry        **entries;
+	size_t                           count;
+	size_t                        capacity;
+};
+
+/////////////map
+static size_t
+_hb_cache_map_slot(const struct _hb_cache_map *map, struct hb_hash128 key)
+{
+	return key.h[0] & (map->capacity - 1);
+}
+
+static struct _hb_cache_entry *
+_hb_cache_map_get(const struct _hb_cache_map *map, struct hb_hash128 key)
+{
+	size_t i;
+
+	if (map->capacity == 0)
+		return NULL;
+
+	for (i = _hb_cache_map_slot(map, key); map->values[i];
+			i = (i + 1) & (map->capacity - 1))
+		if (hb_hash128_equal(map->keys[i], key))
+			return map->values[i];
+
+	return NULL;
+}
+
+static void
+_hb_cache_map_put_unchecked(struct _hb_cache_map *map, struct hb_hash128 key,
+		struct _hb_cache_entry *value)
+{
+	size_t i;
+
+	for (i = _hb_cache_map_slot(map, key); map->values[i];
+			i = (i + 1) & (map->capacity - 1))
+		;
+
+	map->keys[i] = key;
+	map->values[i] = value;
+	map->count++;
+}
+
+static int
+_hb_cache_map_put(struct _hb_cache_map *map, struct hb_hash128 key,
+		struct _hb_cache_entry *value)
+{
+	struct _hb_cache_map grown;
+	size_t i;
+
+	if ((map->count + 1) * 2 > map->capacity) {
+		grown.count = 0;
+		grown.capacity = map->capacity ? map->capacity * 2 : 16;
+		grown.keys = malloc(grown.capacity * sizeof(*grown.keys));
+		grown.values = calloc(grown.capacity, sizeof(*grown.values));
+
+		if (!grown.keys || !grown.values) {
+			free(grown.keys);
+			free(grown.values);
+			return -1;
+		}
+
+		for (i = 0; i < map->capacity; ++i)
+			if (map->values[i])
+				_hb_cache_map_put_unchecked(&grown, map->keys[i], map->values[i]);
+
+		free(map->keys);
+		free(map->values);
+		*map = grown;
+	}
+
+	_hb_cache_map_put_unchecked(map, key, value);
+	return 0;
+}
+
+static void
+_hb_cache_map_remove_slot(struct _hb_cache_map *map, size_t i)
+{
+	size_t j, home, mask;
+
+	mask = map->capacity - 1;
+	map->values[i] = NULL;
+	map->count--;
+
+	for (j = (i + 1) & mask; map->values[j]; j = (j + 1) & mask) {
+		home = _hb_cache_map_slot(map, map->keys[j]);
+		/* move j back into the hole unless its home lies in (i, j] */
+		if (((j - home) & mask) >= ((j - i) & mask)) {
+			map->keys[i] = map->keys[j];
+			map->values[i] = map->values[j];
+			map->values[j] = NULL;
+			i = j;
+		}
+	}
+}
+
+static void
+_hb_cache_map_remove_value(struct _hb_cache_map *map,
+		const struct _hb_cache_entry *value)
+{
+	size_t i;
+
+	for (i = 0; i < map->capacity; )
+		if (map->values[i] == value)
+			_hb_cache_map_remove_slot(map, i);
+		else
+			++i;
+}
+
+static void
+_hb_cache_map_free(struct _hb_cache_map *map)
+{
+	free(map->keys);
+	free(map->values);
+}
+
+/////////////entries
+static struct hb_hash128
+_hb_cache_address_key(const struct hb_stadium *s)
+{
+	struct hb_hash128 key;
+	key.h[1] = (uint64_t)(uintptr_t)s;
+	key.h[0] = key.h[1] * 0x9e3779b97f4a7c15ull;
+	key.h[0] ^= key.h[0] >> 29;
+	return key;
+}
+
+static size_t
+_hb_cache_footprint(const struct hb_stadium *s)
+{
+	size_t bytes, count;
+
+#define _HB_CACHE_LIST_BYTES(list,type) \
+	if (s->list) { \
+		for (count = 0; s->list[count]; ++count) \
+			; \
+		bytes += (count + 1) * sizeof(type *) + count * sizeof(type); \
+	}
+
+	bytes = sizeof(*s) + strlen(s->name) + 1;
+	if (s->bg) bytes += sizeof(*s->bg);
+	if (s->player_physics) bytes += sizeof(*s->player_physics);
+
+	hb_stadium_traits_foreach(s, trait) {
+		bytes += sizeof(*trait) + sizeof(trait);
+		if (trait->name) bytes += strlen(trait->name) + 1;
+	}
+
+	_HB_CACHE_LIST_BYTES(vertexes, struct hb_vertex)
+	_HB_CACHE_LIST_BYTES(segments, struct hb_segment)
+	_HB_CACHE_LIST_BYTES(goals, struct hb_goal)
+	_HB_CACHE_LIST_BYTES(discs, struct hb_disc)
+	_HB_CACHE_LIST_BYTES(planes, struct hb_plane)
+	_HB_CACHE_LIST_BYTES(joints, struct hb_joint)
+	_HB_CACHE_LIST_BYTES(red_spawn_points, struct hb_point)
+	_HB_CACHE_LIST_BYTES(blue_spawn_points, struct hb_point)
+
+#undef _HB_CACHE_LIST_BYTES
+
+	return bytes;
+}
+
+static const struct hb_stadium *
+_hb_cache_acquire(struct hb_stadium_cache *cache, struct _hb_cache_entry *e)
+{
+	atomic_fetch_add_explicit(&e->refs, 1, memory_order_relaxed);
+	atomic_store_explicit(&e->stamp, atomic_fetch_add_explicit(&cache->tick,
+			1, memory_order_relaxed), memory_order_relaxed);
+	return e->s;
+}
+
+static void
+_hb_cache_drop(struct hb_stadium_cache *cache, size_t index)
+{
+	struct _hb_cache_entry *e;
+
+	e = cache->entries[index];
+	cache->entries[index] = cache->entries[--cache->count];
+
+	_hb_cache_map_remove_value(&cache->content, e);
+	_hb_cache_map_remove_value(&cache->alias, e);
+	_hb_cache_map_remove_value(&cache->address, e);
+
+	cache->bytes -= e->bytes;
+	hb_stadium_free(e->s);
+	free(e);
+}
+
+/* must be called with the write lock held */
+static void
+_hb_cache_evict(struct hb_stadium_cache *cache)
+{
+	size_t i, victim;
+	unsigned long long stamp, oldest;
+
+	while (cache->bytes > cache->budget) {
+		victim = cache->count;
+		oldest = 0;
+
+		for (i = 0; i < cache->count; ++i) {
+			if (atomic_load_explicit(&cache->entries[i]->refs, memory_order_relaxed))
+				continue;
+			stamp = atomic_load_explicit(&cache->entries[i]->stamp, memory_order_relaxed);
+			if (victim == cache->count || stamp < oldest) {
+				victim = i;
+				oldest = stamp;
+			}
+		}
+
+		if (victim == cache->count)
+			return;
+
+		_hb_cache_drop(cache, victim);
+	}
+}
+
+static struct _hb_cache_entry *
+_hb_cache_add(struct hb_stadium_cache *cache, struct hb_stadium *s,
+		struct hb_hash128 key)
+{
+	struct _hb_cache_entry *e, **entries;
+	size_t capacity;
+
+	if (cache->count == cache->capacity) {
+		capacity = cache->capacity ? cache->capacity * 2 : 8;
+		if (NULL == (entries = realloc(cache->entries, capacity * sizeof(*entries))))
+			return NULL;
+		cache->entries = entries;
+		cache->capacity = capacity;
+	}
+
+	if (NULL == (e = malloc(sizeof(*e))))
+		return NULL;
+
+	e->s = s;
+	e->key = key;
+	e->bytes = _hb_cache_footprint(s);
+	atomic_init(&e->refs, 0);
+	atomic_init(&e->stamp, 0);
+
+	if (_hb_cache_map_put(&cache->content, key, e) < 0) {
+		free(e);
+		return NULL;
+	}
+
+	if (_hb_cache_map_put(&cache->address, _hb_cache_address_key(s), e) < 0) {
+		_hb_cache_map_remove_value(&cache->content, e);
+		free(e);
+		return NULL;
+	}
+
+	cache->entries[cache->count++] = e;
+	cache->bytes += e->bytes;
+
+	return e;
+}
+
+static const struct hb_stadium *
+_hb_cache_insert(struct hb_stadium_cache *cache, struct hb_stadium *s,
+		const struct hb_hash128 *alias)
+{
+	struct _hb_cache_entry *e;
+	struct hb_hash128 key;
+	const struct hb_stadium *out;
+
+	key = hb_stadium_hash(s);
+	out = NULL;
+
+	pthread_rwlock_wrlock(&cache->lock);
+
+	if ((e = _hb_cache_map_get(&cache->content, key))) {
+		/* a 128 bit collision between different stadiums is not
+		   expected to ever happen, but never hand out the wrong one */
+		if (hb_stadium_equal(e->s, s)) {
+			hb_stadium_free(s);
+			s = NULL;
+		}
+	} else {
+		/* a stadium the cache could not take is freed below */
+		if ((e = _hb_cache_add(cache, s, key)))
+			s = NULL;
+	}
+
+	if (s) {
+		hb_stadium_free(s);
+	} else if (e) {
+		if (alias && !_hb_cache_map_get(&cache->alias, *alias))
+			_hb_cache_map_put(&cache->alias, *alias, e);
+		out = _hb_cache_acquire(cache, e);
+		_hb_cache_evict(cache);
+	}
+
+	pthread_rwlock_unlock(&cache->lock);
+
+	return out;
+}
+
+/////////////public
+extern struct hb_stadium_cache *
+hb_stadium_cache_create(size_t budget)
+{
+	struct hb_stadium_cache *cache;
+
+	if (NULL == (cache = calloc(1, sizeof(*cache))))
+		return NULL;
+
+	if (pthread_rwlock_init(&cache->lock, NULL)) {
+		free(cache);
+		return NULL;
+	}
+
+	cache->budget = budget;
+	atomic_init(&cache->tick, 1);
+
+	return cache;
+}
+
+extern void
+hb_stadium_cache_free(struct hb_stadium_cache *cache)
+{
+	size_t i;
+
+	for (i = 0; i < cache->count; ++i) {
+		hb_stadium_free(cache->entries[i]->s);
+		free(cache->entries[i]);
+	}
+
+	_hb_cache_map_free(&cache->content);
+	_hb_cache_map_free(&cache->alias);
+	_hb_cache_map_free(&cache->address);
+	pthread_rwlock_destroy(&cache->lock);
+	free(cache->entries);
+	free(cache);
+}
+
+extern const struct hb_stadium *
+hb_stadium_cache_lookup(struct hb_stadium_cache *cache, struct hb_hash128 key)
+{
+	struct _hb_cache_entry *e;
+	const struct hb_stadium *out;
+
+	pthread_rwlock_rdlock(&cache->lock);
+	e = _hb_cache_map_get(&cache->content, key);
+	out = e ? _hb_cache_acquire(cache, e) : NULL;
+	pthread_rwlock_unlock(&cache->lock);
+
+	return out;
+}
+
+extern const struct hb_stadium *
+hb_stadium_cache_insert(struct hb_stadium_cache *cache, struct hb_stadium *s)
+{
+	return _hb_cache_insert(cache, s, NULL);
+}
+
+extern const struct hb_stadium *
+hb_stadium_cache_parse(struct hb_stadium_cache *cache, const char *in)
+{
+	struct _hb_cache_entry *e;
+	struct hb_stadium *s;
+	struct hb_hash128 alias;
+	const struct hb_stadium *out;
+
+	alias = hb_hash_bytes(in, strlen(in));
+
+	pthread_rwlock_rdlock(&cache->lock);
+	e = _hb_cache_map_get(&cache->alias, alias);
+	out = e ? _hb_cache_acquire(cache, e) : NULL;
+	pthread_rwlock_unlock(&cache->lock);
+
+	if (out)
+		return out;
+
+	if (NULL == (s = hb_stadium_parse(in)))
+		return NULL;
+
+	return _hb_cache_insert(cache, s, &alias);
+}
+
+extern void
+hb_stadium_cache_release(struct hb_stadium_cache *cache, const struct hb_stadium *s)
+{
+	struct _hb_cache_entry *e;
+	bool over;
+
+	pthread_rwlock_rdlock(&cache->lock);
+	/* a stadium the cache never handed out is left alone */
+	if (NULL == (e = _hb_cache_map_get(&cache->address, _hb_cache_address_key(s)))) {
+		pthread_rwlock_unlock(&cache->lock);
+		return;
+	}
+	over = atomic_fetch_sub_explicit(&e->refs, 1, memory_order_release) == 1 &&
+			cache->bytes > cache->budget;
+	pthread_rwlock_unlock(&cache->lock);
+
+	if (over) {
+		pthread_rwlock_wrlock(&cache->lock);
+		_hb_cache_evict(cache);
+		pthread_rwlock_unlock(&cache->lock);
+	}
+}
@@ -0,0 +1,378 @@
+#include <hb/cast.h>
+#include <hb/ccd.h>
+#include <hb/collision_flags.h>
+#include <hb/geometry.h>
+#include <hb/grid.h>
+#include <hb/stadium.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/* casts sharing a grid query and a pass over the walls */
+#define _HB_CAST_PACKET 4
+
+/////////////vector
+
+/* the lanes are casts of one packet against the same wall, worked out
+   as hb_ccd does it */
+#if defined(__AVX__)
+#define _HB_CAST_LANES 4
+typedef __m256d _hb_cast_vec;
+#define _hb_v_set1 _mm256_set1_pd
+#define _hb_v_add _mm256_add_pd
+#define _hb_v_sub _mm256_sub_pd
+#define _hb_v_mul _mm256_mul_pd
+#define _hb_v_div _mm256_div_pd
+#define _hb_v_or _mm256_or_pd
+#define _hb_v_blend(a,b,m) _mm256_blendv_pd(a, b, m)
+#define _hb_v_lt(a,b) _mm256_cmp_pd(a, b, _CMP_LT_OQ)
+#define _hb_v_le(a,b) _mm256_cmp_pd(a, b, _CMP_LE_OQ)
+#define _hb_v_gt(a,b) _mm256_cmp_pd(a, b, _CMP_GT_OQ)
+#define _hb_v_ge(a,b) _mm256_cmp_pd(a, b, _CMP_GE_OQ)
+#define _hb_v_bits _mm256_movemask_pd
+#define _hb_v_load _mm256_loadu_pd
+#define _hb_v_store _mm256_storeu_pd
+/* see narrowphase.c */
+#define _hb_v_done _mm256_zeroupper
+#elif defined(__SSE2__)
+#define _HB_CAST_LANES 2
+typedef __m128d _hb_cast_vec;
+#define _hb_v_set1 _mm_set1_pd
+#define _hb_v_add _mm_add_pd
+#define _hb_v_sub _mm_sub_pd
+#define _hb_v_mul _mm_mul_pd
+#define _hb_v_div _mm_div_pd
+#define _hb_v_or _mm_or_pd
+#define _hb_v_blend(a,b,m) _mm_or_pd(_mm_and_pd(m, b), _mm_andnot_pd(m, a))
+#define _hb_v_lt _mm_cmplt_pd
+#define _hb_v_le _mm_cmple_pd
+#define _hb_v_gt _mm_cmpgt_pd
+#define _hb_v_ge _mm_cmpge_pd
+#define _hb_v_bits _mm_movemask_pd
+#define _hb_v_load _mm_loadu_pd
+#define _hb_v_store _mm_storeu_pd
+#define _hb_v_done()
+#else
+#define _hb_v_done()
+#endif
+
+/* a packet, lanes past count repeat its first cast */
+struct _hb_cast_packet {
+	size_t                            count;
+	double                 x[_HB_CAST_PACKET];
+	double                 y[_HB_CAST_PACKET];
+	double                dx[_HB_CAST_PACKET];
+	double                dy[_HB_CAST_PACKET];
+	double                             radius;
+	struct hb_cast_hit   hit[_HB_CAST_PACKET];
+};
+
+/* what a wall gives every lane of a packet */
+struct _hb_cast_result {
+	unsigned                           bits;
+	double                 t[_HB_CAST_PACKET];
+	double          normal_x[_HB_CAST_PACKET];
+	double          normal_y[_HB_CAST_PACKET];
+};
+
+#ifdef _HB_CAST_LANES
+
+static unsigned
+_hb_cast_plane_lanes(const struct hb_geometry *g, size_t k,
+		const struct _hb_cast_packet *p, size_t l, struct _hb_cast_result *res)
+{
+	_hb_cast_vec nx, ny, r, f, fd, t, miss;
+
+	nx = _hb_v_set1(g->plane_normal_x[k]);
+	ny = _hb_v_set1(g->plane_normal_y[k]);
+	r = _hb_v_set1(p->radius);
+
+	f = _hb_v_sub(_hb_v_add(_hb_v_mul(nx, _hb_v_load(p->x + l)),
+				_hb_v_mul(ny, _hb_v_load(p->y + l))), _hb_v_set1(g->plane_dist[k]));
+	fd = _hb_v_add(_hb_v_mul(nx, _hb_v_load(p->dx + l)), _hb_v_mul(ny, _hb_v_load(p->dy + l)));
+	miss = _hb_v_or(_hb_v_lt(f, r), _hb_v_ge(fd, _hb_v_set1(0.0)));
+	t = _hb_v_div(_hb_v_sub(r, f), fd);
+	miss = _hb_v_or(miss, _hb_v_gt(t, _hb_v_set1(1.0)));
+
+	_hb_v_store(res->t + l, t);
+	_hb_v_store(res->normal_x + l, nx);
+	_hb_v_store(res->normal_y + l, ny);
+	return ~_hb_v_bits(miss) & ((1u << _HB_CAST_LANES) - 1);
+}
+
+static unsigned
+_hb_cast_straight_lanes(const struct hb_geometry *g, size_t k,
+		const struct _hb_cast_packet *p, size_t l, struct _hb_cast_result *res)
+{
+	_hb_cast_vec x, y, dx, dy, nx, ny, v0x, v0y, v1x, v1y, ex, ey, r, zero,
+		f, fd, s, t, px, py, miss;
+
+	x = _hb_v_load(p->x + l);
+	y = _hb_v_load(p->y + l);
+	dx = _hb_v_load(p->dx + l);
+	dy = _hb_v_load(p->dy + l);
+	nx = _hb_v_set1(g->normal_x[k]);
+	ny = _hb_v_set1(g->normal_y[k]);
+	v0x = _hb_v_set1(g->v0_x[k]);
+	v0y = _hb_v_set1(g->v0_y[k]);
+	v1x = _hb_v_set1(g->v1_x[k]);
+	v1y = _hb_v_set1(g->v1_y[k]);
+	r = _hb_v_set1(p->radius);
+	zero = _hb_v_set1(0.0);
+
+	f = _hb_v_add(_hb_v_mul(nx, _hb_v_sub(x, v0x)), _hb_v_mul(ny, _hb_v_sub(y, v0y)));
+	fd = _hb_v_add(_hb_v_mul(nx, dx), _hb_v_mul(ny, dy));
+
+	/* the side the cast comes from, the one the bias faces if any */
+	if (g->bias[k] != 0)
+		s = _hb_v_set1(g->bias[k] > 0 ? 1 : -1);
+	else
+		s = _hb_v_blend(_hb_v_set1(-1.0), _hb_v_set1(1.0), _hb_v_gt(f, zero));
+	miss = _hb_v_or(_hb_v_lt(_hb_v_mul(s, f), r), _hb_v_ge(_hb_v_mul(s, fd), zero));
+
+	t = _hb_v_div(_hb_v_sub(_hb_v_mul(s, r), f), fd);
+	miss = _hb_v_or(miss, _hb_v_gt(t, _hb_v_set1(1.0)));
+
+	px = _hb_v_add(x, _hb_v_mul(dx, t));
+	py = _hb_v_add(y, _hb_v_mul(dy, t));
+	ex = _hb_v_sub(v1x, v0x);
+	ey = _hb_v_sub(v1y, v0y);
+	miss = _hb_v_or(miss, _hb_v_le(_hb_v_add(_hb_v_mul(_hb_v_sub(px, v0x), ex),
+					_hb_v_mul(_hb_v_sub(py, v0y), ey)), zero));
+	miss = _hb_v_or(miss, _hb_v_ge(_hb_v_add(_hb_v_mul(_hb_v_sub(px, v1x), ex),
+					_hb_v_mul(_hb_v_sub(py, v1y), ey)), zero));
+
+	_hb_v_store(res->t + l, t);
+	_hb_v_store(res->normal_x + l, _hb_v_mul(s, nx));
+	_hb_v_store(res->normal_y + l, _hb_v_mul(s, ny));
+	return ~_hb_v_bits(miss) & ((1u << _HB_CAST_LANES) - 1);
+}
+
+#endif
+
+/////////////walls
+
+typedef bool (*_hb_cast_one_fn)(const struct hb_geometry *, size_t, double, double,
+		double, double, double, struct hb_ccd_hit *);
+
+static void
+_hb_cast_one(_hb_cast_one_fn one, const struct hb_geometry *g, size_t k,
+		const struct _hb_cast_packet *p, struct _hb_cast_result *res)
+{
+	struct hb_ccd_hit hit;
+	size_t l;
+
+	res->bits = 0;
+	for (l = 0; l < p->count; ++l) {
+		if (!one(g, k, p->x[l], p->y[l], p->dx[l], p->dy[l], p->radius, &hit))
+			continue;
+		res->t[l] = hit.t;
+		res->normal_x[l] = hit.normal_x;
+		res->normal_y[l] = hit.normal_y;
+		res->bits |= 1u << l;
+	}
+}
+
+static void
+_hb_cast_plane(const struct hb_geometry *g, size_t k,
+		const struct _hb_cast_packet *p, struct _hb_cast_result *res)
+{
+#ifdef _HB_CAST_LANES
+	size_t l;
+	res->bits = 0;
+	for (l = 0; l < _HB_CAST_PACKET; l += _HB_CAST_LANES)
+		res->bits |= _hb_cast_plane_lanes(g, k, p, l, res) << l;
+	res->bits &= (1u << p->count) - 1;
+	_hb_v_done();
+#else
+	_hb_cast_one(hb_ccd_plane, g, k, p, res);
+#endif
+}
+
+static void
+_hb_cast_segment(const struct hb_geometry *g, size_t k,
+		const struct _hb_cast_packet *p, struct _hb_cast_result *res)
+{
+#ifdef _HB_CAST_LANES
+	size_t l;
+	if (!g->arc[k]) {
+		res->bits = 0;
+		for (l = 0; l < _HB_CAST_PACKET; l += _HB_CAST_LANES)
+			res->bits |= _hb_cast_straight_lanes(g, k, p, l, res) << l;
+		res->bits &= (1u << p->count) - 1;
+		_hb_v_done();
+		return;
+	}
+#endif
+	_hb_cast_one(hb_ccd_segment, g, k, p, res);
+}
+
+/* an earlier wall keeps a tie, as in hb_world_step */
+static void
+_hb_cast_keep(struct _hb_cast_packet *p, const struct _hb_cast_result *res,
+		enum hb_cast_element element, size_t k)
+{
+	struct hb_cast_hit *hit;
+	size_t l;
+
+	for (l = 0; l < p->count; ++l) {
+		hit = &p->hit[l];
+		if (!(res->bits >> l & 1) ||
+				(hit->element != HB_CAST_NONE && res->t[l] >= hit->t))
+			continue;
+		hit->t = res->t[l];
+		hit->normal_x = res->normal_x[l];
+		hit->normal_y = res->normal_y[l];
+		hit->element = element;
+		hit->index = k;
+	}
+}
+
+static void
+_hb_cast_packet(const struct hb_cast_index *index, struct _hb_cast_packet *p,
+		enum hb_collision_flags mask, uint32_t *segments, uint32_t *vertexes)
+{
+	const struct hb_geometry *g;
+	struct _hb_cast_result res;
+	size_t l, c, k, nsegments, nvertexes;
+	double min_x, min_y, max_x, max_y;
+
+	g = index->geometry;
+
+	for (l = 0; l < p->count; ++l) {
+		p->hit[l].t = 1;
+		p->hit[l].element = HB_CAST_NONE;
+		p->hit[l].normal_x = p->hit[l].normal_y = 0;
+		p->hit[l].index = 0;
+	}
+	for (; l < _HB_CAST_PACKET; ++l) {
+		p->x[l] = p->x[0];
+		p->y[l] = p->y[0];
+		p->dx[l] = p->dx[0];
+		p->dy[l] = p->dy[0];
+	}
+
+	for (k = 0; k < g->planes_count; ++k) {
+		if (!(g->plane_c_mask[k] & mask))
+			continue;
+		_hb_cast_plane(g, k, p, &res);
+		_hb_cast_keep(p, &res, HB_CAST_PLANE, k);
+	}
+
+	/* the box every cast of the packet sweeps */
+	min_x = min_y = INFINITY;
+	max_x = max_y = -INFINITY;
+	for (l = 0; l < p->count; ++l) {
+		min_x = fmin(min_x, fmin(p->x[l], p->x[l] + p->dx[l]));
+		min_y = fmin(min_y, fmin(p->y[l], p->y[l] + p->dy[l]));
+		max_x = fmax(max_x, fmax(p->x[l], p->x[l] + p->dx[l]));
+		max_y = fmax(max_y, fmax(p->y[l], p->y[l] + p->dy[l]));
+	}
+	hb_static_grid_query(index->grid, min_x - p->radius, min_y - p->radius,
+			max_x + p->radius, max_y + p->radius,
+			segments, &nsegments, vertexes, &nvertexes);
+
+	for (c = 0; c < nsegments; ++c) {
+		k = segments[c];
+		if (!(g->c_mask[k] & mask))
+			continue;
+		_hb_cast_segment(g, k, p, &res);
+		_hb_cast_keep(p, &res, HB_CAST_SEGMENT, k);
+	}
+
+	for (c = 0; p->radius > 0 && c < nvertexes; ++c) {
+		k = vertexes[c];
+		if (!(g->vertex_c_mask[k] & mask))
+			continue;
+		_hb_cast_one(hb_ccd_vertex, g, k, p, &res);
+		_hb_cast_keep(p, &res, HB_CAST_VERTEX, k);
+	}
+
+	for (l = 0; l < p->count; ++l)
+		p->hit[l].distance = p->hit[l].t * sqrt(p->dx[l] * p->dx[l] + p->dy[l] * p->dy[l]);
+}
+
+/////////////casts
+
+extern struct hb_cast_index *
+hb_cast_index_build(const struct hb_stadium *s, double cell_size)
+{
+	struct hb_cast_index *index;
+
+	if (NULL == (index = calloc(1, sizeof(struct hb_cast_index))))
+		return NULL;
+
+	if (NULL == (index->geometry = hb_stadium_compile(s)) ||
+			NULL == (index->grid = hb_static_grid_from_geometry(index->geometry,
+					cell_size))) {
+		hb_cast_index_free(index);
+		return NULL;
+	}
+
+	return index;
+}
+
+extern void
+hb_cast_index_free(struct hb_cast_index *index)
+{
+	if (!index)
+		return;
+	hb_geometry_free(index->geometry);
+	hb_static_grid_free(index->grid);
+	free(index);
+}
+
+extern long
+hb_circle_cast_batch(const struct hb_cast_index *index, const struct hb_ray *rays,
+		size_t n, double radius, enum hb_collision_flags mask,
+		struct hb_cast_hit *hits)
+{
+	struct _hb_cast_packet p;
+	uint32_t *segments, *vertexes;
+	size_t i, l;
+	long count;
+
+	segments = malloc((index->geometry->segments_count + 1) * sizeof(uint32_t));
+	vertexes = malloc((index->geometry->vertexes_count + 1) * sizeof(uint32_t));
+	if (!segments || !vertexes) {
+		free(segments);
+		free(vertexes);
+		return -1;
+	}
+
+	p.radius = radius > 0 ? radius : 0;
+	count = 0;
+
+	for (i = 0; i < n; i += p.count) {
+		p.count = n - i < _HB_CAST_PACKET ? n - i : _HB_CAST_PACKET;
+		for (l = 0; l < p.count; ++l) {
+			p.x[l] = rays[i + l].x;
+			p.y[l] = rays[i + l].y;
+			p.dx[l] = rays[i + l].dx;
+			p.dy[l] = rays[i + l].dy;
+		}
+		_hb_cast_packet(index, &p, mask, segments, vertexes);
+		for (l = 0; l < p.count; ++l) {
+			hits[i + l] = p.hit[l];
+			count += p.hit[l].element != HB_CAST_NONE;
+		}
+	}
+
+	free(segments);
+	free(vertexes);
+
+	return count;
+}
+
+extern long
+hb_raycast_batch(const struct hb_cast_index *index, const struct hb_ray *rays,
+		size_t n, enum hb_collision_flags mask, struct hb_cast_hit *hits)
+{
+	return hb_circle_cast_batch(index, rays, n, 0, mask, hits);
+}
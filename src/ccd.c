@@ -0,0 +1,159 @@
+#include <hb/ccd.h>
+#include <hb/geometry.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* the first t in [0, 1] where a point at qx, qy moving by dx, dy is at
+   distance rho from the origin, coming in when inward and going out
+   otherwise, or -1 */
+static double
+_hb_ccd_circle(double qx, double qy, double dx, double dy, double rho, bool inward)
+{
+	double a, b, c, disc, t;
+
+	a = dx * dx + dy * dy;
+	b = qx * dx + qy * dy;
+	c = qx * qx + qy * qy - rho * rho;
+
+	if (a == 0 || (inward ? c < 0 || b >= 0 : c > 0))
+		return -1;
+
+	disc = b * b - a * c;
+	if (disc < 0)
+		return -1;
+
+	t = inward ? (-b - sqrt(disc)) / a : (-b + sqrt(disc)) / a;
+	if (t < 0)
+		t = 0;
+
+	return t <= 1 ? t : -1;
+}
+
+static bool
+_hb_ccd_set(struct hb_ccd_hit *hit, double t, double nx, double ny)
+{
+	hit->t = t;
+	hit->normal_x = nx;
+	hit->normal_y = ny;
+	return true;
+}
+
+extern bool
+hb_ccd_plane(const struct hb_geometry *g, size_t k, double x, double y,
+		double dx, double dy, double r, struct hb_ccd_hit *hit)
+{
+	double f, fd, t;
+
+	f = g->plane_normal_x[k] * x + g->plane_normal_y[k] * y - g->plane_dist[k];
+	fd = g->plane_normal_x[k] * dx + g->plane_normal_y[k] * dy;
+
+	if (f < r || fd >= 0)
+		return false;
+
+	t = (r - f) / fd;
+	if (t > 1)
+		return false;
+
+	return _hb_ccd_set(hit, t, g->plane_normal_x[k], g->plane_normal_y[k]);
+}
+
+static bool
+_hb_ccd_straight(const struct hb_geometry *g, size_t k, double x, double y,
+		double dx, double dy, double r, struct hb_ccd_hit *hit)
+{
+	double f, fd, s, t, px, py, ex, ey;
+
+	f = g->normal_x[k] * (x - g->v0_x[k]) + g->normal_y[k] * (y - g->v0_y[k]);
+	fd = g->normal_x[k] * dx + g->normal_y[k] * dy;
+
+	/* the side the disc comes from, the one the bias faces if any */
+	s = g->bias[k] > 0 ? 1 : g->bias[k] < 0 ? -1 : f > 0 ? 1 : -1;
+	if (s * f < r || s * fd >= 0)
+		return false;
+
+	t = (s * r - f) / fd;
+	if (t > 1)
+		return false;
+
+	px = x + dx * t;
+	py = y + dy * t;
+	ex = g->v1_x[k] - g->v0_x[k];
+	ey = g->v1_y[k] - g->v0_y[k];
+	if ((px - g->v0_x[k]) * ex + (py - g->v0_y[k]) * ey <= 0 ||
+			(px - g->v1_x[k]) * ex + (py - g->v1_y[k]) * ey >= 0)
+		return false;
+
+	return _hb_ccd_set(hit, t, s * g->normal_x[k], s * g->normal_y[k]);
+}
+
+/* one side of arc k, at rho from its center */
+static bool
+_hb_ccd_arc_side(const struct hb_geometry *g, size_t k, double qx, double qy,
+		double dx, double dy, double rho, bool outside, struct hb_ccd_hit *hit)
+{
+	double t, px, py, len;
+
+	if ((t = _hb_ccd_circle(qx, qy, dx, dy, rho, outside)) < 0)
+		return false;
+
+	px = qx + dx * t;
+	py = qy + dy * t;
+	len = sqrt(px * px + py * py);
+	if (len == 0 || !hb_geometry_arc_contains(g, k, px, py))
+		return false;
+
+	if (outside)
+		return _hb_ccd_set(hit, t, px / len, py / len);
+	return _hb_ccd_set(hit, t, -px / len, -py / len);
+}
+
+/* the disc touches an arc from outside at radius + r and from inside
+   at radius - r, a bias leaves only the side it faces */
+static bool
+_hb_ccd_arc(const struct hb_geometry *g, size_t k, double x, double y,
+		double dx, double dy, double r, struct hb_ccd_hit *hit)
+{
+	struct hb_ccd_hit inner;
+	double qx, qy;
+	bool found;
+
+	qx = x - g->center_x[k];
+	qy = y - g->center_y[k];
+
+	found = g->bias[k] <= 0 &&
+		_hb_ccd_arc_side(g, k, qx, qy, dx, dy, g->radius[k] + r, true, hit);
+
+	if (g->bias[k] >= 0 && g->radius[k] > r &&
+			_hb_ccd_arc_side(g, k, qx, qy, dx, dy, g->radius[k] - r, false, &inner) &&
+			(!found || inner.t < hit->t)) {
+		*hit = inner;
+		found = true;
+	}
+
+	return found;
+}
+
+extern bool
+hb_ccd_segment(const struct hb_geometry *g, size_t k, double x, double y,
+		double dx, double dy, double r, struct hb_ccd_hit *hit)
+{
+	if (g->arc[k])
+		return _hb_ccd_arc(g, k, x, y, dx, dy, r, hit);
+	return _hb_ccd_straight(g, k, x, y, dx, dy, r, hit);
+}
+
+extern bool
+hb_ccd_vertex(const struct hb_geometry *g, size_t k, double x, double y,
+		double dx, double dy, double r, struct hb_ccd_hit *hit)
+{
+	double qx, qy, t;
+
+	qx = x - g->vertex_x[k];
+	qy = y - g->vertex_y[k];
+
+	if ((t = _hb_ccd_circle(qx, qy, dx, dy, r, true)) < 0 || r <= 0)
+		return false;
+
+	return _hb_ccd_set(hit, t, (qx + dx * t) / r, (qy + dy * t) / r);
+}
@@ -0,0 +1,275 @@
+#include <hb/stadium.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define _HB_CLONE_ALIGN(n) (((n) + 15) & ~(size_t)15)
+
+static const struct {
+	unsigned                        section;
+	size_t                           offset;
+	size_t                             size;
+} _hb_clone_lists[] = {
+	{ HB_STADIUM_SECTION_VERTEXES, offsetof(struct hb_stadium, vertexes), sizeof(struct hb_vertex) },
+	{ HB_STADIUM_SECTION_SEGMENTS, offsetof(struct hb_stadium, segments), sizeof(struct hb_segment) },
+	{ HB_STADIUM_SECTION_GOALS, offsetof(struct hb_stadium, goals), sizeof(struct hb_goal) },
+	{ HB_STADIUM_SECTION_DISCS, offsetof(struct hb_stadium, discs), sizeof(struct hb_disc) },
+	{ HB_STADIUM_SECTION_PLANES, offsetof(struct hb_stadium, planes), sizeof(struct hb_plane) },
+	{ HB_STADIUM_SECTION_JOINTS, offsetof(struct hb_stadium, joints), sizeof(struct hb_joint) },
+	{ HB_STADIUM_SECTION_RED_SPAWN_POINTS, offsetof(struct hb_stadium, red_spawn_points), sizeof(struct hb_point) },
+	{ HB_STADIUM_SECTION_BLUE_SPAWN_POINTS, offsetof(struct hb_stadium, blue_spawn_points), sizeof(struct hb_point) }
+};
+
+#define _HB_CLONE_LISTS (sizeof(_hb_clone_lists) / sizeof(_hb_clone_lists[0]))
+
+static void ***
+_hb_clone_list(struct hb_stadium *s, size_t l)
+{
+	return (void ***)((char *)s + _hb_clone_lists[l].offset);
+}
+
+static size_t
+_hb_clone_count(void *const *list)
+{
+	size_t count;
+	count = 0;
+	if (list)
+		while (list[count])
+			++count;
+	return count;
+}
+
+static void
+_hb_clone_free_list(void **list, size_t count)
+{
+	size_t i;
+	for (i = 0; i < count; ++i)
+		free(list[i]);
+	free(list);
+}
+
+/* copies a list the way the parser lays it out, one allocation each */
+static void **
+_hb_clone_copy_list(void *const *list, size_t size)
+{
+	void **out;
+	size_t count, i;
+
+	count = _hb_clone_count(list);
+
+	if (NULL == (out = calloc(count + 1, sizeof(void *))))
+		return NULL;
+
+	for (i = 0; i < count; ++i) {
+		if (NULL == (out[i] = malloc(size))) {
+			_hb_clone_free_list(out, i);
+			return NULL;
+		}
+		memcpy(out[i], list[i], size);
+	}
+
+	return out;
+}
+
+static struct hb_trait **
+_hb_clone_copy_traits(struct hb_trait *const *traits)
+{
+	struct hb_trait **out;
+	size_t count, i;
+
+	count = _hb_clone_count((void *const *)traits);
+
+	if (NULL == (out = calloc(count + 1, sizeof(*out))))
+		return NULL;
+
+	for (i = 0; i < count; ++i) {
+		if (NULL == (out[i] = malloc(sizeof(**out))))
+			goto err;
+		*out[i] = *traits[i];
+		if (traits[i]->name && NULL == (out[i]->name = strdup(traits[i]->name))) {
+			free(out[i]);
+			goto err;
+		}
+	}
+
+	return out;
+
+err:
+	while (i-- > 0) {
+		free(out[i]->name);
+		free(out[i]);
+	}
+	free(out);
+	return NULL;
+}
+
+static void *
+_hb_clone_copy(const void *p, size_t size)
+{
+	void *out;
+	if (NULL != (out = malloc(size)))
+		memcpy(out, p, size);
+	return out;
+}
+
+extern struct hb_stadium *
+hb_stadium_clone(const struct hb_stadium *s, unsigned copy)
+{
+	struct hb_stadium *clone;
+	void *const *from;
+	void **to;
+	char *block;
+	size_t l, i, count, size, offset;
+
+	copy = (copy | HB_STADIUM_SECTION_DISCS) & (HB_STADIUM_SECTION_VERTEXES |
+			HB_STADIUM_SECTION_SEGMENTS | HB_STADIUM_SECTION_GOALS |
+			HB_STADIUM_SECTION_DISCS | HB_STADIUM_SECTION_PLANES |
+			HB_STADIUM_SECTION_JOINTS | HB_STADIUM_SECTION_RED_SPAWN_POINTS |
+			HB_STADIUM_SECTION_BLUE_SPAWN_POINTS);
+
+	size = _HB_CLONE_ALIGN(sizeof(*clone));
+
+	for (l = 0; l < _HB_CLONE_LISTS; ++l) {
+		if (!(copy & _hb_clone_lists[l].section))
+			continue;
+		count = _hb_clone_count(*_hb_clone_list((struct hb_stadium *)s, l));
+		size += _HB_CLONE_ALIGN((count + 1) * sizeof(void *));
+		size += _HB_CLONE_ALIGN(count * _hb_clone_lists[l].size);
+	}
+
+	if (NULL == (block = malloc(size)))
+		return NULL;
+
+	clone = (struct hb_stadium *)block;
+	*clone = *s;
+	clone->borrowed = HB_STADIUM_SECTION_ALL;
+	clone->tessellation = NULL;
+	offset = _HB_CLONE_ALIGN(sizeof(*clone));
+
+	for (l = 0; l < _HB_CLONE_LISTS; ++l) {
+		if (!(copy & _hb_clone_lists[l].section))
+			continue;
+
+		from = *_hb_clone_list((struct hb_stadium *)s, l);
+		count = _hb_clone_count(from);
+
+		to = (void **)(block + offset);
+		offset += _HB_CLONE_ALIGN((count + 1) * sizeof(void *));
+
+		for (i = 0; i < count; ++i)
+			to[i] = block + offset + i * _hb_clone_lists[l].size;
+		to[count] = NULL;
+
+		for (i = 0; i < count; ++i)
+			memcpy(to[i], from[i], _hb_clone_lists[l].size);
+
+		offset += _HB_CLONE_ALIGN(count * _hb_clone_lists[l].size);
+		*_hb_clone_list(clone, l) = from ? to : NULL;
+	}
+
+	if (s->discs && s->ball_physics == s->discs[0])
+		clone->ball_physics = clone->discs[0];
+
+	return clone;
+}
+
+static const struct hb_trait *
+_hb_clone_trait(struct hb_trait *const *from, struct hb_trait *const *to,
+		const struct hb_trait *trait)
+{
+	size_t i;
+	if (trait)
+		for (i = 0; from[i]; ++i)
+			if (from[i] == trait)
+				return to[i];
+	return trait;
+}
+
+#define _HB_CLONE_REMAP_TRAITS(list) \
+	do { \
+		size_t i; \
+		if (copy.list) \
+			for (i = 0; copy.list[i]; ++i) \
+				copy.list[i]->trait = _hb_clone_trait(s->traits, \
+						copy.traits, copy.list[i]->trait); \
+	} while (0)
+
+extern int
+hb_stadium_unshare(struct hb_stadium *s, unsigned sections)
+{
+	struct hb_stadium copy;
+	void **lists[_HB_CLONE_LISTS];
+	size_t l;
+
+	/* elements point at their trait, so they move along with the traits */
+	if (sections & s->borrowed & HB_STADIUM_SECTION_TRAITS)
+		sections |= HB_STADIUM_SECTION_VERTEXES | HB_STADIUM_SECTION_SEGMENTS |
+			HB_STADIUM_SECTION_DISCS | HB_STADIUM_SECTION_PLANES;
+
+	sections &= s->borrowed;
+	copy = *s;
+	memset(lists, 0, sizeof(lists));
+
+	/* allocate everything first so s stays as it was on failure */
+	if ((sections & HB_STADIUM_SECTION_NAME) &&
+			NULL == (copy.name = strdup(s->name)))
+		goto err;
+
+	if ((sections & HB_STADIUM_SECTION_BG) && s->bg &&
+			NULL == (copy.bg = _hb_clone_copy(s->bg, sizeof(*s->bg))))
+		goto err;
+
+	if ((sections & HB_STADIUM_SECTION_PLAYER_PHYSICS) && s->player_physics &&
+			NULL == (copy.player_physics = _hb_clone_copy(s->player_physics,
+					sizeof(*s->player_physics))))
+		goto err;
+
+	if ((sections & HB_STADIUM_SECTION_TRAITS) && s->traits &&
+			NULL == (copy.traits = _hb_clone_copy_traits(s->traits)))
+		goto err;
+
+	for (l = 0; l < _HB_CLONE_LISTS; ++l) {
+		if (!(sections & _hb_clone_lists[l].section) || !*_hb_clone_list(s, l))
+			continue;
+		if (NULL == (lists[l] = _hb_clone_copy_list(*_hb_clone_list(s, l),
+						_hb_clone_lists[l].size)))
+			goto err;
+		*_hb_clone_list(&copy, l) = lists[l];
+	}
+
+	if (s->discs && s->ball_physics == s->discs[0])
+		copy.ball_physics = copy.discs[0];
+
+	copy.borrowed &= ~sections;
+
+	if (copy.traits != s->traits) {
+		_HB_CLONE_REMAP_TRAITS(vertexes);
+		_HB_CLONE_REMAP_TRAITS(segments);
+		_HB_CLONE_REMAP_TRAITS(discs);
+		_HB_CLONE_REMAP_TRAITS(planes);
+	}
+
+	*s = copy;
+
+	return 0;
+
+err:
+	for (l = 0; l < _HB_CLONE_LISTS; ++l)
+		if (lists[l])
+			_hb_clone_free_list(lists[l], _hb_clone_count(lists[l]));
+
+	if (copy.traits && copy.traits != s->traits) {
+		for (l = 0; copy.traits[l]; ++l) {
+			free(copy.traits[l]->name);
+			free(copy.traits[l]);
+		}
+		free(copy.traits);
+	}
+
+	if (copy.name != s->name) free(copy.name);
+	if (copy.bg != s->bg) free(copy.bg);
+	if (copy.player_physics != s->player_physics) free(copy.player_physics);
+
+	return -1;
+}
@@ -0,0 +1,86 @@
+#include <hb/collision_table.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int
+_hb_collision_table_grow(struct hb_collision_table *t)
+{
+	enum hb_collision_flags *p;
+	uint64_t *bits;
+	size_t words, i;
+
+	words = t->words ? t->words * 2 : 1;
+
+	if (NULL == (bits = calloc(words * 64 * words, sizeof(uint64_t))))
+		return -1;
+
+	if (NULL == (p = realloc(t->c_group, words * 64 * sizeof(*p)))) {
+		free(bits);
+		return -1;
+	}
+	t->c_group = p;
+
+	if (NULL == (p = realloc(t->c_mask, words * 64 * sizeof(*p)))) {
+		free(bits);
+		return -1;
+	}
+	t->c_mask = p;
+
+	for (i = 0; i < t->count; ++i)
+		memcpy(bits + i * words, t->bits + i * t->words, t->words * sizeof(uint64_t));
+
+	free(t->bits);
+	t->bits = bits;
+	t->words = words;
+	t->capacity = words * 64;
+
+	return 0;
+}
+
+extern struct hb_collision_table *
+hb_collision_table_create(void)
+{
+	return calloc(1, sizeof(struct hb_collision_table));
+}
+
+extern void
+hb_collision_table_free(struct hb_collision_table *t)
+{
+	if (!t)
+		return;
+	free(t->c_group);
+	free(t->c_mask);
+	free(t->bits);
+	free(t);
+}
+
+extern long
+hb_collision_table_add(struct hb_collision_table *t,
+		enum hb_collision_flags c_group, enum hb_collision_flags c_mask)
+{
+	size_t i, k;
+
+	/* there are only ever a handful of them */
+	for (i = 0; i < t->count; ++i)
+		if (t->c_group[i] == c_group && t->c_mask[i] == c_mask)
+			return i;
+
+	if (t->count == t->capacity && _hb_collision_table_grow(t) < 0)
+		return -1;
+
+	k = t->count++;
+	t->c_group[k] = c_group;
+	t->c_mask[k] = c_mask;
+
+	for (i = 0; i <= k; ++i) {
+		if ((c_group & t->c_mask[i]) == 0 || (c_mask & t->c_group[i]) == 0)
+			continue;
+		t->bits[k * t->words + i / 64] |= (uint64_t)1 << (i % 64);
+		t->bits[i * t->words + k / 64] |= (uint64_t)1 << (k % 64);
+	}
+
+	return k;
+}
@@ -0,0 +1,1116 @@
+#include <hb/diff.h>
+#include <hb/stadium.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define _HB_DELTA_MAGIC0 'h'
+#define _HB_DELTA_MAGIC1 'd'
+#define _HB_DELTA_VERSION 1
+
+enum _hb_delta_tag {
+	_HB_DELTA_END,
+	_HB_DELTA_NAME,
+	_HB_DELTA_SCALARS,
+	_HB_DELTA_BG,
+	_HB_DELTA_PLAYER_PHYSICS,
+	_HB_DELTA_LIST
+};
+
+enum _hb_field_kind {
+	_HB_FIELD_DOUBLE,
+	_HB_FIELD_INT,
+	_HB_FIELD_INDEX,
+	_HB_FIELD_UINT,
+	_HB_FIELD_BOOL,
+	_HB_FIELD_TRAIT,
+	_HB_FIELD_OVERRIDES
+};
+
+/* trait is the enum hb_trait_field a field can take from a trait, a
+   delta setting it makes it the element's own */
+struct _hb_field {
+	size_t                           offset;
+	enum _hb_field_kind                kind;
+	unsigned                          trait;
+};
+
+struct _hb_list_kind {
+	unsigned                        section;
+	size_t                           offset;
+	size_t                             size;
+	const struct _hb_field          *fields;
+	size_t                            count;
+	int                                 ref;
+};
+
+union _hb_element {
+	struct hb_vertex                 vertex;
+	struct hb_segment               segment;
+	struct hb_goal                     goal;
+	struct hb_disc                     disc;
+	struct hb_plane                   plane;
+	struct hb_joint                   joint;
+	struct hb_point                   point;
+	struct hb_background                 bg;
+	struct hb_player_physics             pp;
+};
+
+#define _HB_FIELD(type,member,kind) { offsetof(type, member), kind, 0 }
+#define _HB_TRAIT_FIELD(type,member,kind,trait) { offsetof(type, member), kind, trait }
+#define _HB_COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+/////////////fields
+static const struct _hb_field _hb_scalar_fields[] = {
+	_HB_FIELD(struct hb_stadium, width, _HB_FIELD_DOUBLE),
+	_HB_FIELD(struct hb_stadium, height, _HB_FIELD_DOUBLE),
+	_HB_FIELD(struct hb_stadium, camera_width, _HB_FIELD_DOUBLE),
+	_HB_FIELD(struct hb_stadium, camera_height, _HB_FIELD_DOUBLE),
+	_HB_FIELD(struct hb_stadium, max_view_width, _HB_FIELD_DOUBLE),
+	_HB_FIELD(struct hb_stadium, camera_follow, _HB_FIELD_INT),
+	_HB_FIELD(struct hb_stadium, spawn_distance, _HB_FIELD_DOUBLE),
+	_HB_FIELD(struct hb_stadium, can_be_stored, _HB_FIELD_BOOL),
+	_HB_FIELD(struct hb_stadium, kick_off_reset, _HB_FIELD_INT)
+};
+
+static const struct _hb_field _hb_bg_fields[] = {
+	_HB_FIELD(struct hb_background, type, _HB_FIELD_INT),
+	_HB_FIELD(struct hb_background, width, _HB_FIELD_DOUBLE),
+	_HB_FIELD(struct hb_background, height, _HB_FIELD_DOUBLE),
+	_HB_FIELD(struct hb_background, kick_off_radius, _HB_FIELD_DOUBLE),
+	_HB_FIELD(struct hb_background, corner_radius, _HB_FIELD_DOUBLE),
+	_HB_FIELD(struct hb_background, goal_line, _HB_FIELD_DOUBLE),
+	_HB_FIELD(struct hb_background, color, _HB_FIELD_UINT)
+};
+
+static const struct _hb_field _hb_player_physics_fields[] = {
+	_HB_FIELD(struct hb_player_physics, gravity[0], _HB_FIELD_DOUBLE),
+	_HB_FIELD(struct hb_player_physics, gravity[1], _HB_FIELD_DOUBLE),
+	_HB_FIELD(struct hb_player_physics, radius, _HB_FIELD_DOUBLE),
+	_HB_FIELD(struct hb_player_physics, inv_mass, _HB_FIELD_DOUBLE),
+	_HB_FIELD(struct hb_player_physics, b_coef, _HB_FIELD_DOUBLE),
+	_HB_FIELD(struct hb_player_physics, damping, _HB_FIELD_DOUBLE),
+	_HB_FIELD(struct hb_player_physics, c_group, _HB_FIELD_INT),
+	_HB_FIELD(struct hb_player_physics, acceleration, _HB_FIELD_DOUBLE),
+	_HB_FIELD(struct hb_player_physics, kicking_acceleration, _HB_FIELD_DOUBLE),
+	_HB_FIELD(struct hb_player_physics, kicking_damping, _HB_FIELD_DOUBLE),
+	_HB_FIELD(struct hb_player_physics, kick_strength, _HB_FIELD_DOUBLE),
+	_HB_FIELD(struct hb_player_physics, kickback, _HB_FIELD_DOUBLE)
+};
+
+static const struct _hb_field _hb_vertex_fields[] = {
+	_HB_FIELD(struct hb_vertex, x, _HB_FIELD_DOUBLE),
+	_HB_FIELD(struct hb_vertex, y, _HB_FIELD_DOUBLE),
+	_HB_TRAIT_FIELD(struct hb_vertex, b_coef, _HB_FIELD_DOUBLE, HB_TRAIT_FIELD_B_COEF),
+	_HB_TRAIT_FIELD(struct hb_vertex, c_group, _HB_FIELD_INT, HB_TRAIT_FIELD_C_GROUP),
+	_HB_TRAIT_FIELD(struct hb_vertex, c_mask, _HB_FIELD_INT, HB_TRAIT_FIELD_C_MASK),
+	_HB_FIELD(struct hb_vertex, trait, _HB_FIELD_TRAIT),
+	_HB_FIELD(struct hb_vertex, overrides, _HB_FIELD_OVERRIDES)
+};
+
+static const struct _hb_field _hb_segment_fields[] = {
+	_HB_FIELD(struct hb_segment, v0, _HB_FIELD_INDEX),
+	_HB_FIELD(struct hb_segment, v1, _HB_FIELD_INDEX),
+	_HB_TRAIT_FIELD(struct hb_segment, b_coef, _HB_FIELD_DOUBLE, HB_TRAIT_FIELD_B_COEF),
+	_HB_FIELD(struct hb_segment, curve, _HB_FIELD_DOUBLE),
+	_HB_FIELD(struct hb_segment, bias, _HB_FIELD_DOUBLE),
+	_HB_TRAIT_FIELD(struct hb_segment, c_group, _HB_FIELD_INT, HB_TRAIT_FIELD_C_GROUP),
+	_HB_TRAIT_FIELD(struct hb_segment, c_mask, _HB_FIELD_INT, HB_TRAIT_FIELD_C_MASK),
+	_HB_TRAIT_FIELD(struct hb_segment, vis, _HB_FIELD_BOOL, HB_TRAIT_FIELD_VIS),
+	_HB_TRAIT_FIELD(struct hb_segment, color, _HB_FIELD_UINT, HB_TRAIT_FIELD_COLOR),
+	_HB_FIELD(struct hb_segment, trait, _HB_FIELD_TRAIT),
+	_HB_FIELD(struct hb_segment, overrides, _HB_FIELD_OVERRIDES)
+};
+
+static const struct _hb_field _hb_goal_fields[] = {
+	_HB_FIELD(struct hb_goal, p0[0], _HB_FIELD_DOUBLE),
+	_HB_FIELD(struct hb_goal, p0[1], _HB_FIELD_DOUBLE),
+	_HB_FIELD(struct hb_goal, p1[0], _HB_FIELD_DOUBLE),
+	_HB_FIELD(struct hb_goal, p1[1], _HB_FIELD_DOUBLE),
+	_HB_FIELD(struct hb_goal, team, _HB_FIELD_INT)
+};
+
+static const struct _hb_field _hb_disc_fields[] = {
+	_HB_FIELD(struct hb_disc, pos[0], _HB_FIELD_DOUBLE),
+	_HB_FIELD(struct hb_disc, pos[1], _HB_FIELD_DOUBLE),
+	_HB_FIELD(struct hb_disc, speed[0], _HB_FIELD_DOUBLE),
+	_HB_FIELD(struct hb_disc, speed[1], _HB_FIELD_DOUBLE),
+	_HB_FIELD(struct hb_disc, gravity[0], _HB_FIELD_DOUBLE),
+	_HB_FIELD(struct hb_disc, gravity[1], _HB_FIELD_DOUBLE),
+	_HB_TRAIT_FIELD(struct hb_disc, radius, _HB_FIELD_DOUBLE, HB_TRAIT_FIELD_RADIUS),
+	_HB_TRAIT_FIELD(struct hb_disc, inv_mass, _HB_FIELD_DOUBLE, HB_TRAIT_FIELD_INV_MASS),
+	_HB_FIELD(struct hb_disc, damping, _HB_FIELD_DOUBLE),
+	_HB_TRAIT_FIELD(struct hb_disc, color, _HB_FIELD_UINT, HB_TRAIT_FIELD_COLOR),
+	_HB_TRAIT_FIELD(struct hb_disc, b_coef, _HB_FIELD_DOUBLE, HB_TRAIT_FIELD_B_COEF),
+	_HB_TRAIT_FIELD(struct hb_disc, c_mask, _HB_FIELD_INT, HB_TRAIT_FIELD_C_MASK),
+	_HB_TRAIT_FIELD(struct hb_disc, c_group, _HB_FIELD_INT, HB_TRAIT_FIELD_C_GROUP),
+	_HB_FIELD(struct hb_disc, trait, _HB_FIELD_TRAIT),
+	_HB_FIELD(struct hb_disc, overrides, _HB_FIELD_OVERRIDES)
+};
+
+static const struct _hb_field _hb_plane_fields[] = {
+	_HB_FIELD(struct hb_plane, normal[0], _HB_FIELD_DOUBLE),
+	_HB_FIELD(struct hb_plane, normal[1], _HB_FIELD_DOUBLE),
+	_HB_FIELD(struct hb_plane, dist, _HB_FIELD_DOUBLE),
+	_HB_TRAIT_FIELD(struct hb_plane, b_coef, _HB_FIELD_DOUBLE, HB_TRAIT_FIELD_B_COEF),
+	_HB_TRAIT_FIELD(struct hb_plane, c_mask, _HB_FIELD_INT, HB_TRAIT_FIELD_C_MASK),
+	_HB_TRAIT_FIELD(struct hb_plane, c_group, _HB_FIELD_INT, HB_TRAIT_FIELD_C_GROUP),
+	_HB_FIELD(struct hb_plane, trait, _HB_FIELD_TRAIT),
+	_HB_FIELD(struct hb_plane, overrides, _HB_FIELD_OVERRIDES)
+};
+
+static const struct _hb_field _hb_joint_fields[] = {
+	_HB_FIELD(struct hb_joint, d0, _HB_FIELD_INDEX),
+	_HB_FIELD(struct hb_joint, d1, _HB_FIELD_INDEX),
+	_HB_FIELD(struct hb_joint, length.kind, _HB_FIELD_INT),
+	_HB_FIELD(struct hb_joint, length.val.range[0], _HB_FIELD_DOUBLE),
+	_HB_FIELD(struct hb_joint, length.val.range[1], _HB_FIELD_DOUBLE),
+	_HB_FIELD(struct hb_joint, strength.is_rigid, _HB_FIELD_BOOL),
+	_HB_FIELD(struct hb_joint, strength.val, _HB_FIELD_DOUBLE),
+	_HB_FIELD(struct hb_joint, color, _HB_FIELD_UINT)
+};
+
+static const struct _hb_field _hb_point_fields[] = {
+	_HB_FIELD(struct hb_point, x, _HB_FIELD_DOUBLE),
+	_HB_FIELD(struct hb_point, y, _HB_FIELD_DOUBLE)
+};
+
+#define _HB_LIST_VERTEXES 0
+#define _HB_LIST_DISCS    3
+
+static const struct _hb_list_kind _hb_lists[] = {
+	{ HB_STADIUM_SECTION_VERTEXES, offsetof(struct hb_stadium, vertexes), sizeof(struct hb_vertex),
+		_hb_vertex_fields, _HB_COUNT(_hb_vertex_fields), -1 },
+	{ HB_STADIUM_SECTION_SEGMENTS, offsetof(struct hb_stadium, segments), sizeof(struct hb_segment),
+		_hb_segment_fields, _HB_COUNT(_hb_segment_fields), _HB_LIST_VERTEXES },
+	{ HB_STADIUM_SECTION_GOALS, offsetof(struct hb_stadium, goals), sizeof(struct hb_goal),
+		_hb_goal_fields, _HB_COUNT(_hb_goal_fields), -1 },
+	{ HB_STADIUM_SECTION_DISCS, offsetof(struct hb_stadium, discs), sizeof(struct hb_disc),
+		_hb_disc_fields, _HB_COUNT(_hb_disc_fields), -1 },
+	{ HB_STADIUM_SECTION_PLANES, offsetof(struct hb_stadium, planes), sizeof(struct hb_plane),
+		_hb_plane_fields, _HB_COUNT(_hb_plane_fields), -1 },
+	{ HB_STADIUM_SECTION_JOINTS, offsetof(struct hb_stadium, joints), sizeof(struct hb_joint),
+		_hb_joint_fields, _HB_COUNT(_hb_joint_fields), _HB_LIST_DISCS },
+	{ HB_STADIUM_SECTION_RED_SPAWN_POINTS, offsetof(struct hb_stadium, red_spawn_points), sizeof(struct hb_point),
+		_hb_point_fields, _HB_COUNT(_hb_point_fields), -1 },
+	{ HB_STADIUM_SECTION_BLUE_SPAWN_POINTS, offsetof(struct hb_stadium, blue_spawn_points), sizeof(struct hb_point),
+		_hb_point_fields, _HB_COUNT(_hb_point_fields), -1 }
+};
+
+#define _HB_LISTS _HB_COUNT(_hb_lists)
+
+/* where the elements of a list went, an index past the end of the old
+   list is kept as it is */
+struct _hb_list_map {
+	size_t                               na;
+	size_t                               at;
+	size_t                          removed;
+	size_t                         inserted;
+};
+
+static void **
+_hb_list_get(const struct hb_stadium *s, size_t l)
+{
+	return *(void ***)((char *)s + _hb_lists[l].offset);
+}
+
+static void
+_hb_list_set(struct hb_stadium *s, size_t l, void **list)
+{
+	*(void ***)((char *)s + _hb_lists[l].offset) = list;
+}
+
+static size_t
+_hb_list_count(void *const *list)
+{
+	size_t count;
+	count = 0;
+	if (list)
+		while (list[count])
+			++count;
+	return count;
+}
+
+static bool
+_hb_list_map_is_identity(const struct _hb_list_map *map)
+{
+	return map->removed == 0 && map->inserted == 0;
+}
+
+static int
+_hb_list_map_index(const struct _hb_list_map *map, int i)
+{
+	if (i < 0 || (size_t)i >= map->na || (size_t)i < map->at)
+		return i;
+	if ((size_t)i < map->at + map->removed)
+		return -1;
+	return i - (int)map->removed + (int)map->inserted;
+}
+
+/////////////fields
+static size_t
+_hb_field_size(const struct _hb_field *f)
+{
+	switch (f->kind) {
+	case _HB_FIELD_DOUBLE: return sizeof(double);
+	case _HB_FIELD_INT:
+	case _HB_FIELD_INDEX: return sizeof(int);
+	case _HB_FIELD_UINT: return sizeof(uint32_t);
+	case _HB_FIELD_BOOL: return sizeof(bool);
+	case _HB_FIELD_TRAIT: return sizeof(const struct hb_trait *);
+	case _HB_FIELD_OVERRIDES: return sizeof(unsigned);
+	}
+	return 0;
+}
+
+static int
+_hb_field_int(const void *e, const struct _hb_field *f)
+{
+	int v;
+	memcpy(&v, (const char *)e + f->offset, sizeof(v));
+	return v;
+}
+
+static void
+_hb_field_set_int(void *e, const struct _hb_field *f, int v)
+{
+	memcpy((char *)e + f->offset, &v, sizeof(v));
+}
+
+static const struct hb_trait *
+_hb_field_trait(const void *e, const struct _hb_field *f)
+{
+	const struct hb_trait *t;
+	memcpy(&t, (const char *)e + f->offset, sizeof(t));
+	return t;
+}
+
+/* traits belong to their stadium, they are told apart by name */
+static const char *
+_hb_field_trait_name(const void *e, const struct _hb_field *f)
+{
+	const struct hb_trait *t;
+	t = _hb_field_trait(e, f);
+	return t && t->name ? t->name : NULL;
+}
+
+/* a's index fields are looked at through map, so elements whose vertexes
+   or discs only moved still compare equal */
+static bool
+_hb_field_equal(const void *a, const void *b, const struct _hb_field *f,
+		const struct _hb_list_map *map)
+{
+	const char *na, *nb;
+
+	if (f->kind == _HB_FIELD_INDEX && map)
+		return _hb_list_map_index(map, _hb_field_int(a, f)) == _hb_field_int(b, f);
+	if (f->kind == _HB_FIELD_TRAIT) {
+		na = _hb_field_trait_name(a, f);
+		nb = _hb_field_trait_name(b, f);
+		return na == nb || (na && nb && !strcmp(na, nb));
+	}
+	return !memcmp((const char *)a + f->offset, (const char *)b + f->offset,
+			_hb_field_size(f));
+}
+
+static uint64_t
+_hb_fields_diff(const void *a, const void *b, const struct _hb_field *fields,
+		size_t count, const struct _hb_list_map *map)
+{
+	uint64_t mask;
+	size_t i;
+	mask = 0;
+	for (i = 0; i < count; ++i)
+		if (!_hb_field_equal(a, b, &fields[i], map))
+			mask |= (uint64_t)1 << i;
+	return mask;
+}
+
+/////////////writer
+struct _hb_wbuf {
+	unsigned char                     *data;
+	size_t                              len;
+	size_t                              cap;
+	bool                                err;
+};
+
+static void
+_hb_put_byte(struct _hb_wbuf *w, unsigned char b)
+{
+	unsigned char *data;
+	size_t cap;
+
+	if (w->len == w->cap) {
+		cap = w->cap ? w->cap * 2 : 64;
+		if (NULL == (data = realloc(w->data, cap))) {
+			w->err = true;
+			return;
+		}
+		w->data = data;
+		w->cap = cap;
+	}
+
+	w->data[w->len++] = b;
+}
+
+static void
+_hb_put_varint(struct _hb_wbuf *w, uint64_t v)
+{
+	for (; v >= 0x80; v >>= 7)
+		_hb_put_byte(w, (v & 0x7f) | 0x80);
+	_hb_put_byte(w, v);
+}
+
+static void
+_hb_put_svarint(struct _hb_wbuf *w, int64_t v)
+{
+	_hb_put_varint(w, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+}
+
+static void
+_hb_put_field(struct _hb_wbuf *w, const void *e, const struct _hb_field *f)
+{
+	const char *p, *name;
+	uint64_t bits;
+	uint32_t u;
+	unsigned o;
+	size_t len, n;
+	bool b;
+	int i;
+
+	p = (const char *)e + f->offset;
+
+	switch (f->kind) {
+	case _HB_FIELD_DOUBLE:
+		memcpy(&bits, p, sizeof(bits));
+		for (i = 0; i < 8; ++i, bits >>= 8)
+			_hb_put_byte(w, bits & 0xff);
+		break;
+	case _HB_FIELD_INT:
+	case _HB_FIELD_INDEX:
+		memcpy(&i, p, sizeof(i));
+		_hb_put_svarint(w, i);
+		break;
+	case _HB_FIELD_UINT:
+		memcpy(&u, p, sizeof(u));
+		_hb_put_varint(w, u);
+		break;
+	case _HB_FIELD_BOOL:
+		memcpy(&b, p, sizeof(b));
+		_hb_put_byte(w, b);
+		break;
+	case _HB_FIELD_TRAIT:
+		/* the name's length plus one, 0 being no trait */
+		name = _hb_field_trait_name(e, f);
+		len = name ? strlen(name) : 0;
+		_hb_put_varint(w, name ? len + 1 : 0);
+		for (n = 0; n < len; ++n)
+			_hb_put_byte(w, name[n]);
+		break;
+	case _HB_FIELD_OVERRIDES:
+		memcpy(&o, p, sizeof(o));
+		_hb_put_varint(w, o);
+		break;
+	}
+}
+
+static void
+_hb_put_masked(struct _hb_wbuf *w, const void *e, const struct _hb_field *fields,
+		size_t count, uint64_t mask)
+{
+	size_t i;
+	_hb_put_varint(w, mask);
+	for (i = 0; i < count; ++i)
+		if (mask & ((uint64_t)1 << i))
+			_hb_put_field(w, e, &fields[i]);
+}
+
+/////////////reader
+struct _hb_rbuf {
+	const unsigned char                  *p;
+	const unsigned char                *end;
+	bool                                err;
+	struct hb_trait *const          *traits;
+};
+
+static unsigned char
+_hb_get_byte(struct _hb_rbuf *r)
+{
+	if (r->p == r->end) {
+		r->err = true;
+		return 0;
+	}
+	return *r->p++;
+}
+
+static uint64_t
+_hb_get_varint(struct _hb_rbuf *r)
+{
+	uint64_t v;
+	unsigned char b;
+	int shift;
+
+	for (v = 0, shift = 0; shift < 64; shift += 7) {
+		b = _hb_get_byte(r);
+		v |= (uint64_t)(b & 0x7f) << shift;
+		if (!(b & 0x80))
+			return v;
+	}
+
+	r->err = true;
+	return 0;
+}
+
+static int64_t
+_hb_get_svarint(struct _hb_rbuf *r)
+{
+	uint64_t v;
+	v = _hb_get_varint(r);
+	return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static void
+_hb_get_field(struct _hb_rbuf *r, void *e, const struct _hb_field *f)
+{
+	char *p;
+	uint64_t bits, u;
+	int64_t i;
+	int n, v;
+	unsigned char b;
+	uint32_t u32;
+	unsigned o;
+	bool flag;
+	const struct hb_trait *t;
+	size_t k;
+
+	p = (char *)e + f->offset;
+
+	switch (f->kind) {
+	case _HB_FIELD_DOUBLE:
+		for (bits = 0, n = 0; n < 8; ++n)
+			bits |= (uint64_t)_hb_get_byte(r) << (8 * n);
+		memcpy(p, &bits, sizeof(bits));
+		break;
+	case _HB_FIELD_INT:
+	case _HB_FIELD_INDEX:
+		i = _hb_get_svarint(r);
+		if (i < INT32_MIN || i > INT32_MAX) r->err = true;
+		v = i;
+		memcpy(p, &v, sizeof(v));
+		break;
+	case _HB_FIELD_UINT:
+		u = _hb_get_varint(r);
+		if (u > UINT32_MAX) r->err = true;
+		u32 = u;
+		memcpy(p, &u32, sizeof(u32));
+		break;
+	case _HB_FIELD_BOOL:
+		b = _hb_get_byte(r);
+		if (b > 1) r->err = true;
+		flag = b;
+		memcpy(p, &flag, sizeof(flag));
+		break;
+	case _HB_FIELD_TRAIT:
+		/* the patched stadium's trait of that name, if it has one */
+		t = NULL;
+		if ((u = _hb_get_varint(r)) > 0) {
+			if (--u > (uint64_t)(r->end - r->p)) {
+				r->err = true;
+				break;
+			}
+			for (k = 0; r->traits && r->traits[k] && !t; ++k)
+				if (r->traits[k]->name && strlen(r->traits[k]->name) == u &&
+						!memcmp(r->traits[k]->name, r->p, u))
+					t = r->traits[k];
+			r->p += u;
+		}
+		memcpy(p, &t, sizeof(t));
+		break;
+	case _HB_FIELD_OVERRIDES:
+		u = _hb_get_varint(r);
+		if (u > UINT_MAX) r->err = true;
+		o = u;
+		memcpy(p, &o, sizeof(o));
+		break;
+	}
+}
+
+static uint64_t
+_hb_get_masked(struct _hb_rbuf *r, void *e, const struct _hb_field *fields,
+		size_t count)
+{
+	uint64_t mask;
+	size_t i;
+
+	mask = _hb_get_varint(r);
+	if (count < 64 && (mask >> count))
+		r->err = true;
+
+	for (i = 0; i < count && !r->err; ++i)
+		if (mask & ((uint64_t)1 << i))
+			_hb_get_field(r, e, &fields[i]);
+
+	return mask;
+}
+
+/////////////diff
+static bool
+_hb_element_equal(const void *a, const void *b, const struct _hb_list_kind *k,
+		const struct _hb_list_map *map)
+{
+	return 0 == _hb_fields_diff(a, b, k->fields, k->count, map);
+}
+
+static void
+_hb_diff_list(struct _hb_wbuf *w, size_t l, void *const *la, void *const *lb,
+		const struct _hb_list_map *ref, struct _hb_list_map *map)
+{
+	const struct _hb_list_kind *k;
+	size_t na, nb, p, q, m, i, updates;
+	uint64_t mask;
+
+	k = &_hb_lists[l];
+	na = _hb_list_count(la);
+	nb = _hb_list_count(lb);
+
+	for (p = 0; p < na && p < nb && _hb_element_equal(la[p], lb[p], k, ref); ++p)
+		;
+
+	for (q = 0; q < na - p && q < nb - p &&
+			_hb_element_equal(la[na - 1 - q], lb[nb - 1 - q], k, ref); ++q)
+		;
+
+	m = na - p - q < nb - p - q ? na - p - q : nb - p - q;
+
+	map->na = na;
+	map->at = p + m;
+	map->removed = na - q - map->at;
+	map->inserted = nb - q - map->at;
+
+	for (updates = 0, i = p; i < map->at; ++i)
+		if (!_hb_element_equal(la[i], lb[i], k, ref))
+			++updates;
+
+	if (updates == 0 && _hb_list_map_is_identity(map))
+		return;
+
+	_hb_put_byte(w, _HB_DELTA_LIST + l);
+	_hb_put_varint(w, map->at);
+	_hb_put_varint(w, map->removed);
+	_hb_put_varint(w, map->inserted);
+
+	for (i = 0; i < map->inserted; ++i)
+		_hb_put_masked(w, lb[map->at + i], k->fields, k->count,
+				((uint64_t)1 << k->count) - 1);
+
+	_hb_put_varint(w, updates);
+
+	for (i = p; i < map->at; ++i) {
+		if ((mask = _hb_fields_diff(la[i], lb[i], k->fields, k->count, ref))) {
+			_hb_put_varint(w, i);
+			_hb_put_masked(w, lb[i], k->fields, k->count, mask);
+		}
+	}
+}
+
+static void
+_hb_diff_struct(struct _hb_wbuf *w, enum _hb_delta_tag tag, const void *a,
+		const void *b, const struct _hb_field *fields, size_t count)
+{
+	static const union _hb_element zero;
+	uint64_t mask;
+
+	if (!b) {
+		if (a) {
+			_hb_put_byte(w, tag);
+			_hb_put_byte(w, 0);
+		}
+		return;
+	}
+
+	if ((mask = _hb_fields_diff(a ? a : &zero, b, fields, count, NULL)) || !a) {
+		_hb_put_byte(w, tag);
+		_hb_put_byte(w, 1);
+		_hb_put_masked(w, b, fields, count, mask);
+	}
+}
+
+extern struct hb_stadium_delta *
+hb_stadium_diff(const struct hb_stadium *a, const struct hb_stadium *b)
+{
+	struct hb_stadium_delta *delta;
+	struct _hb_list_map maps[_HB_LISTS];
+	struct _hb_wbuf w;
+	uint64_t mask;
+	size_t l, len;
+
+	memset(&w, 0, sizeof(w));
+
+	_hb_put_byte(&w, _HB_DELTA_MAGIC0);
+	_hb_put_byte(&w, _HB_DELTA_MAGIC1);
+	_hb_put_byte(&w, _HB_DELTA_VERSION);
+
+	if (strcmp(a->name, b->name)) {
+		len = strlen(b->name);
+		_hb_put_byte(&w, _HB_DELTA_NAME);
+		_hb_put_varint(&w, len);
+		for (l = 0; l < len; ++l)
+			_hb_put_byte(&w, b->name[l]);
+	}
+
+	if ((mask = _hb_fields_diff(a, b, _hb_scalar_fields,
+					_HB_COUNT(_hb_scalar_fields), NULL))) {
+		_hb_put_byte(&w, _HB_DELTA_SCALARS);
+		_hb_put_masked(&w, b, _hb_scalar_fields, _HB_COUNT(_hb_scalar_fields), mask);
+	}
+
+	_hb_diff_struct(&w, _HB_DELTA_BG, a->bg, b->bg,
+			_hb_bg_fields, _HB_COUNT(_hb_bg_fields));
+
+	_hb_diff_struct(&w, _HB_DELTA_PLAYER_PHYSICS, a->player_physics,
+			b->player_physics, _hb_player_physics_fields,
+			_HB_COUNT(_hb_player_physics_fields));
+
+	for (l = 0; l < _HB_LISTS; ++l)
+		_hb_diff_list(&w, l, _hb_list_get(a, l), _hb_list_get(b, l),
+				_hb_lists[l].ref < 0 ? NULL : &maps[_hb_lists[l].ref],
+				&maps[l]);
+
+	_hb_put_byte(&w, _HB_DELTA_END);
+
+	if (w.err || NULL == (delta = malloc(sizeof(*delta)))) {
+		free(w.data);
+		return NULL;
+	}
+
+	delta->size = w.len;
+	delta->data = w.data;
+
+	return delta;
+}
+
+extern void
+hb_stadium_delta_free(struct hb_stadium_delta *delta)
+{
+	free(delta->data);
+	free(delta);
+}
+
+/////////////patch
+/* everything a patch needs is allocated and checked before the stadium
+   is touched, so a bad delta or a failed allocation leaves it as it was */
+struct _hb_patch_list {
+	bool                            present;
+	struct _hb_list_map                 map;
+	void                            **array;
+	struct _hb_rbuf                 updates;
+};
+
+struct _hb_patch {
+	bool                           has_name;
+	char                              *name;
+	bool                        has_scalars;
+	struct hb_stadium               scalars;
+	bool                             has_bg;
+	struct hb_background                *bg;
+	bool                             has_pp;
+	struct hb_player_physics            *pp;
+	struct _hb_patch_list lists[_HB_LISTS];
+};
+
+static void
+_hb_patch_free(struct _hb_patch *patch)
+{
+	size_t l, i;
+	struct _hb_patch_list *pl;
+
+	free(patch->name);
+	free(patch->bg);
+	free(patch->pp);
+
+	for (l = 0; l < _HB_LISTS; ++l) {
+		pl = &patch->lists[l];
+		if (!pl->array)
+			continue;
+		for (i = 0; i < pl->map.inserted; ++i)
+			free(pl->array[pl->map.at + i]);
+		free(pl->array);
+	}
+}
+
+static void *
+_hb_patch_struct(struct _hb_rbuf *r, const void *current, size_t size,
+		const struct _hb_field *fields, size_t count, bool *err)
+{
+	void *out;
+
+	switch (_hb_get_byte(r)) {
+	case 0:
+		return NULL;
+	case 1:
+		if (NULL == (out = calloc(1, size))) {
+			*err = true;
+			return NULL;
+		}
+		if (current)
+			memcpy(out, current, size);
+		_hb_get_masked(r, out, fields, count);
+		return out;
+	default:
+		r->err = true;
+		return NULL;
+	}
+}
+
+/* index fields of an element kept from before the patch follow the
+   elements they name to where those went */
+static void
+_hb_patch_remap(void *e, const struct _hb_list_kind *k,
+		const struct _hb_list_map *ref)
+{
+	size_t j;
+
+	if (!ref || _hb_list_map_is_identity(ref))
+		return;
+
+	for (j = 0; j < k->count; ++j)
+		if (k->fields[j].kind == _HB_FIELD_INDEX)
+			_hb_field_set_int(e, &k->fields[j],
+					_hb_list_map_index(ref, _hb_field_int(e, &k->fields[j])));
+}
+
+/* a field an update sets is the element's own from then on, whatever
+   its trait says */
+static void
+_hb_patch_override(void *e, const struct _hb_list_kind *k, uint64_t mask)
+{
+	unsigned overrides, fields;
+	size_t j;
+
+	for (fields = 0, j = 0; j < k->count; ++j)
+		if (mask & ((uint64_t)1 << j))
+			fields |= k->fields[j].trait;
+
+	for (j = 0; j < k->count && fields; ++j) {
+		if (k->fields[j].kind != _HB_FIELD_OVERRIDES)
+			continue;
+		memcpy(&overrides, (char *)e + k->fields[j].offset, sizeof(overrides));
+		overrides |= fields;
+		memcpy((char *)e + k->fields[j].offset, &overrides, sizeof(overrides));
+	}
+}
+
+static bool
+_hb_patch_indexes_valid(const void *e, const struct _hb_list_kind *k,
+		size_t count)
+{
+	size_t j;
+	int v;
+
+	for (j = 0; j < k->count; ++j) {
+		if (k->fields[j].kind != _HB_FIELD_INDEX)
+			continue;
+		v = _hb_field_int(e, &k->fields[j]);
+		if (v < 0 || (size_t)v >= count)
+			return false;
+	}
+
+	return true;
+}
+
+static int
+_hb_patch_list_prepare(struct _hb_rbuf *r, const struct hb_stadium *s,
+		size_t l, struct _hb_patch_list *pl)
+{
+	const struct _hb_list_kind *k;
+	union _hb_element scratch;
+	void **old;
+	size_t i, n, index, nb;
+
+	k = &_hb_lists[l];
+	old = _hb_list_get(s, l);
+
+	pl->present = true;
+	pl->map.na = _hb_list_count(old);
+	pl->map.at = _hb_get_varint(r);
+	pl->map.removed = _hb_get_varint(r);
+	pl->map.inserted = _hb_get_varint(r);
+
+	if (r->err || pl->map.at > pl->map.na ||
+			pl->map.removed > pl->map.na - pl->map.at ||
+			pl->map.inserted > (size_t)(r->end - r->p))
+		return -1;
+
+	nb = pl->map.na - pl->map.removed + pl->map.inserted;
+	if (NULL == (pl->array = calloc(nb + 1, sizeof(void *))))
+		return -1;
+
+	for (i = 0; i < pl->map.inserted; ++i) {
+		if (NULL == (pl->array[pl->map.at + i] = calloc(1, k->size)))
+			return -1;
+		_hb_get_masked(r, pl->array[pl->map.at + i], k->fields, k->count);
+	}
+
+	pl->updates = *r;
+	n = _hb_get_varint(r);
+
+	for (i = 0; i < n && !r->err; ++i) {
+		index = _hb_get_varint(r);
+		if (index >= pl->map.at)
+			return -1;
+		memcpy(&scratch, old[index], k->size);
+		_hb_get_masked(r, &scratch, k->fields, k->count);
+	}
+
+	return r->err ? -1 : 0;
+}
+
+/* once patched, every index of a list that refers to another has to name
+   one of that list's elements once patched, inserted, updated and merely
+   moved elements alike. updates have to come in the order of their
+   indexes, as hb_stadium_diff writes them */
+static int
+_hb_patch_list_check(const struct hb_stadium *s, size_t l,
+		const struct _hb_patch *patch)
+{
+	const struct _hb_list_kind *k;
+	const struct _hb_patch_list *pl, *pr;
+	const struct _hb_list_map *ref;
+	union _hb_element scratch;
+	struct _hb_rbuf updates;
+	void **old;
+	size_t i, n, u, na, next, count;
+
+	k = &_hb_lists[l];
+	pl = &patch->lists[l];
+	pr = &patch->lists[k->ref];
+	old = _hb_list_get(s, l);
+	na = _hb_list_count(old);
+
+	ref = pr->present ? &pr->map : NULL;
+	count = pr->present ? pr->map.na - pr->map.removed + pr->map.inserted :
+		_hb_list_count(_hb_list_get(s, k->ref));
+
+	for (i = 0; pl->present && i < pl->map.inserted; ++i)
+		if (!_hb_patch_indexes_valid(pl->array[pl->map.at + i], k, count))
+			return -1;
+
+	n = 0;
+	if (pl->present) {
+		updates = pl->updates;
+		n = _hb_get_varint(&updates);
+	}
+	u = 0;
+	next = n > 0 ? _hb_get_varint(&updates) : SIZE_MAX;
+
+	for (i = 0; i < na; ++i) {
+		if (pl->present && i >= pl->map.at && i < pl->map.at + pl->map.removed)
+			continue;
+		memcpy(&scratch, old[i], k->size);
+		_hb_patch_remap(&scratch, k, ref);
+		if (i == next) {
+			_hb_get_masked(&updates, &scratch, k->fields, k->count);
+			next = ++u < n ? _hb_get_varint(&updates) : SIZE_MAX;
+			if (next <= i)
+				return -1;
+		}
+		if (!_hb_patch_indexes_valid(&scratch, k, count))
+			return -1;
+	}
+
+	return u < n || (pl->present && updates.err) ? -1 : 0;
+}
+
+static int
+_hb_patch_prepare(struct _hb_rbuf *r, const struct hb_stadium *s,
+		struct _hb_patch *patch)
+{
+	unsigned char tag, last;
+	size_t len, i, l;
+	bool err;
+
+	if (_hb_get_byte(r) != _HB_DELTA_MAGIC0 ||
+			_hb_get_byte(r) != _HB_DELTA_MAGIC1 ||
+			_hb_get_byte(r) != _HB_DELTA_VERSION)
+		return -1;
+
+	err = false;
+	last = _HB_DELTA_END;
+
+	/* sections come at most once and in the order hb_stadium_diff writes them */
+	while (!r->err && !err && (tag = _hb_get_byte(r)) != _HB_DELTA_END) {
+		if (tag <= last || tag >= _HB_DELTA_LIST + _HB_LISTS)
+			return -1;
+		last = tag;
+		switch (tag) {
+		case _HB_DELTA_NAME:
+			len = _hb_get_varint(r);
+			if (r->err || len > (size_t)(r->end - r->p) ||
+					NULL == (patch->name = malloc(len + 1)))
+				return -1;
+			for (i = 0; i < len; ++i)
+				patch->name[i] = _hb_get_byte(r);
+			patch->name[len] = '\0';
+			patch->has_name = true;
+			break;
+		case _HB_DELTA_SCALARS:
+			patch->scalars = *s;
+			_hb_get_masked(r, &patch->scalars, _hb_scalar_fields,
+					_HB_COUNT(_hb_scalar_fields));
+			patch->has_scalars = true;
+			break;
+		case _HB_DELTA_BG:
+			patch->bg = _hb_patch_struct(r, s->bg, sizeof(*s->bg),
+					_hb_bg_fields, _HB_COUNT(_hb_bg_fields), &err);
+			patch->has_bg = true;
+			break;
+		case _HB_DELTA_PLAYER_PHYSICS:
+			patch->pp = _hb_patch_struct(r, s->player_physics,
+					sizeof(*s->player_physics), _hb_player_physics_fields,
+					_HB_COUNT(_hb_player_physics_fields), &err);
+			patch->has_pp = true;
+			break;
+		default:
+			if (_hb_patch_list_prepare(r, s, tag - _HB_DELTA_LIST,
+						&patch->lists[tag - _HB_DELTA_LIST]) < 0)
+				return -1;
+			break;
+		}
+	}
+
+	if (r->err || err || r->p != r->end)
+		return -1;
+
+	for (l = 0; l < _HB_LISTS; ++l)
+		if (_hb_lists[l].ref >= 0 && _hb_patch_list_check(s, l, patch) < 0)
+			return -1;
+
+	return 0;
+}
+
+static void
+_hb_patch_list_apply(struct hb_stadium *s, size_t l, struct _hb_patch_list *pl,
+		const struct _hb_list_map *ref)
+{
+	const struct _hb_list_kind *k;
+	void **old, **list;
+	size_t i, n, index, count;
+	uint64_t mask;
+
+	k = &_hb_lists[l];
+	old = _hb_list_get(s, l);
+
+	if (pl->present) {
+		list = pl->array;
+		if (old) {
+			memcpy(list, old, pl->map.at * sizeof(void *));
+			for (i = pl->map.at; i < pl->map.at + pl->map.removed; ++i)
+				free(old[i]);
+			memcpy(list + pl->map.at + pl->map.inserted,
+					old + pl->map.at + pl->map.removed,
+					(pl->map.na - pl->map.at - pl->map.removed) * sizeof(void *));
+			free(old);
+		}
+		_hb_list_set(s, l, list);
+		pl->array = NULL;
+	} else {
+		list = old;
+	}
+
+	count = _hb_list_count(list);
+
+	for (i = 0; i < count; ++i)
+		if (!pl->present || i < pl->map.at || i >= pl->map.at + pl->map.inserted)
+			_hb_patch_remap(list[i], k, ref);
+
+	if (pl->present) {
+		n = _hb_get_varint(&pl->updates);
+		for (i = 0; i < n; ++i) {
+			index = _hb_get_varint(&pl->updates);
+			mask = _hb_get_masked(&pl->updates, list[index], k->fields, k->count);
+			_hb_patch_override(list[index], k, mask);
+		}
+	}
+}
+
+extern int
+hb_stadium_patch(struct hb_stadium *s, const struct hb_stadium_delta *delta)
+{
+	struct _hb_patch patch;
+	struct _hb_rbuf r;
+	struct hb_disc *ball;
+	unsigned sections;
+	size_t l, i;
+	int ref;
+
+	memset(&patch, 0, sizeof(patch));
+	r.p = delta->data;
+	r.end = delta->data + delta->size;
+	r.err = false;
+	r.traits = s->traits;
+
+	if (_hb_patch_prepare(&r, s, &patch) < 0) {
+		_hb_patch_free(&patch);
+		return -1;
+	}
+
+	sections = 0;
+	if (patch.has_name) sections |= HB_STADIUM_SECTION_NAME;
+	if (patch.has_bg) sections |= HB_STADIUM_SECTION_BG;
+	if (patch.has_pp) sections |= HB_STADIUM_SECTION_PLAYER_PHYSICS;
+
+	for (l = 0; l < _HB_LISTS; ++l) {
+		ref = _hb_lists[l].ref;
+		if (patch.lists[l].present || (ref >= 0 && patch.lists[ref].present &&
+					!_hb_list_map_is_identity(&patch.lists[ref].map)))
+			sections |= _hb_lists[l].section;
+	}
+
+	if (hb_stadium_unshare(s, sections) < 0) {
+		_hb_patch_free(&patch);
+		return -1;
+	}
+
+	if (patch.has_name) {
+		free(s->name);
+		s->name = patch.name;
+		patch.name = NULL;
+	}
+
+	if (patch.has_scalars)
+		for (i = 0; i < _HB_COUNT(_hb_scalar_fields); ++i)
+			memcpy((char *)s + _hb_scalar_fields[i].offset,
+					(char *)&patch.scalars + _hb_scalar_fields[i].offset,
+					_hb_field_size(&_hb_scalar_fields[i]));
+
+	if (patch.has_bg) {
+		free(s->bg);
+		s->bg = patch.bg;
+		patch.bg = NULL;
+	}
+
+	if (patch.has_pp) {
+		free(s->player_physics);
+		s->player_physics = patch.pp;
+		patch.pp = NULL;
+	}
+
+	ball = s->discs && s->ball_physics == s->discs[0] ? s->ball_physics : NULL;
+
+	for (l = 0; l < _HB_LISTS; ++l) {
+		ref = _hb_lists[l].ref;
+		_hb_patch_list_apply(s, l, &patch.lists[l],
+				ref >= 0 && patch.lists[ref].present ? &patch.lists[ref].map : NULL);
+	}
+
+	if (ball)
+		s->ball_physics = s->discs[0];
+
+	_hb_patch_free(&patch);
+	hb_stadium_invalidate(s);
+
+	return 0;
+}
@@ -0,0 +1,371 @@
+#include <hb/geometry.h>
+#include <hb/stadium.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* arrays are aligned for vector loads */
+#define _HB_GEOMETRY_ALIGN(n) (((n) + 31) & ~(size_t)31)
+
+#define _HB_GEOMETRY_MIN_CURVE (10.0 * M_PI / 180.0)
+#define _HB_GEOMETRY_MAX_CURVE (340.0 * M_PI / 180.0)
+
+static size_t
+_hb_geometry_count(void *const *list)
+{
+	size_t count;
+	count = 0;
+	if (list)
+		while (list[count])
+			++count;
+	return count;
+}
+
+/* hands out the next array of the block, or only measures it when
+   block is NULL */
+static void *
+_hb_geometry_carve(unsigned char *block, size_t *offset, size_t size)
+{
+	void *p;
+	p = block ? block + *offset : NULL;
+	*offset = _HB_GEOMETRY_ALIGN(*offset + size);
+	return p;
+}
+
+static size_t
+_hb_geometry_layout(struct hb_geometry *g, unsigned char *block)
+{
+	size_t offset, ns, nv, np;
+
+	ns = g->segments_count;
+	nv = g->vertexes_count;
+	np = g->planes_count;
+	offset = _HB_GEOMETRY_ALIGN(sizeof(struct hb_geometry));
+
+	g->arc = _hb_geometry_carve(block, &offset, ns * sizeof(bool));
+	g->v0_x = _hb_geometry_carve(block, &offset, ns * sizeof(double));
+	g->v0_y = _hb_geometry_carve(block, &offset, ns * sizeof(double));
+	g->v1_x = _hb_geometry_carve(block, &offset, ns * sizeof(double));
+	g->v1_y = _hb_geometry_carve(block, &offset, ns * sizeof(double));
+	g->normal_x = _hb_geometry_carve(block, &offset, ns * sizeof(double));
+	g->normal_y = _hb_geometry_carve(block, &offset, ns * sizeof(double));
+	g->center_x = _hb_geometry_carve(block, &offset, ns * sizeof(double));
+	g->center_y = _hb_geometry_carve(block, &offset, ns * sizeof(double));
+	g->radius = _hb_geometry_carve(block, &offset, ns * sizeof(double));
+	g->cot = _hb_geometry_carve(block, &offset, ns * sizeof(double));
+	g->t0_x = _hb_geometry_carve(block, &offset, ns * sizeof(double));
+	g->t0_y = _hb_geometry_carve(block, &offset, ns * sizeof(double));
+	g->t1_x = _hb_geometry_carve(block, &offset, ns * sizeof(double));
+	g->t1_y = _hb_geometry_carve(block, &offset, ns * sizeof(double));
+	g->min_x = _hb_geometry_carve(block, &offset, ns * sizeof(double));
+	g->min_y = _hb_geometry_carve(block, &offset, ns * sizeof(double));
+	g->max_x = _hb_geometry_carve(block, &offset, ns * sizeof(double));
+	g->max_y = _hb_geometry_carve(block, &offset, ns * sizeof(double));
+	g->bias = _hb_geometry_carve(block, &offset, ns * sizeof(double));
+	g->b_coef = _hb_geometry_carve(block, &offset, ns * sizeof(double));
+	g->c_group = _hb_geometry_carve(block, &offset, ns * sizeof(enum hb_collision_flags));
+	g->c_mask = _hb_geometry_carve(block, &offset, ns * sizeof(enum hb_collision_flags));
+	g->c_class = _hb_geometry_carve(block, &offset, ns * sizeof(uint32_t));
+
+	g->vertex_x = _hb_geometry_carve(block, &offset, nv * sizeof(double));
+	g->vertex_y = _hb_geometry_carve(block, &offset, nv * sizeof(double));
+	g->vertex_b_coef = _hb_geometry_carve(block, &offset, nv * sizeof(double));
+	g->vertex_c_group = _hb_geometry_carve(block, &offset, nv * sizeof(enum hb_collision_flags));
+	g->vertex_c_mask = _hb_geometry_carve(block, &offset, nv * sizeof(enum hb_collision_flags));
+	g->vertex_c_class = _hb_geometry_carve(block, &offset, nv * sizeof(uint32_t));
+
+	g->plane_normal_x = _hb_geometry_carve(block, &offset, np * sizeof(double));
+	g->plane_normal_y = _hb_geometry_carve(block, &offset, np * sizeof(double));
+	g->plane_dist = _hb_geometry_carve(block, &offset, np * sizeof(double));
+	g->plane_b_coef = _hb_geometry_carve(block, &offset, np * sizeof(double));
+	g->plane_c_group = _hb_geometry_carve(block, &offset, np * sizeof(enum hb_collision_flags));
+	g->plane_c_mask = _hb_geometry_carve(block, &offset, np * sizeof(enum hb_collision_flags));
+	g->plane_c_class = _hb_geometry_carve(block, &offset, np * sizeof(uint32_t));
+
+	return offset;
+}
+
+static void
+_hb_geometry_bounds_add(struct hb_geometry *g, size_t i, double x, double y)
+{
+	if (x < g->min_x[i]) g->min_x[i] = x;
+	if (y < g->min_y[i]) g->min_y[i] = y;
+	if (x > g->max_x[i]) g->max_x[i] = x;
+	if (y > g->max_y[i]) g->max_y[i] = y;
+}
+
+static void
+_hb_geometry_compile_segment(struct hb_geometry *g, size_t i,
+		const struct hb_segment *segm, const struct hb_vertex *a,
+		const struct hb_vertex *b)
+{
+	double curve, len, c, d, r;
+
+	curve = segm->curve * (M_PI / 180.0);
+	g->bias[i] = segm->bias;
+	g->b_coef[i] = segm->b_coef;
+	g->c_group[i] = segm->c_group;
+	g->c_mask[i] = segm->c_mask;
+	g->c_class[i] = 0;
+
+	/////////////negative curve
+	if (curve < 0) {
+		const struct hb_vertex *tmp;
+		curve = -curve;
+		tmp = a, a = b, b = tmp;
+		g->bias[i] = -g->bias[i];
+	}
+
+	g->v0_x[i] = a->x;
+	g->v0_y[i] = a->y;
+	g->v1_x[i] = b->x;
+	g->v1_y[i] = b->y;
+	g->min_x[i] = g->max_x[i] = a->x;
+	g->min_y[i] = g->max_y[i] = a->y;
+	_hb_geometry_bounds_add(g, i, b->x, b->y);
+
+	g->arc[i] = curve > _HB_GEOMETRY_MIN_CURVE && curve < _HB_GEOMETRY_MAX_CURVE;
+
+	/////////////straight
+	if (!g->arc[i]) {
+		c = b->x - a->x;
+		d = b->y - a->y;
+		len = sqrt(c * c + d * d);
+		g->normal_x[i] = len > 0 ? -d / len : 0;
+		g->normal_y[i] = len > 0 ? c / len : 0;
+		g->center_x[i] = g->center_y[i] = 0;
+		g->radius[i] = 0;
+		g->cot[i] = INFINITY;
+		g->t0_x[i] = g->t0_y[i] = 0;
+		g->t1_x[i] = g->t1_y[i] = 0;
+		return;
+	}
+
+	/////////////arc
+	g->normal_x[i] = g->normal_y[i] = 0;
+	g->cot[i] = 1 / tan(curve / 2);
+	c = 0.5 * (b->x - a->x);
+	d = 0.5 * (b->y - a->y);
+	g->center_x[i] = a->x + c - d * g->cot[i];
+	g->center_y[i] = a->y + d + c * g->cot[i];
+	c = a->x - g->center_x[i];
+	d = a->y - g->center_y[i];
+	g->radius[i] = r = sqrt(c * c + d * d);
+	g->t0_x[i] = -d;
+	g->t0_y[i] = c;
+	g->t1_x[i] = b->y - g->center_y[i];
+	g->t1_y[i] = -(b->x - g->center_x[i]);
+
+	if (g->cot[i] <= 0) {
+		g->t0_x[i] = -g->t0_x[i];
+		g->t0_y[i] = -g->t0_y[i];
+		g->t1_x[i] = -g->t1_x[i];
+		g->t1_y[i] = -g->t1_y[i];
+	}
+
+	/* the circle reaches past the ends wherever the arc crosses an axis */
+	if (hb_geometry_arc_contains(g, i, 1, 0))
+		_hb_geometry_bounds_add(g, i, g->center_x[i] + r, g->center_y[i]);
+	if (hb_geometry_arc_contains(g, i, -1, 0))
+		_hb_geometry_bounds_add(g, i, g->center_x[i] - r, g->center_y[i]);
+	if (hb_geometry_arc_contains(g, i, 0, 1))
+		_hb_geometry_bounds_add(g, i, g->center_x[i], g->center_y[i] + r);
+	if (hb_geometry_arc_contains(g, i, 0, -1))
+		_hb_geometry_bounds_add(g, i, g->center_x[i], g->center_y[i] - r);
+}
+
+extern struct hb_geometry *
+hb_stadium_compile(const struct hb_stadium *s)
+{
+	struct hb_geometry layout, *g;
+	size_t size, i;
+
+	layout.segments_count = _hb_geometry_count((void *const *)s->segments);
+	layout.vertexes_count = _hb_geometry_count((void *const *)s->vertexes);
+	layout.planes_count = _hb_geometry_count((void *const *)s->planes);
+
+	for (i = 0; i < layout.segments_count; ++i)
+		if (s->segments[i]->v0 < 0 || (size_t)s->segments[i]->v0 >= layout.vertexes_count ||
+				s->segments[i]->v1 < 0 || (size_t)s->segments[i]->v1 >= layout.vertexes_count)
+			return NULL;
+
+	size = _hb_geometry_layout(&layout, NULL);
+
+	if (NULL == (g = aligned_alloc(32, size)))
+		return NULL;
+
+	*g = layout;
+	_hb_geometry_layout(g, (unsigned char *)g);
+
+	/////////////segments
+	for (i = 0; i < g->segments_count; ++i)
+		_hb_geometry_compile_segment(g, i, s->segments[i],
+				s->vertexes[s->segments[i]->v0],
+				s->vertexes[s->segments[i]->v1]);
+
+	/////////////vertexes
+	for (i = 0; i < g->vertexes_count; ++i) {
+		g->vertex_x[i] = s->vertexes[i]->x;
+		g->vertex_y[i] = s->vertexes[i]->y;
+		g->vertex_b_coef[i] = s->vertexes[i]->b_coef;
+		g->vertex_c_group[i] = s->vertexes[i]->c_group;
+		g->vertex_c_mask[i] = s->vertexes[i]->c_mask;
+		g->vertex_c_class[i] = 0;
+	}
+
+	/////////////planes
+	for (i = 0; i < g->planes_count; ++i) {
+		double len;
+		len = sqrt(s->planes[i]->normal[0] * s->planes[i]->normal[0] +
+				s->planes[i]->normal[1] * s->planes[i]->normal[1]);
+		g->plane_normal_x[i] = len > 0 ? s->planes[i]->normal[0] / len : 0;
+		g->plane_normal_y[i] = len > 0 ? s->planes[i]->normal[1] / len : 0;
+		g->plane_dist[i] = s->planes[i]->dist;
+		g->plane_b_coef[i] = s->planes[i]->b_coef;
+		g->plane_c_group[i] = s->planes[i]->c_group;
+		g->plane_c_mask[i] = s->planes[i]->c_mask;
+		g->plane_c_class[i] = 0;
+	}
+
+	return g;
+}
+
+extern void
+hb_geometry_free(struct hb_geometry *g)
+{
+	free(g);
+}
+
+extern bool
+hb_geometry_arc_contains(const struct hb_geometry *g, size_t i,
+		double dx, double dy)
+{
+	bool inside;
+	inside = dx * g->t0_x[i] + dy * g->t0_y[i] > 0 &&
+		dx * g->t1_x[i] + dy * g->t1_y[i] > 0;
+	/* wide arcs flip their tangents, the test then picks the gap */
+	return inside == (g->cot[i] > 0);
+}
+
+extern int
+hb_geometry_classify(struct hb_geometry *g, struct hb_collision_table *t)
+{
+	long c;
+	size_t i;
+
+	for (i = 0; i < g->segments_count; ++i) {
+		if ((c = hb_collision_table_add(t, g->c_group[i], g->c_mask[i])) < 0)
+			return -1;
+		g->c_class[i] = c;
+	}
+
+	for (i = 0; i < g->vertexes_count; ++i) {
+		if ((c = hb_collision_table_add(t, g->vertex_c_group[i], g->vertex_c_mask[i])) < 0)
+			return -1;
+		g->vertex_c_class[i] = c;
+	}
+
+	for (i = 0; i < g->planes_count; ++i) {
+		if ((c = hb_collision_table_add(t, g->plane_c_group[i], g->plane_c_mask[i])) < 0)
+			return -1;
+		g->plane_c_class[i] = c;
+	}
+
+	return 0;
+}
+
+static bool
+_hb_geometry_reachable(const struct hb_collision_table *t, uint32_t c,
+		const uint32_t *classes, size_t count)
+{
+	size_t i;
+	for (i = 0; i < count; ++i)
+		if (hb_collision_table_test(t, c, classes[i]))
+			return true;
+	return false;
+}
+
+static void
+_hb_geometry_move_segment(struct hb_geometry *g, size_t to, size_t from)
+{
+	g->arc[to] = g->arc[from];
+	g->v0_x[to] = g->v0_x[from];
+	g->v0_y[to] = g->v0_y[from];
+	g->v1_x[to] = g->v1_x[from];
+	g->v1_y[to] = g->v1_y[from];
+	g->normal_x[to] = g->normal_x[from];
+	g->normal_y[to] = g->normal_y[from];
+	g->center_x[to] = g->center_x[from];
+	g->center_y[to] = g->center_y[from];
+	g->radius[to] = g->radius[from];
+	g->cot[to] = g->cot[from];
+	g->t0_x[to] = g->t0_x[from];
+	g->t0_y[to] = g->t0_y[from];
+	g->t1_x[to] = g->t1_x[from];
+	g->t1_y[to] = g->t1_y[from];
+	g->min_x[to] = g->min_x[from];
+	g->min_y[to] = g->min_y[from];
+	g->max_x[to] = g->max_x[from];
+	g->max_y[to] = g->max_y[from];
+	g->bias[to] = g->bias[from];
+	g->b_coef[to] = g->b_coef[from];
+	g->c_group[to] = g->c_group[from];
+	g->c_mask[to] = g->c_mask[from];
+	g->c_class[to] = g->c_class[from];
+}
+
+static void
+_hb_geometry_move_vertex(struct hb_geometry *g, size_t to, size_t from)
+{
+	g->vertex_x[to] = g->vertex_x[from];
+	g->vertex_y[to] = g->vertex_y[from];
+	g->vertex_b_coef[to] = g->vertex_b_coef[from];
+	g->vertex_c_group[to] = g->vertex_c_group[from];
+	g->vertex_c_mask[to] = g->vertex_c_mask[from];
+	g->vertex_c_class[to] = g->vertex_c_class[from];
+}
+
+static void
+_hb_geometry_move_plane(struct hb_geometry *g, size_t to, size_t from)
+{
+	g->plane_normal_x[to] = g->plane_normal_x[from];
+	g->plane_normal_y[to] = g->plane_normal_y[from];
+	g->plane_dist[to] = g->plane_dist[from];
+	g->plane_b_coef[to] = g->plane_b_coef[from];
+	g->plane_c_group[to] = g->plane_c_group[from];
+	g->plane_c_mask[to] = g->plane_c_mask[from];
+	g->plane_c_class[to] = g->plane_c_class[from];
+}
+
+/* the arrays keep the room they had, only the counts go down */
+extern size_t
+hb_geometry_drop_unreachable(struct hb_geometry *g,
+		const struct hb_collision_table *t, const uint32_t *classes, size_t count)
+{
+	size_t i, n, dropped;
+
+	dropped = 0;
+
+	for (i = n = 0; i < g->segments_count; ++i)
+		if (_hb_geometry_reachable(t, g->c_class[i], classes, count))
+			_hb_geometry_move_segment(g, n++, i);
+	dropped += g->segments_count - n;
+	g->segments_count = n;
+
+	for (i = n = 0; i < g->vertexes_count; ++i)
+		if (_hb_geometry_reachable(t, g->vertex_c_class[i], classes, count))
+			_hb_geometry_move_vertex(g, n++, i);
+	dropped += g->vertexes_count - n;
+	g->vertexes_count = n;
+
+	for (i = n = 0; i < g->planes_count; ++i)
+		if (_hb_geometry_reachable(t, g->plane_c_class[i], classes, count))
+			_hb_geometry_move_plane(g, n++, i);
+	dropped += g->planes_count - n;
+	g->planes_count = n;
+
+	return dropped;
+}
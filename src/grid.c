@@ -0,0 +1,292 @@
+#include <hb/grid.h>
+#include <hb/geometry.h>
+#include <hb/stadium.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/* a cell size small next to the stadium is made larger to stay in this */
+#define _HB_GRID_MAX_CELLS (1 << 20)
+
+/* results shorter than this are sorted by insertion */
+#define _HB_GRID_SHORT_SORT 32
+
+struct _hb_grid_box {
+	double                            min_x;
+	double                            min_y;
+	double                            max_x;
+	double                            max_y;
+};
+
+static struct _hb_grid_box
+_hb_grid_segment_box(const struct hb_geometry *g, size_t i)
+{
+	struct _hb_grid_box box;
+	double pad;
+	pad = fabs(g->bias[i]);
+	box.min_x = g->min_x[i] - pad;
+	box.min_y = g->min_y[i] - pad;
+	box.max_x = g->max_x[i] + pad;
+	box.max_y = g->max_y[i] + pad;
+	return box;
+}
+
+static struct _hb_grid_box
+_hb_grid_vertex_box(const struct hb_geometry *g, size_t i)
+{
+	struct _hb_grid_box box;
+	box.min_x = box.max_x = g->vertex_x[i];
+	box.min_y = box.max_y = g->vertex_y[i];
+	return box;
+}
+
+static size_t
+_hb_grid_cell(double v, double min, double cell_size, size_t count)
+{
+	double c;
+	c = floor((v - min) / cell_size);
+	if (!(c > 0)) return 0;
+	if (c >= (double)count) return count - 1;
+	return (size_t)c;
+}
+
+static void
+_hb_grid_range(const struct hb_static_grid *grid, const struct _hb_grid_box *box,
+		size_t *c0, size_t *r0, size_t *c1, size_t *r1)
+{
+	*c0 = _hb_grid_cell(box->min_x, grid->min_x, grid->cell_size, grid->columns);
+	*r0 = _hb_grid_cell(box->min_y, grid->min_y, grid->cell_size, grid->rows);
+	*c1 = _hb_grid_cell(box->max_x, grid->min_x, grid->cell_size, grid->columns);
+	*r1 = _hb_grid_cell(box->max_y, grid->min_y, grid->cell_size, grid->rows);
+}
+
+/* counts the entries of every cell, then fills them in index order so
+   each cell comes out sorted */
+static int
+_hb_grid_bin(struct hb_static_grid *grid, const struct hb_geometry *g,
+		size_t count, struct _hb_grid_box (*box_of)(const struct hb_geometry *, size_t),
+		size_t **start, uint32_t **index, uint32_t **column, uint32_t **row)
+{
+	struct _hb_grid_box box;
+	size_t cells, i, c, r, c0, r0, c1, r1, *cursor, total;
+
+	cells = grid->columns * grid->rows;
+
+	if (NULL == (*start = calloc(cells + 1, sizeof(size_t))) ||
+			NULL == (*column = malloc((count + 1) * sizeof(uint32_t))) ||
+			NULL == (*row = malloc((count + 1) * sizeof(uint32_t))))
+		return -1;
+
+	for (i = 0; i < count; ++i) {
+		box = box_of(g, i);
+		_hb_grid_range(grid, &box, &c0, &r0, &c1, &r1);
+		(*column)[i] = c0;
+		(*row)[i] = r0;
+		for (r = r0; r <= r1; ++r)
+			for (c = c0; c <= c1; ++c)
+				++(*start)[r * grid->columns + c + 1];
+	}
+
+	for (i = 0, total = 0; i <= cells; ++i) {
+		total += (*start)[i];
+		(*start)[i] = total;
+	}
+
+	if (NULL == (*index = malloc((total + 1) * sizeof(uint32_t))) ||
+			NULL == (cursor = malloc(cells * sizeof(size_t))))
+		return -1;
+
+	for (i = 0; i < cells; ++i)
+		cursor[i] = (*start)[i];
+
+	for (i = 0; i < count; ++i) {
+		box = box_of(g, i);
+		_hb_grid_range(grid, &box, &c0, &r0, &c1, &r1);
+		for (r = r0; r <= r1; ++r)
+			for (c = c0; c <= c1; ++c)
+				(*index)[cursor[r * grid->columns + c]++] = i;
+	}
+
+	free(cursor);
+
+	return 0;
+}
+
+extern struct hb_static_grid *
+hb_static_grid_from_geometry(const struct hb_geometry *g, double cell_size)
+{
+	struct hb_static_grid *grid;
+	struct _hb_grid_box box, bounds;
+	double width, height, cells;
+	size_t i;
+
+	if (!(cell_size > 0) || g->segments_count > UINT32_MAX ||
+			g->vertexes_count > UINT32_MAX)
+		return NULL;
+
+	/////////////bounds
+	bounds.min_x = bounds.min_y = INFINITY;
+	bounds.max_x = bounds.max_y = -INFINITY;
+
+	for (i = 0; i < g->segments_count + g->vertexes_count; ++i) {
+		box = i < g->segments_count ? _hb_grid_segment_box(g, i) :
+			_hb_grid_vertex_box(g, i - g->segments_count);
+		if (box.min_x < bounds.min_x) bounds.min_x = box.min_x;
+		if (box.min_y < bounds.min_y) bounds.min_y = box.min_y;
+		if (box.max_x > bounds.max_x) bounds.max_x = box.max_x;
+		if (box.max_y > bounds.max_y) bounds.max_y = box.max_y;
+	}
+
+	if (g->segments_count + g->vertexes_count == 0)
+		bounds.min_x = bounds.min_y = bounds.max_x = bounds.max_y = 0;
+
+	if (!isfinite(bounds.min_x) || !isfinite(bounds.min_y) ||
+			!isfinite(bounds.max_x) || !isfinite(bounds.max_y))
+		return NULL;
+
+	width = bounds.max_x - bounds.min_x;
+	height = bounds.max_y - bounds.min_y;
+	cells = (floor(width / cell_size) + 1) * (floor(height / cell_size) + 1);
+	if (cells > _HB_GRID_MAX_CELLS)
+		cell_size *= sqrt(cells / _HB_GRID_MAX_CELLS) * 1.01;
+
+	/////////////cells
+	if (NULL == (grid = calloc(1, sizeof(*grid))))
+		return NULL;
+
+	grid->min_x = bounds.min_x;
+	grid->min_y = bounds.min_y;
+	grid->cell_size = cell_size;
+	grid->columns = (size_t)floor(width / cell_size) + 1;
+	grid->rows = (size_t)floor(height / cell_size) + 1;
+	grid->segments_count = g->segments_count;
+	grid->vertexes_count = g->vertexes_count;
+
+	if (_hb_grid_bin(grid, g, g->segments_count, _hb_grid_segment_box,
+				&grid->segment_start, &grid->segment_index,
+				&grid->segment_column, &grid->segment_row) < 0 ||
+			_hb_grid_bin(grid, g, g->vertexes_count, _hb_grid_vertex_box,
+				&grid->vertex_start, &grid->vertex_index,
+				&grid->vertex_column, &grid->vertex_row) < 0) {
+		hb_static_grid_free(grid);
+		return NULL;
+	}
+
+	return grid;
+}
+
+extern struct hb_static_grid *
+hb_static_grid_build(const struct hb_stadium *s, double cell_size)
+{
+	struct hb_static_grid *grid;
+	struct hb_geometry *g;
+
+	if (NULL == (g = hb_stadium_compile(s)))
+		return NULL;
+
+	grid = hb_static_grid_from_geometry(g, cell_size);
+	hb_geometry_free(g);
+
+	return grid;
+}
+
+extern void
+hb_static_grid_free(struct hb_static_grid *grid)
+{
+	if (!grid)
+		return;
+	free(grid->segment_start);
+	free(grid->segment_index);
+	free(grid->segment_column);
+	free(grid->segment_row);
+	free(grid->vertex_start);
+	free(grid->vertex_index);
+	free(grid->vertex_column);
+	free(grid->vertex_row);
+	free(grid);
+}
+
+static int
+_hb_grid_index_cmp(const void *a, const void *b)
+{
+	uint32_t ia = *(const uint32_t *)a, ib = *(const uint32_t *)b;
+	return ia < ib ? -1 : ia > ib;
+}
+
+static void
+_hb_grid_sort(uint32_t *v, size_t n)
+{
+	size_t i, j;
+	uint32_t x;
+
+	if (n > _HB_GRID_SHORT_SORT) {
+		qsort(v, n, sizeof(*v), _hb_grid_index_cmp);
+		return;
+	}
+
+	for (i = 1; i < n; ++i) {
+		x = v[i];
+		for (j = i; j > 0 && v[j - 1] > x; --j)
+			v[j] = v[j - 1];
+		v[j] = x;
+	}
+}
+
+static size_t
+_hb_grid_collect(const struct hb_static_grid *grid, size_t c0, size_t r0,
+		size_t c1, size_t r1, const size_t *start, const uint32_t *index,
+		const uint32_t *column, const uint32_t *row, uint32_t *out)
+{
+	size_t c, r, k, n, cell;
+	uint32_t e;
+
+	n = 0;
+
+	for (r = r0; r <= r1; ++r) {
+		for (c = c0; c <= c1; ++c) {
+			cell = r * grid->columns + c;
+			for (k = start[cell]; k < start[cell + 1]; ++k) {
+				e = index[k];
+				/* report it from the first cell the box and it share */
+				if ((column[e] > c0 ? column[e] : c0) == c &&
+						(row[e] > r0 ? row[e] : r0) == r)
+					out[n++] = e;
+			}
+		}
+	}
+
+	_hb_grid_sort(out, n);
+
+	return n;
+}
+
+extern void
+hb_static_grid_query(const struct hb_static_grid *grid,
+		double min_x, double min_y, double max_x, double max_y,
+		uint32_t *segments, size_t *nsegments,
+		uint32_t *vertexes, size_t *nvertexes)
+{
+	struct _hb_grid_box box;
+	size_t c0, r0, c1, r1;
+
+	*nsegments = *nvertexes = 0;
+
+	/* nothing lives outside of the grid */
+	if (max_x < grid->min_x || max_y < grid->min_y ||
+			min_x > grid->min_x + grid->columns * grid->cell_size ||
+			min_y > grid->min_y + grid->rows * grid->cell_size)
+		return;
+
+	box.min_x = min_x;
+	box.min_y = min_y;
+	box.max_x = max_x;
+	box.max_y = max_y;
+	_hb_grid_range(grid, &box, &c0, &r0, &c1, &r1);
+
+	*nsegments = _hb_grid_collect(grid, c0, r0, c1, r1, grid->segment_start,
+			grid->segment_index, grid->segment_column, grid->segment_row, segments);
+	*nvertexes = _hb_grid_collect(grid, c0, r0, c1, r1, grid->vertex_start,
+			grid->vertex_index, grid->vertex_column, grid->vertex_row, vertexes);
+}
@@ -0,0 +1,512 @@
+#include <hb/hash.h>
+#include <hb/stadium.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define _HB_P1 0x9e3779b185ebca87ull
+#define _HB_P2 0xc2b2ae3d27d4eb4full
+#define _HB_P3 0x165667b19e3779f9ull
+#define _HB_P4 0x85ebca77c2b2ae63ull
+#define _HB_P5 0x27d4eb2f165667c5ull
+
+#define _HB_HASH_LANES 4
+#define _HB_CANON_WORDS 256
+
+#define _hb_rotl(x,r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+/////////////hash
+/* four independent xxh64 style lanes, one stripe is four words so the
+   inner loop maps onto simd registers */
+struct _hb_hash_state {
+	uint64_t      lanes[_HB_HASH_LANES];
+	uint64_t      pending[_HB_HASH_LANES];
+	size_t        npending;
+	uint64_t      total;
+};
+
+static void
+_hb_hash_init(struct _hb_hash_state *st)
+{
+	st->lanes[0] = _HB_P1 + _HB_P2;
+	st->lanes[1] = _HB_P2;
+	st->lanes[2] = 0;
+	st->lanes[3] = -_HB_P1;
+	st->npending = 0;
+	st->total = 0;
+}
+
+static void
+_hb_hash_stripes(uint64_t *lanes, const uint64_t *w, size_t nstripes)
+{
+	size_t s, i;
+	for (s = 0; s < nstripes; ++s, w += _HB_HASH_LANES)
+		for (i = 0; i < _HB_HASH_LANES; ++i)
+			lanes[i] = _hb_rotl(lanes[i] + w[i] * _HB_P2, 31) * _HB_P1;
+}
+
+static void
+_hb_hash_update(struct _hb_hash_state *st, const uint64_t *w, size_t n)
+{
+	size_t take;
+
+	st->total += n;
+
+	if (st->npending > 0) {
+		take = _HB_HASH_LANES - st->npending;
+		if (take > n) take = n;
+		memcpy(st->pending + st->npending, w, take * sizeof(uint64_t));
+		st->npending += take;
+		w += take;
+		n -= take;
+		if (st->npending < _HB_HASH_LANES)
+			return;
+		_hb_hash_stripes(st->lanes, st->pending, 1);
+		st->npending = 0;
+	}
+
+	_hb_hash_stripes(st->lanes, w, n / _HB_HASH_LANES);
+	w += n - n % _HB_HASH_LANES;
+	n %= _HB_HASH_LANES;
+
+	memcpy(st->pending, w, n * sizeof(uint64_t));
+	st->npending = n;
+}
+
+static uint64_t
+_hb_hash_merge(uint64_t h, uint64_t lane)
+{
+	h ^= _hb_rotl(lane * _HB_P2, 31) * _HB_P1;
+	return h * _HB_P1 + _HB_P4;
+}
+
+static uint64_t
+_hb_hash_avalanche(uint64_t h)
+{
+	h ^= h >> 33;
+	h *= _HB_P2;
+	h ^= h >> 29;
+	h *= _HB_P3;
+	h ^= h >> 32;
+	return h;
+}
+
+static uint64_t
+_hb_hash_fold(const struct _hb_hash_state *st, int o)
+{
+	const uint64_t *v;
+	uint64_t h, k;
+	size_t i;
+
+	v = st->lanes;
+
+	if (st->total >= _HB_HASH_LANES) {
+		h = _hb_rotl(v[o ^ 0], 1) + _hb_rotl(v[o ^ 1], 7) +
+			_hb_rotl(v[o ^ 2], 12) + _hb_rotl(v[o ^ 3], 18);
+		for (i = 0; i < _HB_HASH_LANES; ++i)
+			h = _hb_hash_merge(h, v[o ^ i]);
+	} else {
+		h = (o ? _HB_P3 : 0) + _HB_P5;
+	}
+
+	h += st->total * sizeof(uint64_t);
+
+	for (i = 0; i < st->npending; ++i) {
+		k = _hb_rotl(st->pending[i] * _HB_P2, 31) * _HB_P1;
+		h ^= k;
+		h = _hb_rotl(h, o ? 29 : 27) * _HB_P1 + _HB_P4;
+	}
+
+	return _hb_hash_avalanche(h);
+}
+
+static struct hb_hash128
+_hb_hash_final(const struct _hb_hash_state *st)
+{
+	struct hb_hash128 out;
+	out.h[0] = _hb_hash_fold(st, 0);
+	out.h[1] = _hb_hash_fold(st, 3) ^ _hb_rotl(out.h[0], 17);
+	return out;
+}
+
+/////////////canonical encoding
+/* every field is widened to one 64 bit word, a canon with a hash state
+   flushes into it when full, one without is used to compare a single
+   element and never fills up */
+struct _hb_canon {
+	uint64_t                 w[_HB_CANON_WORDS];
+	size_t                   n;
+	struct _hb_hash_state   *st;
+};
+
+static void
+_hb_canon_flush(struct _hb_canon *c)
+{
+	if (c->st)
+		_hb_hash_update(c->st, c->w, c->n);
+	c->n = 0;
+}
+
+static void
+_hb_canon_u64(struct _hb_canon *c, uint64_t v)
+{
+	if (c->n == _HB_CANON_WORDS)
+		_hb_canon_flush(c);
+	c->w[c->n++] = v;
+}
+
+static void
+_hb_canon_int(struct _hb_canon *c, int64_t v)
+{
+	_hb_canon_u64(c, (uint64_t)v);
+}
+
+static void
+_hb_canon_double(struct _hb_canon *c, double v)
+{
+	uint64_t bits;
+
+	if (v == 0) bits = 0;
+	else if (isnan(v)) bits = 0x7ff8000000000000ull;
+	else memcpy(&bits, &v, sizeof(bits));
+
+	_hb_canon_u64(c, bits);
+}
+
+/* the trait goes by a hash of its name to keep to a few words,
+   hb_stadium_equal compares the names themselves */
+static void
+_hb_canon_trait(struct _hb_canon *c, const struct hb_trait *trait,
+		unsigned overrides)
+{
+	struct hb_hash128 h;
+
+	_hb_canon_int(c, overrides);
+	_hb_canon_int(c, trait && trait->name);
+	if (!trait || !trait->name)
+		return;
+	h = hb_hash_bytes(trait->name, strlen(trait->name));
+	_hb_canon_u64(c, h.h[0]);
+	_hb_canon_u64(c, h.h[1]);
+}
+
+static void
+_hb_canon_vertex(struct _hb_canon *c, const void *p)
+{
+	const struct hb_vertex *v = p;
+	_hb_canon_double(c, v->x);
+	_hb_canon_double(c, v->y);
+	_hb_canon_double(c, v->b_coef);
+	_hb_canon_int(c, v->c_group);
+	_hb_canon_int(c, v->c_mask);
+	_hb_canon_trait(c, v->trait, v->overrides);
+}
+
+static void
+_hb_canon_segment(struct _hb_canon *c, const void *p)
+{
+	const struct hb_segment *seg = p;
+	_hb_canon_int(c, seg->v0);
+	_hb_canon_int(c, seg->v1);
+	_hb_canon_double(c, seg->b_coef);
+	_hb_canon_double(c, seg->curve);
+	_hb_canon_double(c, seg->bias);
+	_hb_canon_int(c, seg->c_group);
+	_hb_canon_int(c, seg->c_mask);
+	_hb_canon_int(c, seg->vis);
+	_hb_canon_int(c, seg->color);
+	_hb_canon_trait(c, seg->trait, seg->overrides);
+}
+
+static void
+_hb_canon_goal(struct _hb_canon *c, const void *p)
+{
+	const struct hb_goal *g = p;
+	_hb_canon_double(c, g->p0[0]);
+	_hb_canon_double(c, g->p0[1]);
+	_hb_canon_double(c, g->p1[0]);
+	_hb_canon_double(c, g->p1[1]);
+	_hb_canon_int(c, g->team);
+}
+
+static void
+_hb_canon_disc(struct _hb_canon *c, const void *p)
+{
+	const struct hb_disc *d = p;
+	_hb_canon_double(c, d->pos[0]);
+	_hb_canon_double(c, d->pos[1]);
+	_hb_canon_double(c, d->speed[0]);
+	_hb_canon_double(c, d->speed[1]);
+	_hb_canon_double(c, d->gravity[0]);
+	_hb_canon_double(c, d->gravity[1]);
+	_hb_canon_double(c, d->radius);
+	_hb_canon_double(c, d->inv_mass);
+	_hb_canon_double(c, d->damping);
+	_hb_canon_int(c, d->color);
+	_hb_canon_double(c, d->b_coef);
+	_hb_canon_int(c, d->c_mask);
+	_hb_canon_int(c, d->c_group);
+	_hb_canon_trait(c, d->trait, d->overrides);
+}
+
+static void
+_hb_canon_plane(struct _hb_canon *c, const void *p)
+{
+	const struct hb_plane *pl = p;
+	_hb_canon_double(c, pl->normal[0]);
+	_hb_canon_double(c, pl->normal[1]);
+	_hb_canon_double(c, pl->dist);
+	_hb_canon_double(c, pl->b_coef);
+	_hb_canon_int(c, pl->c_mask);
+	_hb_canon_int(c, pl->c_group);
+	_hb_canon_trait(c, pl->trait, pl->overrides);
+}
+
+static void
+_hb_canon_joint(struct _hb_canon *c, const void *p)
+{
+	const struct hb_joint *j = p;
+	_hb_canon_int(c, j->d0);
+	_hb_canon_int(c, j->d1);
+	_hb_canon_int(c, j->length.kind);
+	switch (j->length.kind) {
+	case HB_JOINT_LENGTH_FIXED:
+		_hb_canon_double(c, j->length.val.f);
+		break;
+	case HB_JOINT_LENGTH_RANGE:
+		_hb_canon_double(c, j->length.val.range[0]);
+		_hb_canon_double(c, j->length.val.range[1]);
+		break;
+	case HB_JOINT_LENGTH_AUTO:
+		break;
+	}
+	_hb_canon_int(c, j->strength.is_rigid);
+	if (!j->strength.is_rigid)
+		_hb_canon_double(c, j->strength.val);
+	_hb_canon_int(c, j->color);
+}
+
+static void
+_hb_canon_point(struct _hb_canon *c, const void *p)
+{
+	const struct hb_point *pt = p;
+	_hb_canon_double(c, pt->x);
+	_hb_canon_double(c, pt->y);
+}
+
+static void
+_hb_canon_background(struct _hb_canon *c, const struct hb_background *bg)
+{
+	_hb_canon_int(c, bg != NULL);
+	if (!bg) return;
+	_hb_canon_int(c, bg->type);
+	_hb_canon_double(c, bg->width);
+	_hb_canon_double(c, bg->height);
+	_hb_canon_double(c, bg->kick_off_radius);
+	_hb_canon_double(c, bg->corner_radius);
+	_hb_canon_double(c, bg->goal_line);
+	_hb_canon_int(c, bg->color);
+}
+
+static void
+_hb_canon_player_physics(struct _hb_canon *c, const struct hb_player_physics *pp)
+{
+	_hb_canon_int(c, pp != NULL);
+	if (!pp) return;
+	_hb_canon_double(c, pp->gravity[0]);
+	_hb_canon_double(c, pp->gravity[1]);
+	_hb_canon_double(c, pp->radius);
+	_hb_canon_double(c, pp->inv_mass);
+	_hb_canon_double(c, pp->b_coef);
+	_hb_canon_double(c, pp->damping);
+	_hb_canon_int(c, pp->c_group);
+	_hb_canon_double(c, pp->acceleration);
+	_hb_canon_double(c, pp->kicking_acceleration);
+	_hb_canon_double(c, pp->kicking_damping);
+	_hb_canon_double(c, pp->kick_strength);
+	_hb_canon_double(c, pp->kickback);
+}
+
+static void
+_hb_canon_header(struct _hb_canon *c, const struct hb_stadium *s)
+{
+	_hb_canon_double(c, s->width);
+	_hb_canon_double(c, s->height);
+	_hb_canon_double(c, s->camera_width);
+	_hb_canon_double(c, s->camera_height);
+	_hb_canon_double(c, s->max_view_width);
+	_hb_canon_int(c, s->camera_follow);
+	_hb_canon_double(c, s->spawn_distance);
+	_hb_canon_int(c, s->can_be_stored);
+	_hb_canon_int(c, s->kick_off_reset);
+	_hb_canon_background(c, s->bg);
+	_hb_canon_int(c, s->ball_physics != NULL);
+	if (s->ball_physics)
+		_hb_canon_disc(c, s->ball_physics);
+	_hb_canon_player_physics(c, s->player_physics);
+}
+
+/* trait is the offset of an element's trait, 0 for lists without */
+static const struct {
+	size_t offset;
+	void (*encode)(struct _hb_canon *c, const void *p);
+	size_t trait;
+} _hb_canon_lists[] = {
+	{ offsetof(struct hb_stadium, vertexes), _hb_canon_vertex,
+		offsetof(struct hb_vertex, trait) },
+	{ offsetof(struct hb_stadium, segments), _hb_canon_segment,
+		offsetof(struct hb_segment, trait) },
+	{ offsetof(struct hb_stadium, goals), _hb_canon_goal, 0 },
+	{ offsetof(struct hb_stadium, discs), _hb_canon_disc,
+		offsetof(struct hb_disc, trait) },
+	{ offsetof(struct hb_stadium, planes), _hb_canon_plane,
+		offsetof(struct hb_plane, trait) },
+	{ offsetof(struct hb_stadium, joints), _hb_canon_joint, 0 },
+	{ offsetof(struct hb_stadium, red_spawn_points), _hb_canon_point, 0 },
+	{ offsetof(struct hb_stadium, blue_spawn_points), _hb_canon_point, 0 }
+};
+
+#define _HB_CANON_LISTS (sizeof(_hb_canon_lists) / sizeof(_hb_canon_lists[0]))
+
+static void *const *
+_hb_canon_list(const struct hb_stadium *s, size_t i)
+{
+	return *(void *const *const *)((const char *)s + _hb_canon_lists[i].offset);
+}
+
+static const char *
+_hb_canon_trait_name(const void *e, size_t offset)
+{
+	const struct hb_trait *trait;
+	memcpy(&trait, (const char *)e + offset, sizeof(trait));
+	return trait ? trait->name : NULL;
+}
+
+static bool
+_hb_canon_same_trait(const void *a, const void *b, size_t offset)
+{
+	const char *na, *nb;
+	na = _hb_canon_trait_name(a, offset);
+	nb = _hb_canon_trait_name(b, offset);
+	return na == nb || (na && nb && !strcmp(na, nb));
+}
+
+static uint64_t
+_hb_canon_count(void *const *list)
+{
+	uint64_t count;
+	count = 0;
+	if (list)
+		while (list[count])
+			++count;
+	return count;
+}
+
+/////////////public
+extern struct hb_hash128
+hb_hash_bytes(const void *data, size_t len)
+{
+	struct _hb_hash_state st;
+	uint64_t w[_HB_CANON_WORDS];
+	const unsigned char *p;
+	size_t chunk, words;
+
+	_hb_hash_init(&st);
+	p = data;
+
+	while (len >= sizeof(uint64_t)) {
+		chunk = len - len % sizeof(uint64_t);
+		if (chunk > sizeof(w)) chunk = sizeof(w);
+		words = chunk / sizeof(uint64_t);
+		memcpy(w, p, chunk);
+		_hb_hash_update(&st, w, words);
+		p += chunk;
+		len -= chunk;
+	}
+
+	w[0] = 0;
+	memcpy(w, p, len);
+	w[1] = len;
+	_hb_hash_update(&st, w, 2);
+
+	return _hb_hash_final(&st);
+}
+
+extern struct hb_hash128
+hb_stadium_hash(const struct hb_stadium *s)
+{
+	struct _hb_hash_state st;
+	struct _hb_canon c;
+	void *const *list;
+	uint64_t count, i;
+	size_t l, len;
+
+	_hb_hash_init(&st);
+	c.n = 0;
+	c.st = &st;
+
+	len = strlen(s->name);
+	_hb_canon_u64(&c, len);
+	for (i = 0; i < len; i += sizeof(uint64_t)) {
+		uint64_t w = 0;
+		memcpy(&w, s->name + i, len - i < sizeof(w) ? len - i : sizeof(w));
+		_hb_canon_u64(&c, w);
+	}
+
+	_hb_canon_header(&c, s);
+
+	for (l = 0; l < _HB_CANON_LISTS; ++l) {
+		list = _hb_canon_list(s, l);
+		count = _hb_canon_count(list);
+		_hb_canon_u64(&c, count);
+		for (i = 0; i < count; ++i)
+			_hb_canon_lists[l].encode(&c, list[i]);
+	}
+
+	_hb_canon_flush(&c);
+
+	return _hb_hash_final(&st);
+}
+
+extern bool
+hb_stadium_equal(const struct hb_stadium *a, const struct hb_stadium *b)
+{
+	struct _hb_canon ca, cb;
+	void *const *la, *const *lb;
+	uint64_t count, i;
+	size_t l;
+
+	if (a == b)
+		return true;
+
+	if (strcmp(a->name, b->name))
+		return false;
+
+	ca.n = cb.n = 0;
+	ca.st = cb.st = NULL;
+	_hb_canon_header(&ca, a);
+	_hb_canon_header(&cb, b);
+	if (ca.n != cb.n || memcmp(ca.w, cb.w, ca.n * sizeof(uint64_t)))
+		return false;
+
+	for (l = 0; l < _HB_CANON_LISTS; ++l) {
+		la = _hb_canon_list(a, l);
+		lb = _hb_canon_list(b, l);
+		if ((count = _hb_canon_count(la)) != _hb_canon_count(lb))
+			return false;
+		for (i = 0; i < count; ++i) {
+			ca.n = cb.n = 0;
+			_hb_canon_lists[l].encode(&ca, la[i]);
+			_hb_canon_lists[l].encode(&cb, lb[i]);
+			if (ca.n != cb.n || memcmp(ca.w, cb.w, ca.n * sizeof(uint64_t)))
+				return false;
+			if (_hb_canon_lists[l].trait &&
+					!_hb_canon_same_trait(la[i], lb[i], _hb_canon_lists[l].trait))
+				return false;
+		}
+	}
+
+	return true;
+}
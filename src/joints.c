@@ -0,0 +1,417 @@
+#include <hb/joints.h>
+#include <hb/joint.h>
+#include <hb/stadium.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/////////////batches
+
+/* greedy coloring in the order of the stadium, a joint takes the first
+   color none of the joints before it on its discs has */
+static int
+_hb_joints_color(const uint32_t *d0, const uint32_t *d1, size_t n,
+		size_t discs_count, size_t *color, size_t *colors_count)
+{
+	size_t *start, *stamp, k, m, c;
+	uint32_t *adjacent, d;
+	int side;
+
+	start = calloc(discs_count + 1, sizeof(size_t));
+	stamp = calloc(n + 1, sizeof(size_t));
+	adjacent = malloc((2 * n + 1) * sizeof(uint32_t));
+	if (!start || !stamp || !adjacent) {
+		free(start);
+		free(stamp);
+		free(adjacent);
+		return -1;
+	}
+
+	for (k = 0; k < n; ++k) {
+		++start[d0[k] + 1];
+		++start[d1[k] + 1];
+	}
+	for (k = 0; k < discs_count; ++k)
+		start[k + 1] += start[k];
+
+	/* start[d] runs ahead while filling and is put back after */
+	for (k = 0; k < n; ++k) {
+		adjacent[start[d0[k]]++] = k;
+		adjacent[start[d1[k]]++] = k;
+	}
+	for (k = discs_count; k > 0; --k)
+		start[k] = start[k - 1];
+	start[0] = 0;
+
+	*colors_count = 0;
+	for (k = 0; k < n; ++k) {
+		for (side = 0; side < 2; ++side) {
+			d = side ? d1[k] : d0[k];
+			for (m = start[d]; m < start[d + 1] && adjacent[m] < k; ++m)
+				stamp[color[adjacent[m]]] = k + 1;
+		}
+		for (c = 0; stamp[c] == k + 1; ++c)
+			;
+		color[k] = c;
+		if (c + 1 > *colors_count)
+			*colors_count = c + 1;
+	}
+
+	free(start);
+	free(stamp);
+	free(adjacent);
+
+	return 0;
+}
+
+extern struct hb_joints *
+hb_joints_build(const struct hb_stadium *s, const double *x, const double *y,
+		size_t discs_count)
+{
+	struct hb_joints *j;
+	const struct hb_joint *joint;
+	uint32_t *d0, *d1;
+	size_t *color, *at, count, n, i, k;
+	double min, max;
+
+	if (discs_count > UINT32_MAX || NULL == (j = calloc(1, sizeof(struct hb_joints))))
+		return NULL;
+
+	for (count = 0; s->joints && s->joints[count]; ++count)
+		;
+
+	d0 = malloc((count + 1) * sizeof(uint32_t));
+	d1 = malloc((count + 1) * sizeof(uint32_t));
+	color = malloc((count + 1) * sizeof(size_t));
+	at = NULL;
+	if (!d0 || !d1 || !color ||
+			NULL == (j->d0 = malloc((count + 1) * sizeof(uint32_t))) ||
+			NULL == (j->d1 = malloc((count + 1) * sizeof(uint32_t))) ||
+			NULL == (j->min = malloc((count + 1) * sizeof(double))) ||
+			NULL == (j->max = malloc((count + 1) * sizeof(double))) ||
+			NULL == (j->strength = malloc((count + 1) * sizeof(double))))
+		goto err;
+
+	for (i = n = 0; i < count; ++i) {
+		joint = s->joints[i];
+		if (joint->d0 < 0 || (size_t)joint->d0 >= discs_count ||
+				joint->d1 < 0 || (size_t)joint->d1 >= discs_count)
+			continue;
+		d0[n] = joint->d0;
+		d1[n] = joint->d1;
+		++n;
+	}
+
+	if (_hb_joints_color(d0, d1, n, discs_count, color, &j->batches_count) < 0 ||
+			NULL == (j->start = calloc(j->batches_count + 1, sizeof(size_t))) ||
+			NULL == (at = malloc((j->batches_count + 1) * sizeof(size_t))))
+		goto err;
+
+	for (k = 0; k < n; ++k)
+		++j->start[color[k] + 1];
+	for (k = 0; k < j->batches_count; ++k) {
+		j->start[k + 1] += j->start[k];
+		at[k] = j->start[k];
+	}
+
+	for (i = n = 0; i < count; ++i) {
+		joint = s->joints[i];
+		if (joint->d0 < 0 || (size_t)joint->d0 >= discs_count ||
+				joint->d1 < 0 || (size_t)joint->d1 >= discs_count)
+			continue;
+		switch (joint->length.kind) {
+		case HB_JOINT_LENGTH_FIXED:
+			min = max = joint->length.val.f;
+			break;
+		case HB_JOINT_LENGTH_RANGE:
+			min = joint->length.val.range[0];
+			max = joint->length.val.range[1];
+			break;
+		default:
+			min = max = hypot(x[joint->d0] - x[joint->d1], y[joint->d0] - y[joint->d1]);
+			break;
+		}
+		k = at[color[n++]]++;
+		j->d0[k] = joint->d0;
+		j->d1[k] = joint->d1;
+		j->min[k] = min;
+		j->max[k] = max;
+		j->strength[k] = joint->strength.is_rigid ? INFINITY : joint->strength.val;
+	}
+
+	j->count = n;
+
+	free(d0);
+	free(d1);
+	free(color);
+	free(at);
+
+	return j;
+
+err:
+	free(d0);
+	free(d1);
+	free(color);
+	free(at);
+	hb_joints_free(j);
+	return NULL;
+}
+
+extern void
+hb_joints_free(struct hb_joints *j)
+{
+	if (!j)
+		return;
+	free(j->start);
+	free(j->d0);
+	free(j->d1);
+	free(j->min);
+	free(j->max);
+	free(j->strength);
+	free(j);
+}
+
+/////////////scalar
+
+/* the positions are put back in range, a rigid joint also loses the
+   part of the speed that leaves it and an elastic one pulls with a
+   force of its strength times how far out of range it is */
+static void
+_hb_joints_solve_one(const struct hb_joints *j, size_t k, double *x, double *y,
+		double *speed_x, double *speed_y, const double *inv_mass)
+{
+	double dx, dy, dist, share, target, off, v, f;
+	size_t a, b;
+	int side;
+
+	a = j->d0[k];
+	b = j->d1[k];
+	dx = x[a] - x[b];
+	dy = y[a] - y[b];
+	dist = sqrt(dx * dx + dy * dy);
+
+	if (dist <= 0)
+		return;
+
+	dx /= dist;
+	dy /= dist;
+	share = inv_mass[a] / (inv_mass[a] + inv_mass[b]);
+	if (share != share)
+		share = 0.5;
+
+	if (j->min[k] >= j->max[k]) {
+		target = j->min[k];
+		side = 0;
+	} else if (dist <= j->min[k]) {
+		target = j->min[k];
+		side = 1;
+	} else if (dist >= j->max[k]) {
+		target = j->max[k];
+		side = -1;
+	} else {
+		return;
+	}
+
+	off = dist - target;
+
+	if (isinf(j->strength[k])) {
+		x[a] -= dx * off * share;
+		y[a] -= dy * off * share;
+		x[b] += dx * off * (1 - share);
+		y[b] += dy * off * (1 - share);
+		/* only the part of the speed that leaves the allowed range */
+		v = dx * (speed_x[a] - speed_x[b]) + dy * (speed_y[a] - speed_y[b]);
+		if (side == 0 || v * side < 0) {
+			speed_x[a] -= dx * v * share;
+			speed_y[a] -= dy * v * share;
+			speed_x[b] += dx * v * (1 - share);
+			speed_y[b] += dy * v * (1 - share);
+		}
+	} else {
+		f = off * j->strength[k];
+		speed_x[a] -= dx * f * inv_mass[a];
+		speed_y[a] -= dy * f * inv_mass[a];
+		speed_x[b] += dx * f * inv_mass[b];
+		speed_y[b] += dy * f * inv_mass[b];
+	}
+}
+
+/////////////vector
+
+/* every lane works out what _hb_joints_solve_one would, in the same
+   order, and keeps the old value where it would have left it alone.
+   the joints of a batch share no disc so they are all read before any
+   is written back */
+#if defined(__AVX__)
+#define _HB_JOINTS_LANES 4
+typedef __m256d _hb_joints_vec;
+#define _hb_v_set1 _mm256_set1_pd
+#define _hb_v_add _mm256_add_pd
+#define _hb_v_sub _mm256_sub_pd
+#define _hb_v_mul _mm256_mul_pd
+#define _hb_v_div _mm256_div_pd
+#define _hb_v_sqrt _mm256_sqrt_pd
+#define _hb_v_and _mm256_and_pd
+#define _hb_v_or _mm256_or_pd
+#define _hb_v_andnot _mm256_andnot_pd
+#define _hb_v_blend(a,b,m) _mm256_blendv_pd(a, b, m)
+#define _hb_v_lt(a,b) _mm256_cmp_pd(a, b, _CMP_LT_OQ)
+#define _hb_v_le(a,b) _mm256_cmp_pd(a, b, _CMP_LE_OQ)
+#define _hb_v_gt(a,b) _mm256_cmp_pd(a, b, _CMP_GT_OQ)
+#define _hb_v_ge(a,b) _mm256_cmp_pd(a, b, _CMP_GE_OQ)
+#define _hb_v_eq(a,b) _mm256_cmp_pd(a, b, _CMP_EQ_OQ)
+#define _hb_v_nan(a) _mm256_cmp_pd(a, a, _CMP_UNORD_Q)
+#define _hb_v_bits _mm256_movemask_pd
+#define _hb_v_store _mm256_storeu_pd
+#define _hb_v_load(a,i) _mm256_set_pd((a)[(i)[3]], (a)[(i)[2]], (a)[(i)[1]], (a)[(i)[0]])
+#define _hb_v_loadu _mm256_loadu_pd
+/* see narrowphase.c */
+#define _hb_v_done _mm256_zeroupper
+#elif defined(__SSE2__)
+#define _HB_JOINTS_LANES 2
+typedef __m128d _hb_joints_vec;
+#define _hb_v_set1 _mm_set1_pd
+#define _hb_v_add _mm_add_pd
+#define _hb_v_sub _mm_sub_pd
+#define _hb_v_mul _mm_mul_pd
+#define _hb_v_div _mm_div_pd
+#define _hb_v_sqrt _mm_sqrt_pd
+#define _hb_v_and _mm_and_pd
+#define _hb_v_or _mm_or_pd
+#define _hb_v_andnot _mm_andnot_pd
+#define _hb_v_blend(a,b,m) _mm_or_pd(_mm_and_pd(m, b), _mm_andnot_pd(m, a))
+#define _hb_v_lt _mm_cmplt_pd
+#define _hb_v_le _mm_cmple_pd
+#define _hb_v_gt _mm_cmpgt_pd
+#define _hb_v_ge _mm_cmpge_pd
+#define _hb_v_eq _mm_cmpeq_pd
+#define _hb_v_nan(a) _mm_cmpunord_pd(a, a)
+#define _hb_v_bits _mm_movemask_pd
+#define _hb_v_store _mm_storeu_pd
+#define _hb_v_load(a,i) _mm_set_pd((a)[(i)[1]], (a)[(i)[0]])
+#define _hb_v_loadu _mm_loadu_pd
+#define _hb_v_done()
+#else
+#define _hb_v_done()
+#endif
+
+#ifdef _HB_JOINTS_LANES
+
+static void
+_hb_joints_scatter(double *to, const uint32_t *index, _hb_joints_vec v)
+{
+	double lanes[_HB_JOINTS_LANES];
+	size_t l;
+	_hb_v_store(lanes, v);
+	for (l = 0; l < _HB_JOINTS_LANES; ++l)
+		to[index[l]] = lanes[l];
+}
+
+static void
+_hb_joints_solve_lanes(const struct hb_joints *j, size_t k, double *x, double *y,
+		double *speed_x, double *speed_y, const double *inv_mass)
+{
+	const uint32_t *a, *b;
+	_hb_joints_vec zero, one, sign, xa, ya, xb, yb, sxa, sya, sxb, syb, ma, mb,
+		min, max, dx, dy, dist, share, fixed, low, high, active, target, off,
+		rigid, v, keep, ox, oy, vx, vy, fx, fy;
+
+	a = j->d0 + k;
+	b = j->d1 + k;
+	zero = _hb_v_set1(0.0);
+	one = _hb_v_set1(1.0);
+	sign = _hb_v_set1(-0.0);
+
+	xa = _hb_v_load(x, a);
+	ya = _hb_v_load(y, a);
+	xb = _hb_v_load(x, b);
+	yb = _hb_v_load(y, b);
+	min = _hb_v_loadu(j->min + k);
+	max = _hb_v_loadu(j->max + k);
+
+	/////////////range
+	dx = _hb_v_sub(xa, xb);
+	dy = _hb_v_sub(ya, yb);
+	dist = _hb_v_sqrt(_hb_v_add(_hb_v_mul(dx, dx), _hb_v_mul(dy, dy)));
+	fixed = _hb_v_ge(min, max);
+	low = _hb_v_andnot(fixed, _hb_v_le(dist, min));
+	high = _hb_v_andnot(_hb_v_or(fixed, low), _hb_v_ge(dist, max));
+	active = _hb_v_and(_hb_v_gt(dist, zero), _hb_v_or(_hb_v_or(fixed, low), high));
+
+	/* joints within their range are the common case */
+	if (!_hb_v_bits(active))
+		return;
+
+	sxa = _hb_v_load(speed_x, a);
+	sya = _hb_v_load(speed_y, a);
+	sxb = _hb_v_load(speed_x, b);
+	syb = _hb_v_load(speed_y, b);
+	ma = _hb_v_load(inv_mass, a);
+	mb = _hb_v_load(inv_mass, b);
+
+	dx = _hb_v_div(dx, dist);
+	dy = _hb_v_div(dy, dist);
+	share = _hb_v_div(ma, _hb_v_add(ma, mb));
+	share = _hb_v_blend(share, _hb_v_set1(0.5), _hb_v_nan(share));
+	target = _hb_v_blend(min, max, high);
+	off = _hb_v_sub(dist, target);
+	rigid = _hb_v_eq(_hb_v_andnot(sign, _hb_v_loadu(j->strength + k)),
+			_hb_v_set1(INFINITY));
+
+	/////////////positions
+	ox = _hb_v_mul(dx, off);
+	oy = _hb_v_mul(dy, off);
+	keep = _hb_v_and(active, rigid);
+	_hb_joints_scatter(x, a, _hb_v_blend(xa, _hb_v_sub(xa, _hb_v_mul(ox, share)), keep));
+	_hb_joints_scatter(y, a, _hb_v_blend(ya, _hb_v_sub(ya, _hb_v_mul(oy, share)), keep));
+	_hb_joints_scatter(x, b, _hb_v_blend(xb,
+				_hb_v_add(xb, _hb_v_mul(ox, _hb_v_sub(one, share))), keep));
+	_hb_joints_scatter(y, b, _hb_v_blend(yb,
+				_hb_v_add(yb, _hb_v_mul(oy, _hb_v_sub(one, share))), keep));
+
+	/////////////speeds
+	v = _hb_v_add(_hb_v_mul(dx, _hb_v_sub(sxa, sxb)), _hb_v_mul(dy, _hb_v_sub(sya, syb)));
+	/* elastic joints always, rigid ones as _hb_joints_solve_one decides */
+	keep = _hb_v_or(_hb_v_andnot(rigid, active), _hb_v_and(active, _hb_v_or(fixed,
+					_hb_v_or(_hb_v_and(low, _hb_v_lt(v, zero)),
+						_hb_v_and(high, _hb_v_gt(v, zero))))));
+	vx = _hb_v_mul(dx, v);
+	vy = _hb_v_mul(dy, v);
+	off = _hb_v_mul(off, _hb_v_loadu(j->strength + k));
+	fx = _hb_v_mul(dx, off);
+	fy = _hb_v_mul(dy, off);
+	_hb_joints_scatter(speed_x, a, _hb_v_blend(sxa, _hb_v_sub(sxa, _hb_v_blend(
+						_hb_v_mul(fx, ma), _hb_v_mul(vx, share), rigid)), keep));
+	_hb_joints_scatter(speed_y, a, _hb_v_blend(sya, _hb_v_sub(sya, _hb_v_blend(
+						_hb_v_mul(fy, ma), _hb_v_mul(vy, share), rigid)), keep));
+	_hb_joints_scatter(speed_x, b, _hb_v_blend(sxb, _hb_v_add(sxb, _hb_v_blend(
+						_hb_v_mul(fx, mb), _hb_v_mul(vx, _hb_v_sub(one, share)), rigid)), keep));
+	_hb_joints_scatter(speed_y, b, _hb_v_blend(syb, _hb_v_add(syb, _hb_v_blend(
+						_hb_v_mul(fy, mb), _hb_v_mul(vy, _hb_v_sub(one, share)), rigid)), keep));
+}
+
+#endif
+
+extern void
+hb_joints_solve(const struct hb_joints *j, double *x, double *y,
+		double *speed_x, double *speed_y, const double *inv_mass)
+{
+	size_t b, k;
+
+	for (b = 0; b < j->batches_count; ++b) {
+		k = j->start[b];
+#ifdef _HB_JOINTS_LANES
+		for (; k + _HB_JOINTS_LANES <= j->start[b + 1]; k += _HB_JOINTS_LANES)
+			_hb_joints_solve_lanes(j, k, x, y, speed_x, speed_y, inv_mass);
+#endif
+		for (; k < j->start[b + 1]; ++k)
+			_hb_joints_solve_one(j, k, x, y, speed_x, speed_y, inv_mass);
+	}
+
+	_hb_v_done();
+}
@@ -0,0 +1,326 @@
+#include <hb/narrowphase.h>
+#include <hb/geometry.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/////////////vector
+
+/* the vector code does the same operations in the same order as the
+   scalar code, lane by lane, so both come to the same answer */
+#if defined(__AVX__)
+#define _HB_NARROWPHASE_LANES 4
+typedef __m256d _hb_narrowphase_vec;
+#define _hb_v_set1 _mm256_set1_pd
+#define _hb_v_zero _mm256_setzero_pd
+#define _hb_v_add _mm256_add_pd
+#define _hb_v_sub _mm256_sub_pd
+#define _hb_v_mul _mm256_mul_pd
+#define _hb_v_sqrt _mm256_sqrt_pd
+#define _hb_v_and _mm256_and_pd
+#define _hb_v_or _mm256_or_pd
+#define _hb_v_xor _mm256_xor_pd
+#define _hb_v_andnot _mm256_andnot_pd
+#define _hb_v_blend(a,b,m) _mm256_blendv_pd(a, b, m)
+#define _hb_v_lt(a,b) _mm256_cmp_pd(a, b, _CMP_LT_OQ)
+#define _hb_v_le(a,b) _mm256_cmp_pd(a, b, _CMP_LE_OQ)
+#define _hb_v_gt(a,b) _mm256_cmp_pd(a, b, _CMP_GT_OQ)
+#define _hb_v_ge(a,b) _mm256_cmp_pd(a, b, _CMP_GE_OQ)
+#define _hb_v_eq(a,b) _mm256_cmp_pd(a, b, _CMP_EQ_OQ)
+#define _hb_v_bits _mm256_movemask_pd
+#define _hb_v_store _mm256_storeu_pd
+/* the compiler does not always clear the upper halves on the way out,
+   sse code in libm would pay for them on every call */
+#define _hb_v_done _mm256_zeroupper
+#if defined(__AVX2__)
+/* indexes are taken as signed, a geometry never gets near 2^31 walls */
+#define _hb_v_load(a,i) \
+	_mm256_i32gather_pd(a, _mm_loadu_si128((const __m128i *)(i)), 8)
+#else
+#define _hb_v_load(a,i) _mm256_set_pd((a)[(i)[3]], (a)[(i)[2]], (a)[(i)[1]], (a)[(i)[0]])
+#endif
+#elif defined(__SSE2__)
+#define _HB_NARROWPHASE_LANES 2
+typedef __m128d _hb_narrowphase_vec;
+#define _hb_v_set1 _mm_set1_pd
+#define _hb_v_zero _mm_setzero_pd
+#define _hb_v_add _mm_add_pd
+#define _hb_v_sub _mm_sub_pd
+#define _hb_v_mul _mm_mul_pd
+#define _hb_v_sqrt _mm_sqrt_pd
+#define _hb_v_and _mm_and_pd
+#define _hb_v_or _mm_or_pd
+#define _hb_v_xor _mm_xor_pd
+#define _hb_v_andnot _mm_andnot_pd
+#define _hb_v_blend(a,b,m) _mm_or_pd(_mm_and_pd(m, b), _mm_andnot_pd(m, a))
+#define _hb_v_lt _mm_cmplt_pd
+#define _hb_v_le _mm_cmple_pd
+#define _hb_v_gt _mm_cmpgt_pd
+#define _hb_v_ge _mm_cmpge_pd
+#define _hb_v_eq _mm_cmpeq_pd
+#define _hb_v_bits _mm_movemask_pd
+#define _hb_v_store _mm_storeu_pd
+#define _hb_v_load(a,i) _mm_set_pd((a)[(i)[1]], (a)[(i)[0]])
+#define _hb_v_done()
+#endif
+
+#ifdef _HB_NARROWPHASE_LANES
+
+typedef unsigned (*_hb_narrowphase_lanes_fn)(const struct hb_geometry *,
+		const uint32_t *, double, double, double, double *);
+
+static unsigned
+_hb_narrowphase_planes_lanes(const struct hb_geometry *g, const uint32_t *index,
+		double x, double y, double r, double *depth)
+{
+	_hb_narrowphase_vec pen;
+	pen = _hb_v_add(_hb_v_sub(_hb_v_load(g->plane_dist, index),
+				_hb_v_add(_hb_v_mul(_hb_v_load(g->plane_normal_x, index), _hb_v_set1(x)),
+					_hb_v_mul(_hb_v_load(g->plane_normal_y, index), _hb_v_set1(y)))),
+			_hb_v_set1(r));
+	_hb_v_store(depth, pen);
+	return _hb_v_bits(_hb_v_gt(pen, _hb_v_zero()));
+}
+
+static unsigned
+_hb_narrowphase_segments_lanes(const struct hb_geometry *g, const uint32_t *index,
+		double x, double y, double r, double *depth)
+{
+	_hb_narrowphase_vec vx, vy, vr, zero, sign, ex, ey, ax, ay, a, b, dx, dy,
+		inside, len, cot, straight, dist, miss, bias, nobias, flipped, hit;
+
+	vx = _hb_v_set1(x);
+	vy = _hb_v_set1(y);
+	vr = _hb_v_set1(r);
+	zero = _hb_v_zero();
+	sign = _hb_v_set1(-0.0);
+
+	/////////////straight
+	ex = _hb_v_sub(_hb_v_load(g->v1_x, index), _hb_v_load(g->v0_x, index));
+	ey = _hb_v_sub(_hb_v_load(g->v1_y, index), _hb_v_load(g->v0_y, index));
+	ax = _hb_v_sub(vx, _hb_v_load(g->v0_x, index));
+	ay = _hb_v_sub(vy, _hb_v_load(g->v0_y, index));
+	a = _hb_v_add(_hb_v_mul(ax, ex), _hb_v_mul(ay, ey));
+	b = _hb_v_add(_hb_v_mul(_hb_v_sub(vx, _hb_v_load(g->v1_x, index)), ex),
+			_hb_v_mul(_hb_v_sub(vy, _hb_v_load(g->v1_y, index)), ey));
+	miss = _hb_v_or(_hb_v_le(a, zero), _hb_v_ge(b, zero));
+	dist = _hb_v_add(_hb_v_mul(_hb_v_load(g->normal_x, index), ax),
+			_hb_v_mul(_hb_v_load(g->normal_y, index), ay));
+
+	/////////////arc
+	/* straight segments are the ones compiled with an infinite cot */
+	cot = _hb_v_load(g->cot, index);
+	straight = _hb_v_eq(cot, _hb_v_set1(INFINITY));
+	dx = _hb_v_sub(vx, _hb_v_load(g->center_x, index));
+	dy = _hb_v_sub(vy, _hb_v_load(g->center_y, index));
+	inside = _hb_v_and(
+			_hb_v_gt(_hb_v_add(_hb_v_mul(dx, _hb_v_load(g->t0_x, index)),
+					_hb_v_mul(dy, _hb_v_load(g->t0_y, index))), zero),
+			_hb_v_gt(_hb_v_add(_hb_v_mul(dx, _hb_v_load(g->t1_x, index)),
+					_hb_v_mul(dy, _hb_v_load(g->t1_y, index))), zero));
+	len = _hb_v_sqrt(_hb_v_add(_hb_v_mul(dx, dx), _hb_v_mul(dy, dy)));
+	miss = _hb_v_blend(_hb_v_or(_hb_v_xor(inside, _hb_v_gt(cot, zero)),
+				_hb_v_eq(len, zero)), miss, straight);
+	dist = _hb_v_blend(_hb_v_sub(_hb_v_load(g->radius, index), len), dist, straight);
+
+	/////////////bias
+	bias = _hb_v_load(g->bias, index);
+	nobias = _hb_v_eq(bias, zero);
+	flipped = _hb_v_blend(dist, _hb_v_xor(dist, sign), _hb_v_lt(bias, zero));
+	miss = _hb_v_or(miss, _hb_v_andnot(nobias,
+				_hb_v_lt(flipped, _hb_v_xor(_hb_v_andnot(sign, bias), sign))));
+	dist = _hb_v_blend(flipped, _hb_v_andnot(sign, dist), nobias);
+
+	hit = _hb_v_andnot(miss, _hb_v_lt(dist, vr));
+	_hb_v_store(depth, _hb_v_sub(vr, dist));
+	return _hb_v_bits(hit);
+}
+
+static unsigned
+_hb_narrowphase_vertexes_lanes(const struct hb_geometry *g, const uint32_t *index,
+		double x, double y, double r, double *depth)
+{
+	_hb_narrowphase_vec vr, dx, dy, dist;
+	vr = _hb_v_set1(r);
+	dx = _hb_v_sub(_hb_v_set1(x), _hb_v_load(g->vertex_x, index));
+	dy = _hb_v_sub(_hb_v_set1(y), _hb_v_load(g->vertex_y, index));
+	dist = _hb_v_add(_hb_v_mul(dx, dx), _hb_v_mul(dy, dy));
+	_hb_v_store(depth, _hb_v_sub(vr, _hb_v_sqrt(dist)));
+	return _hb_v_bits(_hb_v_and(_hb_v_gt(dist, _hb_v_zero()),
+				_hb_v_le(dist, _hb_v_mul(vr, vr))));
+}
+
+/* the last index fills the lanes past count, their bits are dropped */
+static unsigned
+_hb_narrowphase_run(_hb_narrowphase_lanes_fn lanes, const struct hb_geometry *g,
+		const uint32_t *index, size_t count, double x, double y, double r,
+		double *depth)
+{
+	uint32_t padded[HB_NARROWPHASE_BATCH + _HB_NARROWPHASE_LANES];
+	double depths[HB_NARROWPHASE_BATCH + _HB_NARROWPHASE_LANES];
+	unsigned bits;
+	size_t j;
+
+	if (count == 0)
+		return 0;
+	if (count > HB_NARROWPHASE_BATCH)
+		count = HB_NARROWPHASE_BATCH;
+
+	for (j = 0; j < count; ++j)
+		padded[j] = index[j];
+	for (; j % _HB_NARROWPHASE_LANES; ++j)
+		padded[j] = index[count - 1];
+
+	for (j = 0, bits = 0; j < count; j += _HB_NARROWPHASE_LANES)
+		bits |= lanes(g, padded + j, x, y, r, depths + j) << j;
+
+	_hb_v_done();
+
+	for (j = 0; depth && j < count; ++j)
+		depth[j] = depths[j];
+
+	return bits & ((1u << count) - 1);
+}
+
+#else
+
+/////////////scalar
+
+static bool
+_hb_narrowphase_plane(const struct hb_geometry *g, size_t k,
+		double x, double y, double r, double *depth)
+{
+	double pen;
+	pen = g->plane_dist[k] - (g->plane_normal_x[k] * x +
+			g->plane_normal_y[k] * y) + r;
+	*depth = pen;
+	return pen > 0;
+}
+
+static bool
+_hb_narrowphase_segment(const struct hb_geometry *g, size_t k,
+		double x, double y, double r, double *depth)
+{
+	double dx, dy, ex, ey, dist, len, bias;
+
+	if (!g->arc[k]) {
+		ex = g->v1_x[k] - g->v0_x[k];
+		ey = g->v1_y[k] - g->v0_y[k];
+		if ((x - g->v0_x[k]) * ex + (y - g->v0_y[k]) * ey <= 0 ||
+				(x - g->v1_x[k]) * ex + (y - g->v1_y[k]) * ey >= 0)
+			return false;
+		dist = g->normal_x[k] * (x - g->v0_x[k]) + g->normal_y[k] * (y - g->v0_y[k]);
+	} else {
+		dx = x - g->center_x[k];
+		dy = y - g->center_y[k];
+		if (!hb_geometry_arc_contains(g, k, dx, dy))
+			return false;
+		len = sqrt(dx * dx + dy * dy);
+		if (len == 0)
+			return false;
+		dist = g->radius[k] - len;
+	}
+
+	bias = g->bias[k];
+	if (bias == 0) {
+		if (dist < 0)
+			dist = -dist;
+	} else {
+		if (bias < 0) {
+			bias = -bias;
+			dist = -dist;
+		}
+		if (dist < -bias)
+			return false;
+	}
+
+	*depth = r - dist;
+	return dist < r;
+}
+
+static bool
+_hb_narrowphase_vertex(const struct hb_geometry *g, size_t k,
+		double x, double y, double r, double *depth)
+{
+	double dx, dy, dist;
+	dx = x - g->vertex_x[k];
+	dy = y - g->vertex_y[k];
+	dist = dx * dx + dy * dy;
+	if (!(dist > 0 && dist <= r * r))
+		return false;
+	*depth = r - sqrt(dist);
+	return true;
+}
+
+typedef bool (*_hb_narrowphase_one_fn)(const struct hb_geometry *, size_t,
+		double, double, double, double *);
+
+static unsigned
+_hb_narrowphase_run(_hb_narrowphase_one_fn one, const struct hb_geometry *g,
+		const uint32_t *index, size_t count, double x, double y, double r,
+		double *depth)
+{
+	double d;
+	unsigned bits;
+	size_t j;
+
+	if (count > HB_NARROWPHASE_BATCH)
+		count = HB_NARROWPHASE_BATCH;
+
+	for (j = 0, bits = 0; j < count; ++j) {
+		if (!one(g, index[j], x, y, r, &d))
+			continue;
+		bits |= 1u << j;
+		if (depth)
+			depth[j] = d;
+	}
+
+	return bits;
+}
+
+#endif
+
+extern unsigned
+hb_narrowphase_planes(const struct hb_geometry *g, const uint32_t *index,
+		size_t count, double x, double y, double r, double *depth)
+{
+#ifdef _HB_NARROWPHASE_LANES
+	return _hb_narrowphase_run(_hb_narrowphase_planes_lanes, g, index, count,
+			x, y, r, depth);
+#else
+	return _hb_narrowphase_run(_hb_narrowphase_plane, g, index, count,
+			x, y, r, depth);
+#endif
+}
+
+extern unsigned
+hb_narrowphase_segments(const struct hb_geometry *g, const uint32_t *index,
+		size_t count, double x, double y, double r, double *depth)
+{
+#ifdef _HB_NARROWPHASE_LANES
+	return _hb_narrowphase_run(_hb_narrowphase_segments_lanes, g, index, count,
+			x, y, r, depth);
+#else
+	return _hb_narrowphase_run(_hb_narrowphase_segment, g, index, count,
+			x, y, r, depth);
+#endif
+}
+
+extern unsigned
+hb_narrowphase_vertexes(const struct hb_geometry *g, const uint32_t *index,
+		size_t count, double x, double y, double r, double *depth)
+{
+#ifdef _HB_NARROWPHASE_LANES
+	return _hb_narrowphase_run(_hb_narrowphase_vertexes_lanes, g, index, count,
+			x, y, r, depth);
+#else
+	return _hb_narrowphase_run(_hb_narrowphase_vertex, g, index, count,
+			x, y, r, depth);
+#endif
+}
@@ -0,0 +1,294 @@
+#include <hb/optimize.h>
+#include <hb/stadium.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define _HB_OPTIMIZE_NONE SIZE_MAX
+
+struct _hb_optimize_point {
+	double                                x;
+	double                                y;
+	size_t                            index;
+};
+
+static size_t
+_hb_optimize_count(void *const *list)
+{
+	size_t count;
+	count = 0;
+	if (list)
+		while (list[count])
+			++count;
+	return count;
+}
+
+static int
+_hb_optimize_point_cmp(const void *a, const void *b)
+{
+	const struct _hb_optimize_point *pa = a, *pb = b;
+	if (pa->x != pb->x) return pa->x < pb->x ? -1 : 1;
+	if (pa->y != pb->y) return pa->y < pb->y ? -1 : 1;
+	return pa->index < pb->index ? -1 : pa->index > pb->index;
+}
+
+/* the trait and overrides count too, hb_stadium_set_trait_field would
+   tell the two apart later */
+static bool
+_hb_optimize_vertex_same(const struct hb_vertex *a, const struct hb_vertex *b)
+{
+	return a->x == b->x && a->y == b->y && a->b_coef == b->b_coef &&
+		a->c_group == b->c_group && a->c_mask == b->c_mask &&
+		a->trait == b->trait && a->overrides == b->overrides;
+}
+
+static bool
+_hb_optimize_segment_same(const struct hb_segment *a, const struct hb_segment *b)
+{
+	return a->b_coef == b->b_coef && a->curve == b->curve &&
+		a->bias == b->bias && a->c_group == b->c_group &&
+		a->c_mask == b->c_mask && a->vis == b->vis && a->color == b->color &&
+		a->trait == b->trait && a->overrides == b->overrides;
+}
+
+/* maps every vertex to the first one it can be welded into */
+static void
+_hb_optimize_weld(const struct hb_stadium *s, size_t nv,
+		struct _hb_optimize_point *points, size_t *remap)
+{
+	size_t i, j, k, end;
+
+	for (i = 0; i < nv; ++i) {
+		points[i].x = s->vertexes[i]->x;
+		points[i].y = s->vertexes[i]->y;
+		points[i].index = i;
+		remap[i] = i;
+	}
+
+	qsort(points, nv, sizeof(points[0]), _hb_optimize_point_cmp);
+
+	for (i = 0; i < nv; i = end) {
+		for (end = i + 1; end < nv && points[end].x == points[i].x &&
+				points[end].y == points[i].y; ++end)
+			;
+		/* runs are sorted by index, the first match is the lowest */
+		for (k = i + 1; k < end; ++k) {
+			for (j = i; j < k; ++j) {
+				if (remap[points[j].index] != points[j].index)
+					continue;
+				if (_hb_optimize_vertex_same(s->vertexes[points[j].index],
+							s->vertexes[points[k].index])) {
+					remap[points[k].index] = points[j].index;
+					break;
+				}
+			}
+		}
+	}
+}
+
+static bool
+_hb_optimize_degenerate(const struct hb_stadium *s, const struct hb_segment *segm)
+{
+	const struct hb_vertex *a, *b;
+	a = s->vertexes[segm->v0];
+	b = s->vertexes[segm->v1];
+	/* neither a straight segment nor an arc collides with no length */
+	return segm->v0 == segm->v1 || (a->x == b->x && a->y == b->y);
+}
+
+static bool
+_hb_optimize_unreachable(const struct hb_segment *segm)
+{
+	return !segm->vis && (segm->c_mask == 0 || segm->c_group == 0);
+}
+
+/* whether b continues a -> v in the same direction */
+static bool
+_hb_optimize_runs_on(const struct hb_vertex *a, const struct hb_vertex *v,
+		const struct hb_vertex *b)
+{
+	double ux, uy, wx, wy;
+	ux = v->x - a->x;
+	uy = v->y - a->y;
+	wx = b->x - v->x;
+	wy = b->y - v->y;
+	return ux * wy - uy * wx == 0 && ux * wx + uy * wy > 0;
+}
+
+static size_t
+_hb_optimize_merge(struct hb_stadium *s, size_t nv, size_t ns, bool *dropped,
+		size_t *head, size_t *next)
+{
+	struct hb_segment *segm, *other;
+	size_t i, j, merged;
+	bool again;
+
+	for (i = 0; i < nv; ++i)
+		head[i] = _HB_OPTIMIZE_NONE;
+
+	for (i = ns; i-- > 0; ) {
+		if (dropped[i])
+			continue;
+		next[i] = head[s->segments[i]->v0];
+		head[s->segments[i]->v0] = i;
+	}
+
+	merged = 0;
+
+	for (i = 0; i < ns; ++i) {
+		segm = s->segments[i];
+		if (dropped[i] || segm->curve != 0)
+			continue;
+		do {
+			again = false;
+			for (j = head[segm->v1]; j != _HB_OPTIMIZE_NONE; j = next[j]) {
+				other = s->segments[j];
+				if (j == i || dropped[j] || !_hb_optimize_segment_same(segm, other) ||
+						!_hb_optimize_runs_on(s->vertexes[segm->v0],
+							s->vertexes[segm->v1], s->vertexes[other->v1]))
+					continue;
+				segm->v1 = other->v1;
+				dropped[j] = true;
+				++merged;
+				again = true;
+				break;
+			}
+		} while (again);
+	}
+
+	return merged;
+}
+
+/* frees the dropped elements and closes the gaps */
+static void
+_hb_optimize_compact(void **list, size_t count, const bool *dropped)
+{
+	size_t i, n;
+	for (i = n = 0; i < count; ++i) {
+		if (dropped[i])
+			free(list[i]);
+		else
+			list[n++] = list[i];
+	}
+	list[n] = NULL;
+}
+
+extern int
+hb_stadium_optimize(struct hb_stadium *s, unsigned opts,
+		struct hb_optimize_report *report)
+{
+	struct hb_optimize_report r;
+	struct _hb_optimize_point *points;
+	size_t nv, ns, i, *remap, *index, *next;
+	bool *vdropped, *sdropped, *referenced;
+
+	nv = _hb_optimize_count((void *const *)s->vertexes);
+	ns = _hb_optimize_count((void *const *)s->segments);
+	memset(&r, 0, sizeof(r));
+
+	points = malloc((nv + 1) * sizeof(*points));
+	remap = malloc((nv + 1) * sizeof(*remap));
+	index = malloc((nv + 1) * sizeof(*index));
+	next = malloc((ns + 1) * sizeof(*next));
+	vdropped = calloc(nv + 1, sizeof(*vdropped));
+	referenced = calloc(nv + 1, sizeof(*referenced));
+	sdropped = calloc(ns + 1, sizeof(*sdropped));
+
+	if (!points || !remap || !index || !next || !vdropped ||
+			!referenced || !sdropped ||
+			hb_stadium_unshare(s, HB_STADIUM_SECTION_VERTEXES |
+				HB_STADIUM_SECTION_SEGMENTS) < 0) {
+		free(points);
+		free(remap);
+		free(index);
+		free(next);
+		free(vdropped);
+		free(referenced);
+		free(sdropped);
+		return -1;
+	}
+
+	/////////////weld
+	if (opts & HB_OPTIMIZE_WELD_VERTEXES) {
+		_hb_optimize_weld(s, nv, points, remap);
+		for (i = 0; i < ns; ++i) {
+			s->segments[i]->v0 = remap[s->segments[i]->v0];
+			s->segments[i]->v1 = remap[s->segments[i]->v1];
+		}
+		for (i = 0; i < nv; ++i) {
+			if (remap[i] != i) {
+				vdropped[i] = true;
+				++r.vertexes_welded;
+			}
+		}
+	}
+
+	/////////////segments
+	for (i = 0; i < ns; ++i) {
+		if ((opts & HB_OPTIMIZE_DROP_DEGENERATE) &&
+				_hb_optimize_degenerate(s, s->segments[i])) {
+			sdropped[i] = true;
+			++r.segments_degenerate;
+		} else if ((opts & HB_OPTIMIZE_DROP_UNREACHABLE) &&
+				_hb_optimize_unreachable(s->segments[i])) {
+			sdropped[i] = true;
+			++r.segments_unreachable;
+		}
+	}
+
+	if (opts & HB_OPTIMIZE_MERGE_COLLINEAR)
+		r.segments_merged = _hb_optimize_merge(s, nv, ns, sdropped, index, next);
+
+	/////////////vertexes
+	for (i = 0; i < ns; ++i) {
+		if (sdropped[i])
+			continue;
+		referenced[s->segments[i]->v0] = true;
+		referenced[s->segments[i]->v1] = true;
+	}
+
+	if (opts & HB_OPTIMIZE_DROP_UNREACHABLE) {
+		for (i = 0; i < nv; ++i) {
+			if (vdropped[i] || referenced[i] ||
+					(s->vertexes[i]->c_mask != 0 && s->vertexes[i]->c_group != 0))
+				continue;
+			vdropped[i] = true;
+			++r.vertexes_unreachable;
+		}
+	}
+
+	/////////////remap
+	{
+		size_t n;
+		for (i = n = 0; i < nv; ++i)
+			index[i] = vdropped[i] ? _HB_OPTIMIZE_NONE : n++;
+		for (i = 0; i < ns; ++i) {
+			if (sdropped[i])
+				continue;
+			s->segments[i]->v0 = index[s->segments[i]->v0];
+			s->segments[i]->v1 = index[s->segments[i]->v1];
+		}
+	}
+
+	if (s->vertexes)
+		_hb_optimize_compact((void **)s->vertexes, nv, vdropped);
+	if (s->segments)
+		_hb_optimize_compact((void **)s->segments, ns, sdropped);
+
+	free(points);
+	free(remap);
+	free(index);
+	free(next);
+	free(vdropped);
+	free(referenced);
+	free(sdropped);
+
+	hb_stadium_invalidate(s);
+
+	if (report)
+		*report = r;
+
+	return 0;
+}
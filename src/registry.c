@@ -0,0 +1,295 @@
+#include <hb/registry.h>
+#include <hb/stadium.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define _HB_READER_OFFLINE UINT64_MAX
+
+struct hb_stadium_slot {
+	char                              *name;
+	_Atomic(struct hb_stadium *)    current;
+};
+
+struct hb_stadium_reader {
+	struct hb_stadium_registry         *reg;
+	atomic_ullong                     epoch;
+};
+
+struct _hb_retired {
+	struct hb_stadium                    *s;
+	uint64_t                          epoch;
+};
+
+struct hb_stadium_registry {
+	pthread_mutex_t                    lock;
+	atomic_ullong                     epoch;
+	struct hb_stadium_slot          **slots;
+	size_t                      slots_count;
+	size_t                   slots_capacity;
+	struct hb_stadium_reader      **readers;
+	size_t                    readers_count;
+	size_t                 readers_capacity;
+	struct _hb_retired             *retired;
+	size_t                    retired_count;
+	size_t                 retired_capacity;
+};
+
+static int
+_hb_registry_grow(void *list, size_t *capacity, size_t count, size_t size)
+{
+	void *grown;
+	size_t n;
+
+	if (count < *capacity)
+		return 0;
+
+	n = *capacity ? *capacity * 2 : 8;
+	if (NULL == (grown = realloc(*(void **)list, n * size)))
+		return -1;
+
+	*(void **)list = grown;
+	*capacity = n;
+	return 0;
+}
+
+/* must be called with the lock held */
+static struct hb_stadium_slot *
+_hb_registry_slot(struct hb_stadium_registry *reg, const char *name)
+{
+	struct hb_stadium_slot *slot;
+	size_t i;
+
+	for (i = 0; i < reg->slots_count; ++i)
+		if (!strcmp(reg->slots[i]->name, name))
+			return reg->slots[i];
+
+	if (_hb_registry_grow(&reg->slots, &reg->slots_capacity,
+				reg->slots_count, sizeof(*reg->slots)) < 0)
+		return NULL;
+
+	if (NULL == (slot = malloc(sizeof(*slot))))
+		return NULL;
+
+	if (NULL == (slot->name = strdup(name))) {
+		free(slot);
+		return NULL;
+	}
+
+	atomic_init(&slot->current, NULL);
+	reg->slots[reg->slots_count++] = slot;
+
+	return slot;
+}
+
+/* must be called with the lock held */
+static size_t
+_hb_registry_reclaim(struct hb_stadium_registry *reg)
+{
+	uint64_t oldest, epoch;
+	size_t i, kept;
+
+	oldest = _HB_READER_OFFLINE;
+
+	/* orders the swap before reading the epochs of readers coming online */
+	atomic_thread_fence(memory_order_seq_cst);
+
+	for (i = 0; i < reg->readers_count; ++i) {
+		epoch = atomic_load_explicit(&reg->readers[i]->epoch, memory_order_acquire);
+		if (epoch < oldest)
+			oldest = epoch;
+	}
+
+	for (kept = 0, i = 0; i < reg->retired_count; ++i) {
+		if (reg->retired[i].epoch <= oldest)
+			hb_stadium_free(reg->retired[i].s);
+		else
+			reg->retired[kept++] = reg->retired[i];
+	}
+
+	reg->retired_count = kept;
+
+	return kept;
+}
+
+extern struct hb_stadium_registry *
+hb_stadium_registry_create(void)
+{
+	struct hb_stadium_registry *reg;
+
+	if (NULL == (reg = calloc(1, sizeof(*reg))))
+		return NULL;
+
+	if (pthread_mutex_init(&reg->lock, NULL)) {
+		free(reg);
+		return NULL;
+	}
+
+	atomic_init(&reg->epoch, 1);
+
+	return reg;
+}
+
+extern void
+hb_stadium_registry_free(struct hb_stadium_registry *reg)
+{
+	struct hb_stadium *s;
+	size_t i;
+
+	for (i = 0; i < reg->slots_count; ++i) {
+		if ((s = atomic_load_explicit(&reg->slots[i]->current, memory_order_relaxed)))
+			hb_stadium_free(s);
+		free(reg->slots[i]->name);
+		free(reg->slots[i]);
+	}
+
+	for (i = 0; i < reg->retired_count; ++i)
+		hb_stadium_free(reg->retired[i].s);
+
+	pthread_mutex_destroy(&reg->lock);
+	free(reg->slots);
+	free(reg->readers);
+	free(reg->retired);
+	free(reg);
+}
+
+extern struct hb_stadium_slot *
+hb_stadium_registry_slot(struct hb_stadium_registry *reg, const char *name)
+{
+	struct hb_stadium_slot *slot;
+
+	pthread_mutex_lock(&reg->lock);
+	slot = _hb_registry_slot(reg, name);
+	pthread_mutex_unlock(&reg->lock);
+
+	return slot;
+}
+
+extern int
+hb_stadium_registry_publish(struct hb_stadium_registry *reg, const char *name,
+		struct hb_stadium *s)
+{
+	struct hb_stadium_slot *slot;
+	struct hb_stadium *old;
+
+	pthread_mutex_lock(&reg->lock);
+
+	if (NULL == (slot = _hb_registry_slot(reg, name)) ||
+			_hb_registry_grow(&reg->retired, &reg->retired_capacity,
+				reg->retired_count, sizeof(*reg->retired)) < 0) {
+		pthread_mutex_unlock(&reg->lock);
+		return -1;
+	}
+
+	old = atomic_exchange_explicit(&slot->current, s, memory_order_acq_rel);
+
+	if (old) {
+		/* readers that see the new epoch went quiescent after the swap */
+		reg->retired[reg->retired_count].s = old;
+		reg->retired[reg->retired_count].epoch = atomic_fetch_add_explicit(
+				&reg->epoch, 1, memory_order_acq_rel) + 1;
+		reg->retired_count++;
+	}
+
+	_hb_registry_reclaim(reg);
+	pthread_mutex_unlock(&reg->lock);
+
+	return 0;
+}
+
+extern size_t
+hb_stadium_registry_reclaim(struct hb_stadium_registry *reg)
+{
+	size_t pending;
+
+	pthread_mutex_lock(&reg->lock);
+	pending = _hb_registry_reclaim(reg);
+	pthread_mutex_unlock(&reg->lock);
+
+	return pending;
+}
+
+extern const struct hb_stadium *
+hb_stadium_slot_get(const struct hb_stadium_slot *slot)
+{
+	return atomic_load_explicit(&((struct hb_stadium_slot *)slot)->current,
+			memory_order_acquire);
+}
+
+extern struct hb_stadium_reader *
+hb_stadium_reader_register(struct hb_stadium_registry *reg)
+{
+	struct hb_stadium_reader *reader;
+
+	if (NULL == (reader = malloc(sizeof(*reader))))
+		return NULL;
+
+	reader->reg = reg;
+
+	pthread_mutex_lock(&reg->lock);
+
+	if (_hb_registry_grow(&reg->readers, &reg->readers_capacity,
+				reg->readers_count, sizeof(*reg->readers)) < 0) {
+		pthread_mutex_unlock(&reg->lock);
+		free(reader);
+		return NULL;
+	}
+
+	atomic_init(&reader->epoch, atomic_load_explicit(&reg->epoch,
+				memory_order_acquire));
+	reg->readers[reg->readers_count++] = reader;
+
+	pthread_mutex_unlock(&reg->lock);
+
+	return reader;
+}
+
+extern void
+hb_stadium_reader_unregister(struct hb_stadium_reader *reader)
+{
+	struct hb_stadium_registry *reg;
+	size_t i;
+
+	reg = reader->reg;
+
+	pthread_mutex_lock(&reg->lock);
+
+	for (i = 0; i < reg->readers_count; ++i) {
+		if (reg->readers[i] == reader) {
+			reg->readers[i] = reg->readers[--reg->readers_count];
+			break;
+		}
+	}
+
+	_hb_registry_reclaim(reg);
+	pthread_mutex_unlock(&reg->lock);
+
+	free(reader);
+}
+
+extern void
+hb_stadium_reader_quiescent(struct hb_stadium_reader *reader)
+{
+	atomic_store_explicit(&reader->epoch, atomic_load_explicit(
+				&reader->reg->epoch, memory_order_acquire),
+			memory_order_release);
+}
+
+extern void
+hb_stadium_reader_offline(struct hb_stadium_reader *reader)
+{
+	atomic_store_explicit(&reader->epoch, _HB_READER_OFFLINE,
+			memory_order_release);
+}
+
+extern void
+hb_stadium_reader_online(struct hb_stadium_reader *reader)
+{
+	atomic_store_explicit(&reader->epoch, atomic_load_explicit(
+				&reader->reg->epoch, memory_order_acquire),
+			memory_order_seq_cst);
+	atomic_thread_fence(memory_order_seq_cst);
+}
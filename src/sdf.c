@@ -0,0 +1,245 @@
+#include <hb/sdf.h>
+#include <hb/collision_flags.h>
+#include <hb/geometry.h>
+#include <hb/stadium.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+/* a resolution small next to the stadium is made larger to stay in this */
+#define _HB_SDF_MAX_SAMPLES (1 << 22)
+
+/* the threads building a field, the calling one among them */
+#define _HB_SDF_THREADS 4
+
+struct _hb_sdf_job {
+	struct hb_sdf                      *sdf;
+	const struct hb_geometry             *g;
+	enum hb_collision_flags            mask;
+	atomic_size_t                  next_row;
+};
+
+static double
+_hb_sdf_point(double x, double y, double px, double py)
+{
+	return sqrt((x - px) * (x - px) + (y - py) * (y - py));
+}
+
+/* f is how far in front of the wall along its normal, the bias side
+   being in front when there is one */
+static double
+_hb_sdf_biased(double f, double bias)
+{
+	if (bias < 0) {
+		f = -f;
+		bias = -bias;
+	}
+	return bias == 0 || f < -bias ? fabs(f) : f;
+}
+
+static double
+_hb_sdf_segment(const struct hb_geometry *g, size_t k, double x, double y)
+{
+	double ex, ey, t, dx, dy, len, f;
+
+	/* a biased wall has a side discs are kept on, as in hb_ccd, and the
+	   distance goes negative behind it for as thick as the bias makes
+	   it, further behind the wall is ignored by collisions. an arc keeps
+	   them inside for a positive bias and outside for a negative one */
+	if (g->arc[k]) {
+		dx = x - g->center_x[k];
+		dy = y - g->center_y[k];
+		len = sqrt(dx * dx + dy * dy);
+		if (len > 0 && hb_geometry_arc_contains(g, k, dx, dy))
+			return _hb_sdf_biased(g->radius[k] - len, g->bias[k]);
+	} else {
+		ex = g->v1_x[k] - g->v0_x[k];
+		ey = g->v1_y[k] - g->v0_y[k];
+		t = (x - g->v0_x[k]) * ex + (y - g->v0_y[k]) * ey;
+		if (t > 0 && t < ex * ex + ey * ey) {
+			f = g->normal_x[k] * (x - g->v0_x[k]) + g->normal_y[k] * (y - g->v0_y[k]);
+			return _hb_sdf_biased(f, g->bias[k]);
+		}
+	}
+
+	/* past either end it is the nearer end, on either side */
+	return fmin(_hb_sdf_point(x, y, g->v0_x[k], g->v0_y[k]),
+			_hb_sdf_point(x, y, g->v1_x[k], g->v1_y[k]));
+}
+
+static double
+_hb_sdf_distance(const struct hb_geometry *g, enum hb_collision_flags mask,
+		double x, double y)
+{
+	double d;
+	size_t k;
+
+	d = INFINITY;
+
+	for (k = 0; k < g->planes_count; ++k)
+		if (g->plane_c_mask[k] & mask)
+			d = fmin(d, g->plane_normal_x[k] * x + g->plane_normal_y[k] * y -
+					g->plane_dist[k]);
+
+	for (k = 0; k < g->segments_count; ++k)
+		if (g->c_mask[k] & mask)
+			d = fmin(d, _hb_sdf_segment(g, k, x, y));
+
+	for (k = 0; k < g->vertexes_count; ++k)
+		if (g->vertex_c_mask[k] & mask)
+			d = fmin(d, _hb_sdf_point(x, y, g->vertex_x[k], g->vertex_y[k]));
+
+	return d;
+}
+
+/* rows are taken one at a time until none is left */
+static void *
+_hb_sdf_work(void *arg)
+{
+	struct _hb_sdf_job *job;
+	struct hb_sdf *sdf;
+	size_t row, column;
+	double *out;
+
+	job = arg;
+	sdf = job->sdf;
+
+	while ((row = atomic_fetch_add(&job->next_row, 1)) < sdf->rows) {
+		out = sdf->distance + row * sdf->columns;
+		for (column = 0; column < sdf->columns; ++column)
+			out[column] = _hb_sdf_distance(job->g, job->mask,
+					sdf->min_x + column * sdf->resolution,
+					sdf->min_y + row * sdf->resolution);
+	}
+
+	return NULL;
+}
+
+static void
+_hb_sdf_bounds(const struct hb_stadium *s, const struct hb_geometry *g,
+		double *min_x, double *min_y, double *max_x, double *max_y)
+{
+	size_t k;
+
+	*min_x = -fabs(s->width);
+	*min_y = -fabs(s->height);
+	*max_x = fabs(s->width);
+	*max_y = fabs(s->height);
+
+	for (k = 0; k < g->segments_count; ++k) {
+		*min_x = fmin(*min_x, g->min_x[k]);
+		*min_y = fmin(*min_y, g->min_y[k]);
+		*max_x = fmax(*max_x, g->max_x[k]);
+		*max_y = fmax(*max_y, g->max_y[k]);
+	}
+
+	for (k = 0; k < g->vertexes_count; ++k) {
+		*min_x = fmin(*min_x, g->vertex_x[k]);
+		*min_y = fmin(*min_y, g->vertex_y[k]);
+		*max_x = fmax(*max_x, g->vertex_x[k]);
+		*max_y = fmax(*max_y, g->vertex_y[k]);
+	}
+}
+
+extern struct hb_sdf *
+hb_stadium_build_sdf(const struct hb_stadium *s, double resolution,
+		enum hb_collision_flags mask)
+{
+	struct hb_sdf *sdf;
+	struct hb_geometry *g;
+	struct _hb_sdf_job job;
+	pthread_t threads[_HB_SDF_THREADS - 1];
+	size_t started, t;
+	double min_x, min_y, max_x, max_y;
+
+	if (!(resolution > 0) || NULL == (g = hb_stadium_compile(s)))
+		return NULL;
+
+	_hb_sdf_bounds(s, g, &min_x, &min_y, &max_x, &max_y);
+
+	/* one sample past the bounds on every side */
+	while ((max_x - min_x) / resolution + 3 > _HB_SDF_MAX_SAMPLES /
+			((max_y - min_y) / resolution + 3))
+		resolution *= 2;
+
+	if (NULL == (sdf = calloc(1, sizeof(struct hb_sdf)))) {
+		hb_geometry_free(g);
+		return NULL;
+	}
+
+	sdf->resolution = resolution;
+	sdf->min_x = min_x - resolution;
+	sdf->min_y = min_y - resolution;
+	sdf->columns = (size_t)ceil((max_x - min_x) / resolution) + 3;
+	sdf->rows = (size_t)ceil((max_y - min_y) / resolution) + 3;
+
+	if (NULL == (sdf->distance = malloc(sdf->columns * sdf->rows * sizeof(double)))) {
+		hb_geometry_free(g);
+		hb_sdf_free(sdf);
+		return NULL;
+	}
+
+	job.sdf = sdf;
+	job.g = g;
+	job.mask = mask;
+	atomic_init(&job.next_row, 0);
+
+	/* a thread that does not start leaves its rows to the others */
+	for (started = 0; started < _HB_SDF_THREADS - 1 && started + 1 < sdf->rows; ++started)
+		if (pthread_create(&threads[started], NULL, _hb_sdf_work, &job))
+			break;
+
+	_hb_sdf_work(&job);
+
+	for (t = 0; t < started; ++t)
+		pthread_join(threads[t], NULL);
+
+	hb_geometry_free(g);
+
+	return sdf;
+}
+
+extern void
+hb_sdf_free(struct hb_sdf *sdf)
+{
+	if (!sdf)
+		return;
+	free(sdf->distance);
+	free(sdf);
+}
+
+extern double
+hb_sdf_sample(const struct hb_sdf *sdf, double x, double y)
+{
+	const double *d;
+	double fx, fy, top, bottom;
+	size_t column, row;
+
+	fx = (x - sdf->min_x) / sdf->resolution;
+	fy = (y - sdf->min_y) / sdf->resolution;
+
+	if (!(fx > 0)) fx = 0;
+	if (fx > sdf->columns - 1) fx = sdf->columns - 1;
+	if (!(fy > 0)) fy = 0;
+	if (fy > sdf->rows - 1) fy = sdf->rows - 1;
+
+	/* the last column and row are reached from the ones before them */
+	column = fx < sdf->columns - 1 ? (size_t)fx : sdf->columns - 2;
+	row = fy < sdf->rows - 1 ? (size_t)fy : sdf->rows - 2;
+	fx -= column;
+	fy -= row;
+
+	d = sdf->distance + row * sdf->columns + column;
+
+	/* no wall at all */
+	if (isinf(d[0]))
+		return d[0];
+
+	top = d[0] + (d[1] - d[0]) * fx;
+	bottom = d[sdf->columns] + (d[sdf->columns + 1] - d[sdf->columns]) * fx;
+
+	return top + (bottom - top) * fy;
+}
@@ -0,0 +1,220 @@
+#include <hb/shared.h>
+#include <hb/stadium.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define _HB_SHARED_ALIGN(n) (((n) + 15) & ~(uint64_t)15)
+
+static uint64_t
+_hb_shared_count(void *const *list)
+{
+	uint64_t count;
+	count = 0;
+	if (list)
+		while (list[count])
+			++count;
+	return count;
+}
+
+static uint64_t
+_hb_shared_layout(struct hb_shared_section *section, uint64_t offset,
+		void *const *list, uint64_t size)
+{
+	section->offset = offset;
+	section->count = _hb_shared_count(list);
+	section->size = size;
+	return _HB_SHARED_ALIGN(offset + section->count * size);
+}
+
+static void
+_hb_shared_fill(unsigned char *image, const struct hb_shared_section *section,
+		void *const *list)
+{
+	uint64_t i;
+	for (i = 0; i < section->count; ++i)
+		memcpy(image + section->offset + i * section->size,
+				list[i], section->size);
+}
+
+#define _HB_SHARED_DROP_TRAITS(section,type) \
+	do { \
+		uint64_t i; \
+		for (i = 0; i < ss->section.count; ++i) \
+			((type *)(image + ss->section.offset))[i].trait = NULL; \
+	} while (0)
+
+static bool
+_hb_shared_check(const struct hb_shared_section *section, uint64_t size,
+		uint64_t align, uint64_t image_size)
+{
+	if (section->size != size || section->offset > image_size ||
+			section->offset % align != 0)
+		return false;
+	if (section->count > (image_size - section->offset) / size)
+		return false;
+	return true;
+}
+
+#define _HB_SHARED_CHECK(ss,section,type) \
+	_hb_shared_check(&(ss)->section, sizeof(type), _Alignof(type), (ss)->size)
+
+/* the readers index the vertexes and discs with these unchecked */
+static bool
+_hb_shared_check_refs(const struct hb_shared_stadium *ss)
+{
+	hb_shared_stadium_segments_foreach(ss, seg)
+		if (seg->v0 < 0 || (uint64_t)seg->v0 >= ss->vertexes.count ||
+				seg->v1 < 0 || (uint64_t)seg->v1 >= ss->vertexes.count)
+			return false;
+	hb_shared_stadium_joints_foreach(ss, joint)
+		if (joint->d0 < 0 || (uint64_t)joint->d0 >= ss->discs.count ||
+				joint->d1 < 0 || (uint64_t)joint->d1 >= ss->discs.count)
+			return false;
+	return true;
+}
+
+extern int
+hb_stadium_export_shared(const struct hb_stadium *s, int fd)
+{
+	struct hb_shared_stadium *ss;
+	unsigned char *image;
+	uint64_t size, name_len;
+	ssize_t written;
+	size_t done;
+
+	/////////////layout
+	{
+		struct hb_shared_stadium layout;
+		name_len = strlen(s->name) + 1;
+		size = _HB_SHARED_ALIGN(sizeof(struct hb_shared_stadium));
+		layout.name_offset = size;
+		size = _HB_SHARED_ALIGN(size + name_len);
+		size = _hb_shared_layout(&layout.vertexes, size,
+				(void *const *)s->vertexes, sizeof(struct hb_vertex));
+		size = _hb_shared_layout(&layout.segments, size,
+				(void *const *)s->segments, sizeof(struct hb_segment));
+		size = _hb_shared_layout(&layout.goals, size,
+				(void *const *)s->goals, sizeof(struct hb_goal));
+		size = _hb_shared_layout(&layout.discs, size,
+				(void *const *)s->discs, sizeof(struct hb_disc));
+		size = _hb_shared_layout(&layout.planes, size,
+				(void *const *)s->planes, sizeof(struct hb_plane));
+		size = _hb_shared_layout(&layout.joints, size,
+				(void *const *)s->joints, sizeof(struct hb_joint));
+		size = _hb_shared_layout(&layout.red_spawn_points, size,
+				(void *const *)s->red_spawn_points, sizeof(struct hb_point));
+		size = _hb_shared_layout(&layout.blue_spawn_points, size,
+				(void *const *)s->blue_spawn_points, sizeof(struct hb_point));
+
+		if (NULL == (image = calloc(1, size)))
+			return -1;
+
+		ss = (struct hb_shared_stadium *)image;
+		*ss = layout;
+	}
+
+	/////////////header
+	ss->magic = HB_SHARED_STADIUM_MAGIC;
+	ss->version = HB_SHARED_STADIUM_VERSION;
+	ss->size = size;
+	ss->width = s->width;
+	ss->height = s->height;
+	ss->camera_width = s->camera_width;
+	ss->camera_height = s->camera_height;
+	ss->max_view_width = s->max_view_width;
+	ss->camera_follow = s->camera_follow;
+	ss->spawn_distance = s->spawn_distance;
+	ss->can_be_stored = s->can_be_stored;
+	ss->kick_off_reset = s->kick_off_reset;
+	if (s->bg) ss->bg = *s->bg;
+	if (s->ball_physics) ss->ball_physics = *s->ball_physics;
+	if (s->player_physics) ss->player_physics = *s->player_physics;
+	memcpy(image + ss->name_offset, s->name, name_len);
+
+	/////////////sections
+	_hb_shared_fill(image, &ss->vertexes, (void *const *)s->vertexes);
+	_hb_shared_fill(image, &ss->segments, (void *const *)s->segments);
+	_hb_shared_fill(image, &ss->goals, (void *const *)s->goals);
+	_hb_shared_fill(image, &ss->discs, (void *const *)s->discs);
+	_hb_shared_fill(image, &ss->planes, (void *const *)s->planes);
+
+	/* trait pointers mean nothing in another process */
+	ss->ball_physics.trait = NULL;
+	_HB_SHARED_DROP_TRAITS(vertexes, struct hb_vertex);
+	_HB_SHARED_DROP_TRAITS(segments, struct hb_segment);
+	_HB_SHARED_DROP_TRAITS(discs, struct hb_disc);
+	_HB_SHARED_DROP_TRAITS(planes, struct hb_plane);
+	_hb_shared_fill(image, &ss->joints, (void *const *)s->joints);
+	_hb_shared_fill(image, &ss->red_spawn_points, (void *const *)s->red_spawn_points);
+	_hb_shared_fill(image, &ss->blue_spawn_points, (void *const *)s->blue_spawn_points);
+
+	/////////////write
+	if (ftruncate(fd, size) < 0)
+		goto err;
+
+	for (done = 0; done < size; done += written)
+		if ((written = pwrite(fd, image + done, size - done, done)) <= 0)
+			goto err;
+
+	free(image);
+	return 0;
+
+err:
+	free(image);
+	return -1;
+}
+
+extern const struct hb_shared_stadium *
+hb_stadium_map_shared(int fd)
+{
+	const struct hb_shared_stadium *ss;
+	struct hb_shared_stadium header;
+	struct stat st;
+	void *addr;
+
+	/* only the image is mapped, hb_stadium_unmap_shared unmaps the
+	   length it records and a longer file keeps the rest to itself */
+	if (fstat(fd, &st) < 0 ||
+			st.st_size < (off_t)sizeof(struct hb_shared_stadium) ||
+			pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+			header.size < sizeof(struct hb_shared_stadium) ||
+			header.size > (uint64_t)st.st_size)
+		return NULL;
+
+	addr = mmap(NULL, header.size, PROT_READ, MAP_SHARED, fd, 0);
+	if (addr == MAP_FAILED)
+		return NULL;
+
+	ss = addr;
+
+	if (ss->magic != HB_SHARED_STADIUM_MAGIC ||
+			ss->version != HB_SHARED_STADIUM_VERSION ||
+			ss->size != header.size ||
+			ss->name_offset >= ss->size ||
+			!memchr(hb_shared_stadium_name(ss), '\0', ss->size - ss->name_offset) ||
+			!_HB_SHARED_CHECK(ss, vertexes, struct hb_vertex) ||
+			!_HB_SHARED_CHECK(ss, segments, struct hb_segment) ||
+			!_HB_SHARED_CHECK(ss, goals, struct hb_goal) ||
+			!_HB_SHARED_CHECK(ss, discs, struct hb_disc) ||
+			!_HB_SHARED_CHECK(ss, planes, struct hb_plane) ||
+			!_HB_SHARED_CHECK(ss, joints, struct hb_joint) ||
+			!_HB_SHARED_CHECK(ss, red_spawn_points, struct hb_point) ||
+			!_HB_SHARED_CHECK(ss, blue_spawn_points, struct hb_point) ||
+			!_hb_shared_check_refs(ss)) {
+		munmap(addr, header.size);
+		return NULL;
+	}
+
+	return ss;
+}
+
+extern void
+hb_stadium_unmap_shared(const struct hb_shared_stadium *ss)
+{
+	munmap((void *)ss, ss->size);
+}
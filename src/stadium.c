@@ -1,8 +1,12 @@
 #include <math.h>
 #include <hb/stadium.h>
+#include <hb/tessellation.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <float.h>
 #include <jv.h>
 
 #define _HB_CURVEF_TO_CURVE(curvef) \
@@ -594,6 +598,7 @@ _hb_jv_parse_vertex(jv from, struct hb_vertex **to,
 		trait = jv_object_get(jv_copy(from), jv_string("trait"));
 		if (_hb_jv_parse_trait_name_and_find_and_free(trait, &vert_trait, traits) < 0)
 			return -1;
+		vert->trait = vert_trait;
 	}
 
 	/////////////bCoef
@@ -604,6 +609,8 @@ _hb_jv_parse_vertex(jv from, struct hb_vertex **to,
 		if (NULL != vert_trait && vert_trait->has_b_coef)
 			fallback_b_coef = vert_trait->b_coef;
 		b_coef = jv_object_get(jv_copy(from), jv_string("bCoef"));
+		if (jv_get_kind(b_coef) != JV_KIND_INVALID)
+			vert->overrides |= HB_TRAIT_FIELD_B_COEF;
 		if (_hb_jv_parse_number_and_free(b_coef, &vert->b_coef, &fallback_b_coef) < 0)
 			return -1;
 	}
@@ -616,6 +623,8 @@ _hb_jv_parse_vertex(jv from, struct hb_vertex **to,
 		if (NULL != vert_trait && vert_trait->has_c_group)
 			fallback_c_group = vert_trait->c_group;
 		c_group = jv_object_get(jv_copy(from), jv_string("cGroup"));
+		if (jv_get_kind(c_group) != JV_KIND_INVALID)
+			vert->overrides |= HB_TRAIT_FIELD_C_GROUP;
 		if (_hb_jv_parse_collision_flags_and_free(c_group, &vert->c_group, &fallback_c_group) < 0)
 			return -1;
 	}
@@ -628,6 +637,8 @@ _hb_jv_parse_vertex(jv from, struct hb_vertex **to,
 		if (NULL != vert_trait && vert_trait->has_c_mask)
 			fallback_c_mask = vert_trait->c_mask;
 		c_mask = jv_object_get(jv_copy(from), jv_string("cMask"));
+		if (jv_get_kind(c_mask) != JV_KIND_INVALID)
+			vert->overrides |= HB_TRAIT_FIELD_C_MASK;
 		if (_hb_jv_parse_collision_flags_and_free(c_mask, &vert->c_mask, &fallback_c_mask) < 0)
 			return -1;
 	}
@@ -706,6 +717,7 @@ _hb_jv_parse_segment(jv from, struct hb_segment **to,
 		trait = jv_object_get(jv_copy(from), jv_string("trait"));
 		if (_hb_jv_parse_trait_name_and_find_and_free(trait, &segm_trait, traits) < 0)
 			return -1;
+		segm->trait = segm_trait;
 	}
 
 	/////////////bCoef
@@ -716,6 +728,8 @@ _hb_jv_parse_segment(jv from, struct hb_segment **to,
 		if (NULL != segm_trait && segm_trait->has_b_coef)
 			fallback_b_coef = segm_trait->b_coef;
 		b_coef = jv_object_get(jv_copy(from), jv_string("bCoef"));
+		if (jv_get_kind(b_coef) != JV_KIND_INVALID)
+			segm->overrides |= HB_TRAIT_FIELD_B_COEF;
 		if (_hb_jv_parse_number_and_free(b_coef, &segm->b_coef, &fallback_b_coef) < 0)
 			return -1;
 	}
@@ -759,6 +773,8 @@ _hb_jv_parse_segment(jv from, struct hb_segment **to,
 		if (NULL != segm_trait && segm_trait->has_c_group)
 			fallback_c_group = segm_trait->c_group;
 		c_group = jv_object_get(jv_copy(from), jv_string("cGroup"));
+		if (jv_get_kind(c_group) != JV_KIND_INVALID)
+			segm->overrides |= HB_TRAIT_FIELD_C_GROUP;
 		if (_hb_jv_parse_collision_flags_and_free(c_group, &segm->c_group, &fallback_c_group) < 0)
 			return -1;
 	}
@@ -771,6 +787,8 @@ _hb_jv_parse_segment(jv from, struct hb_segment **to,
 		if (NULL != segm_trait && segm_trait->has_c_mask)
 			fallback_c_mask = segm_trait->c_mask;
 		c_mask = jv_object_get(jv_copy(from), jv_string("cMask"));
+		if (jv_get_kind(c_mask) != JV_KIND_INVALID)
+			segm->overrides |= HB_TRAIT_FIELD_C_MASK;
 		if (_hb_jv_parse_collision_flags_and_free(c_mask, &segm->c_mask, &fallback_c_mask) < 0)
 			return -1;
 	}
@@ -783,6 +801,8 @@ _hb_jv_parse_segment(jv from, struct hb_segment **to,
 		if (NULL != segm_trait && segm_trait->has_vis)
 			fallback_vis = segm_trait->vis;
 		vis = jv_object_get(jv_copy(from), jv_string("vis"));
+		if (jv_get_kind(vis) != JV_KIND_INVALID)
+			segm->overrides |= HB_TRAIT_FIELD_VIS;
 		if (_hb_jv_parse_boolean_and_free(vis, &segm->vis, &fallback_vis) < 0)
 			return -1;
 	}
@@ -795,6 +815,8 @@ _hb_jv_parse_segment(jv from, struct hb_segment **to,
 		if (NULL != segm_trait && segm_trait->has_color)
 			fallback_color = segm_trait->color;
 		color = jv_object_get(jv_copy(from), jv_string("color"));
+		if (jv_get_kind(color) != JV_KIND_INVALID)
+			segm->overrides |= HB_TRAIT_FIELD_COLOR;
 		if (_hb_jv_parse_color_and_free(color, &segm->color, &fallback_color) < 0)
 			return -1;
 	}
@@ -1116,6 +1138,7 @@ _hb_jv_parse_disc(jv from, struct hb_disc **to,
 		trait = jv_object_get(jv_copy(from), jv_string("trait"));
 		if (_hb_jv_parse_trait_name_and_find_and_free(trait, &disc_trait, traits) < 0)
 			return -1;
+		disc->trait = disc_trait;
 	}
 
 	/////////////radius
@@ -1124,6 +1147,8 @@ _hb_jv_parse_disc(jv from, struct hb_disc **to,
 		double fallback_radius;
 		fallback_radius = 10.0f;
 		radius = jv_object_get(jv_copy(from), jv_string("radius"));
+		if (jv_get_kind(radius) != JV_KIND_INVALID)
+			disc->overrides |= HB_TRAIT_FIELD_RADIUS;
 		if (disc_trait != NULL && disc_trait->has_radius)
 			fallback_radius = disc_trait->radius;
 		if (_hb_jv_parse_number_and_free(radius, &disc->radius, &fallback_radius) < 0)
@@ -1136,6 +1161,8 @@ _hb_jv_parse_disc(jv from, struct hb_disc **to,
 		double fallback_inv_mass;
 		fallback_inv_mass = 1.0f;
 		inv_mass = jv_object_get(jv_copy(from), jv_string("invMass"));
+		if (jv_get_kind(inv_mass) != JV_KIND_INVALID)
+			disc->overrides |= HB_TRAIT_FIELD_INV_MASS;
 		if (disc_trait != NULL && disc_trait->has_inv_mass)
 			fallback_inv_mass = disc_trait->inv_mass;
 		if (_hb_jv_parse_number_and_free(inv_mass, &disc->inv_mass, &fallback_inv_mass) < 0)
@@ -1160,6 +1187,8 @@ _hb_jv_parse_disc(jv from, struct hb_disc **to,
 		if (NULL != disc_trait && disc_trait->has_color)
 			fallback_color = disc_trait->color;
 		color = jv_object_get(jv_copy(from), jv_string("color"));
+		if (jv_get_kind(color) != JV_KIND_INVALID)
+			disc->overrides |= HB_TRAIT_FIELD_COLOR;
 		if (_hb_jv_parse_color_and_free(color, &disc->color, &fallback_color) < 0)
 			return -1;
 	}
@@ -1172,6 +1201,8 @@ _hb_jv_parse_disc(jv from, struct hb_disc **to,
 		if (NULL != disc_trait && disc_trait->has_b_coef)
 			fallback_b_coef = disc_trait->b_coef;
 		b_coef = jv_object_get(jv_copy(from), jv_string("bCoef"));
+		if (jv_get_kind(b_coef) != JV_KIND_INVALID)
+			disc->overrides |= HB_TRAIT_FIELD_B_COEF;
 		if (_hb_jv_parse_number_and_free(b_coef, &disc->b_coef, &fallback_b_coef) < 0)
 			return -1;
 	}
@@ -1184,6 +1215,8 @@ _hb_jv_parse_disc(jv from, struct hb_disc **to,
 		if (NULL != disc_trait && disc_trait->has_c_mask)
 			fallback_c_mask = disc_trait->c_mask;
 		c_mask = jv_object_get(jv_copy(from), jv_string("cMask"));
+		if (jv_get_kind(c_mask) != JV_KIND_INVALID)
+			disc->overrides |= HB_TRAIT_FIELD_C_MASK;
 		if (_hb_jv_parse_collision_flags_and_free(c_mask, &disc->c_mask, &fallback_c_mask) < 0)
 			return -1;
 	}
@@ -1196,6 +1229,8 @@ _hb_jv_parse_disc(jv from, struct hb_disc **to,
 		if (NULL != disc_trait && disc_trait->has_c_group)
 			fallback_c_group = disc_trait->c_group;
 		c_group = jv_object_get(jv_copy(from), jv_string("cGroup"));
+		if (jv_get_kind(c_group) != JV_KIND_INVALID)
+			disc->overrides |= HB_TRAIT_FIELD_C_GROUP;
 		if (_hb_jv_parse_collision_flags_and_free(c_group, &disc->c_group, &fallback_c_group) < 0)
 			return -1;
 	}
@@ -1270,6 +1305,7 @@ _hb_jv_parse_plane(jv from, struct hb_plane **to, struct hb_trait **traits)
 		trait = jv_object_get(jv_copy(from), jv_string("trait"));
 		if (_hb_jv_parse_trait_name_and_find_and_free(trait, &plane_trait, traits) < 0)
 			return -1;
+		plane->trait = plane_trait;
 	}
 
 	/////////////bCoef
@@ -1280,6 +1316,8 @@ _hb_jv_parse_plane(jv from, struct hb_plane **to, struct hb_trait **traits)
 		if (NULL != plane_trait && plane_trait->has_b_coef)
 			fallback_b_coef = plane_trait->b_coef;
 		b_coef = jv_object_get(jv_copy(from), jv_string("bCoef"));
+		if (jv_get_kind(b_coef) != JV_KIND_INVALID)
+			plane->overrides |= HB_TRAIT_FIELD_B_COEF;
 		if (_hb_jv_parse_number_and_free(b_coef, &plane->b_coef, &fallback_b_coef) < 0)
 			return -1;
 	}
@@ -1292,6 +1330,8 @@ _hb_jv_parse_plane(jv from, struct hb_plane **to, struct hb_trait **traits)
 		if (NULL != plane_trait && plane_trait->has_c_mask)
 			fallback_c_mask = plane_trait->c_mask;
 		c_mask = jv_object_get(jv_copy(from), jv_string("cMask"));
+		if (jv_get_kind(c_mask) != JV_KIND_INVALID)
+			plane->overrides |= HB_TRAIT_FIELD_C_MASK;
 		if (_hb_jv_parse_collision_flags_and_free(c_mask, &plane->c_mask, &fallback_c_mask) < 0)
 			return -1;
 	}
@@ -1304,6 +1344,8 @@ _hb_jv_parse_plane(jv from, struct hb_plane **to, struct hb_trait **traits)
 		if (NULL != plane_trait && plane_trait->has_c_group)
 			fallback_c_group = plane_trait->c_group;
 		c_group = jv_object_get(jv_copy(from), jv_string("cGroup"));
+		if (jv_get_kind(c_group) != JV_KIND_INVALID)
+			plane->overrides |= HB_TRAIT_FIELD_C_GROUP;
 		if (_hb_jv_parse_collision_flags_and_free(c_group, &plane->c_group, &fallback_c_group) < 0)
 			return -1;
 	}
@@ -1838,6 +1880,86 @@ _hb_jv_parse_player_physics_and_free(jv from, struct hb_player_physics **to)
 { return _hb_jv_parse_xxx_and_free_wrapper_1(
 			_hb_jv_parse_player_physics(from, to), from); }
 
+/* fallbacks applied by _hb_jv_parse_* when a field is missing, compact
+   output omits every field that matches them */
+static const struct hb_background _hb_fallback_bg = {
+	.type = HB_BACKGROUND_TYPE_NONE,
+	.color = 0xff718c5a
+};
+
+static const struct hb_vertex _hb_fallback_vertex = {
+	.b_coef = 1.0f,
+	.c_group = HB_COLLISION_WALL,
+	.c_mask = HB_COLLISION_ALL
+};
+
+static const struct hb_segment _hb_fallback_segment = {
+	.b_coef = 1.0f,
+	.c_group = HB_COLLISION_WALL,
+	.c_mask = HB_COLLISION_ALL,
+	.vis = true,
+	.color = 0xff000000
+};
+
+static const struct hb_disc _hb_fallback_ball_physics = {
+	.radius = 10.0f,
+	.inv_mass = 1.0f,
+	.damping = 0.99f,
+	.color = 0xffffffff,
+	.b_coef = 0.5f,
+	.c_mask = HB_COLLISION_ALL,
+	.c_group = HB_COLLISION_KICK | HB_COLLISION_SCORE | HB_COLLISION_BALL
+};
+
+static const struct hb_disc _hb_fallback_disc = {
+	.radius = 10.0f,
+	.inv_mass = 1.0f,
+	.damping = 0.99,
+	.color = 0xffffffff,
+	.b_coef = 0.5f,
+	.c_mask = HB_COLLISION_ALL,
+	.c_group = HB_COLLISION_ALL
+};
+
+static const struct hb_plane _hb_fallback_plane = {
+	.b_coef = 1.0f,
+	.c_mask = HB_COLLISION_ALL,
+	.c_group = HB_COLLISION_WALL
+};
+
+static const struct hb_joint _hb_fallback_joint = {
+	.length = { .kind = HB_JOINT_LENGTH_AUTO },
+	.strength = { .is_rigid = true },
+	.color = 0xff000000
+};
+
+static const struct hb_player_physics _hb_fallback_player_physics = {
+	.radius = 15.0f,
+	.inv_mass = 0.5f,
+	.b_coef = 0.5f,
+	.damping = 0.96f,
+	.c_group = 0,
+	.acceleration = 0.1f,
+	.kicking_acceleration = 0.07f,
+	.kicking_damping = 0.96f,
+	.kick_strength = 5.0f,
+	.kickback = 0.0f
+};
+
+static inline bool
+_hb_number_is(double from, double fallback)
+{
+	/* bitwise, so -0 and 0 are kept apart */
+	return !memcmp(&from, &fallback, sizeof(double));
+}
+
+static inline bool
+_hb_vec2_is(const double from[2], const double fallback[2])
+{
+	return _hb_number_is(from[0], fallback[0]) &&
+		_hb_number_is(from[1], fallback[1]);
+}
+
 static jv
 _hb_jv_to_json_camera_follow(enum hb_camera_follow from)
 {
@@ -1878,24 +2000,32 @@ _hb_jv_to_json_color(uint32_t from)
 }
 
 static jv
-_hb_jv_to_json_bg(struct hb_background *from)
+_hb_jv_to_json_bg(const struct hb_background *from,
+		const struct hb_background *fallback)
 {
 	jv out;
 	out = jv_object();
-	out = jv_object_set(out, jv_string("type"),
-			_hb_jv_to_json_bg_type(from->type));
-	out = jv_object_set(out, jv_string("width"),
-			jv_number(from->width));
-	out = jv_object_set(out, jv_string("height"),
-			jv_number(from->height));
-	out = jv_object_set(out, jv_string("kickOffRadius"),
-			jv_number(from->kick_off_radius));
-	out = jv_object_set(out, jv_string("cornerRadius"),
-			jv_number(from->corner_radius));
-	out = jv_object_set(out, jv_string("goalLine"),
-			jv_number(from->goal_line));
-	out = jv_object_set(out, jv_string("color"),
-			_hb_jv_to_json_color(from->color));
+	if (!fallback || from->type != fallback->type)
+		out = jv_object_set(out, jv_string("type"),
+				_hb_jv_to_json_bg_type(from->type));
+	if (!fallback || !_hb_number_is(from->width, fallback->width))
+		out = jv_object_set(out, jv_string("width"),
+				jv_number(from->width));
+	if (!fallback || !_hb_number_is(from->height, fallback->height))
+		out = jv_object_set(out, jv_string("height"),
+				jv_number(from->height));
+	if (!fallback || !_hb_number_is(from->kick_off_radius, fallback->kick_off_radius))
+		out = jv_object_set(out, jv_string("kickOffRadius"),
+				jv_number(from->kick_off_radius));
+	if (!fallback || !_hb_number_is(from->corner_radius, fallback->corner_radius))
+		out = jv_object_set(out, jv_string("cornerRadius"),
+				jv_number(from->corner_radius));
+	if (!fallback || !_hb_number_is(from->goal_line, fallback->goal_line))
+		out = jv_object_set(out, jv_string("goalLine"),
+				jv_number(from->goal_line));
+	if (!fallback || from->color != fallback->color)
+		out = jv_object_set(out, jv_string("color"),
+				_hb_jv_to_json_color(from->color));
 	return out;
 }
 
@@ -1936,7 +2066,8 @@ _hb_jv_to_json_collision_flags(enum hb_collision_flags from)
 }
 
 static jv
-_hb_jv_to_json_vertex(const struct hb_vertex *from)
+_hb_jv_to_json_vertex(const struct hb_vertex *from,
+		const struct hb_vertex *fallback)
 {
 	jv out;
 	out = jv_object();
@@ -1944,17 +2075,21 @@ _hb_jv_to_json_vertex(const struct hb_vertex *from)
 			jv_number(from->x));
 	out = jv_object_set(out, jv_string("y"),
 			jv_number(from->y));
-	out = jv_object_set(out, jv_string("bCoef"),
-			jv_number(from->b_coef));
-	out = jv_object_set(out, jv_string("cGroup"),
-			_hb_jv_to_json_collision_flags(from->c_group));
-	out = jv_object_set(out, jv_string("cMask"),
-			_hb_jv_to_json_collision_flags(from->c_mask));
+	if (!fallback || !_hb_number_is(from->b_coef, fallback->b_coef))
+		out = jv_object_set(out, jv_string("bCoef"),
+				jv_number(from->b_coef));
+	if (!fallback || from->c_group != fallback->c_group)
+		out = jv_object_set(out, jv_string("cGroup"),
+				_hb_jv_to_json_collision_flags(from->c_group));
+	if (!fallback || from->c_mask != fallback->c_mask)
+		out = jv_object_set(out, jv_string("cMask"),
+				_hb_jv_to_json_collision_flags(from->c_mask));
 	return out;
 }
 
 static jv
-_hb_jv_to_json_segment(const struct hb_segment *from)
+_hb_jv_to_json_segment(const struct hb_segment *from,
+		const struct hb_segment *fallback)
 {
 	jv out;
 	out = jv_object();
@@ -1962,51 +2097,70 @@ _hb_jv_to_json_segment(const struct hb_segment *from)
 			jv_number(from->v0));
 	out = jv_object_set(out, jv_string("v1"),
 			jv_number(from->v1));
-	out = jv_object_set(out, jv_string("bCoef"),
-			jv_number(from->b_coef));
-	out = jv_object_set(out, jv_string("curve"),
-			jv_number(from->curve));
-	out = jv_object_set(out, jv_string("bias"),
-			jv_number(from->bias));
-	out = jv_object_set(out, jv_string("cGroup"),
-			_hb_jv_to_json_collision_flags(from->c_group));
-	out = jv_object_set(out, jv_string("cMask"),
-			_hb_jv_to_json_collision_flags(from->c_mask));
-	out = jv_object_set(out, jv_string("vis"),
-			jv_bool(from->vis));
-	out = jv_object_set(out, jv_string("color"),
-			_hb_jv_to_json_color(from->color));
+	if (!fallback || !_hb_number_is(from->b_coef, fallback->b_coef))
+		out = jv_object_set(out, jv_string("bCoef"),
+				jv_number(from->b_coef));
+	if (!fallback || !_hb_number_is(from->curve, fallback->curve))
+		out = jv_object_set(out, jv_string("curve"),
+				jv_number(from->curve));
+	if (!fallback || !_hb_number_is(from->bias, fallback->bias))
+		out = jv_object_set(out, jv_string("bias"),
+				jv_number(from->bias));
+	if (!fallback || from->c_group != fallback->c_group)
+		out = jv_object_set(out, jv_string("cGroup"),
+				_hb_jv_to_json_collision_flags(from->c_group));
+	if (!fallback || from->c_mask != fallback->c_mask)
+		out = jv_object_set(out, jv_string("cMask"),
+				_hb_jv_to_json_collision_flags(from->c_mask));
+	if (!fallback || from->vis != fallback->vis)
+		out = jv_object_set(out, jv_string("vis"),
+				jv_bool(from->vis));
+	if (!fallback || from->color != fallback->color)
+		out = jv_object_set(out, jv_string("color"),
+				_hb_jv_to_json_color(from->color));
 	return out;
 }
 
 static jv
-_hb_jv_to_json_player_physics(const struct hb_player_physics *from)
+_hb_jv_to_json_player_physics(const struct hb_player_physics *from,
+		const struct hb_player_physics *fallback)
 {
 	jv out;
 	out = jv_object();
-	out = jv_object_set(out, jv_string("gravity"),
-			JV_ARRAY_2(jv_number(from->gravity[0]),
-				jv_number(from->gravity[1])));
-	out = jv_object_set(out, jv_string("radius"),
-			jv_number(from->radius));
-	out = jv_object_set(out, jv_string("invMass"),
-			jv_number(from->inv_mass));
-	out = jv_object_set(out, jv_string("bCoef"),
-			jv_number(from->b_coef));
-	out = jv_object_set(out, jv_string("damping"),
-			jv_number(from->damping));
-	out = jv_object_set(out, jv_string("cGroup"),
-			_hb_jv_to_json_collision_flags(from->c_group));
-	out = jv_object_set(out, jv_string("acceleration"),
-			jv_number(from->acceleration));
-	out = jv_object_set(out, jv_string("kickingAcceleration"),
-			jv_number(from->kicking_acceleration));
-	out = jv_object_set(out, jv_string("kickingDamping"),
-			jv_number(from->kicking_damping));
-	out = jv_object_set(out, jv_string("kickStrength"),
-			jv_number(from->kick_strength));
-	out = jv_object_set(out, jv_string("kickback"),
-			jv_number(from->kickback));
+	if (!fallback || !_hb_vec2_is(from->gravity, fallback->gravity))
+		out = jv_object_set(out, jv_string("gravity"),
+				JV_ARRAY_2(jv_number(from->gravity[0]),
+					jv_number(from->gravity[1])));
+	if (!fallback || !_hb_number_is(from->radius, fallback->radius))
+		out = jv_object_set(out, jv_string("radius"),
+				jv_number(from->radius));
+	if (!fallback || !_hb_number_is(from->inv_mass, fallback->inv_mass))
+		out = jv_object_set(out, jv_string("invMass"),
+				jv_number(from->inv_mass));
+	if (!fallback || !_hb_number_is(from->b_coef, fallback->b_coef))
+		out = jv_object_set(out, jv_string("bCoef"),
+				jv_number(from->b_coef));
+	if (!fallback || !_hb_number_is(from->damping, fallback->damping))
+		out = jv_object_set(out, jv_string("damping"),
+				jv_number(from->damping));
+	if (!fallback || from->c_group != fallback->c_group)
+		out = jv_object_set(out, jv_string("cGroup"),
+				_hb_jv_to_json_collision_flags(from->c_group));
+	if (!fallback || !_hb_number_is(from->acceleration, fallback->acceleration))
+		out = jv_object_set(out, jv_string("acceleration"),
+				jv_number(from->acceleration));
+	if (!fallback || !_hb_number_is(from->kicking_acceleration, fallback->kicking_acceleration))
+		out = jv_object_set(out, jv_string("kickingAcceleration"),
+				jv_number(from->kicking_acceleration));
+	if (!fallback || !_hb_number_is(from->kicking_damping, fallback->kicking_damping))
+		out = jv_object_set(out, jv_string("kickingDamping"),
+				jv_number(from->kicking_damping));
+	if (!fallback || !_hb_number_is(from->kick_strength, fallback->kick_strength))
+		out = jv_object_set(out, jv_string("kickStrength"),
+				jv_number(from->kick_strength));
+	if (!fallback || !_hb_number_is(from->kickback, fallback->kickback))
+		out = jv_object_set(out, jv_string("kickback"),
+				jv_number(from->kickback));
 	return out;
 }
 
@@ -2038,38 +2192,50 @@ _hb_jv_to_json_goal(const struct hb_goal *from)
 }
 
 static jv
-_hb_jv_to_json_disc(const struct hb_disc *from)
+_hb_jv_to_json_disc(const struct hb_disc *from,
+		const struct hb_disc *fallback)
 {
 	jv out;
 	out = jv_object();
-	out = jv_object_set(out, jv_string("pos"),
-			JV_ARRAY_2(jv_number(from->pos[0]),
-				jv_number(from->pos[1])));
-	out = jv_object_set(out, jv_string("speed"),
-			JV_ARRAY_2(jv_number(from->speed[0]),
-				jv_number(from->speed[1])));
-	out = jv_object_set(out, jv_string("gravity"),
-			JV_ARRAY_2(jv_number(from->gravity[0]),
-				jv_number(from->gravity[1])));
-	out = jv_object_set(out, jv_string("radius"),
-			jv_number(from->radius));
-	out = jv_object_set(out, jv_string("invMass"),
-			jv_number(from->inv_mass));
-	out = jv_object_set(out, jv_string("damping"),
-			jv_number(from->damping));
-	out = jv_object_set(out, jv_string("color"),
-			_hb_jv_to_json_color(from->color));
-	out = jv_object_set(out, jv_string("bCoef"),
-			jv_number(from->b_coef));
-	out = jv_object_set(out, jv_string("cMask"),
-			_hb_jv_to_json_collision_flags(from->c_mask));
-	out = jv_object_set(out, jv_string("cGroup"),
-			_hb_jv_to_json_collision_flags(from->c_group));
+	if (!fallback || !_hb_vec2_is(from->pos, fallback->pos))
+		out = jv_object_set(out, jv_string("pos"),
+				JV_ARRAY_2(jv_number(from->pos[0]),
+					jv_number(from->pos[1])));
+	if (!fallback || !_hb_vec2_is(from->speed, fallback->speed))
+		out = jv_object_set(out, jv_string("speed"),
+				JV_ARRAY_2(jv_number(from->speed[0]),
+					jv_number(from->speed[1])));
+	if (!fallback || !_hb_vec2_is(from->gravity, fallback->gravity))
+		out = jv_object_set(out, jv_string("gravity"),
+				JV_ARRAY_2(jv_number(from->gravity[0]),
+					jv_number(from->gravity[1])));
+	if (!fallback || !_hb_number_is(from->radius, fallback->radius))
+		out = jv_object_set(out, jv_string("radius"),
+				jv_number(from->radius));
+	if (!fallback || !_hb_number_is(from->inv_mass, fallback->inv_mass))
+		out = jv_object_set(out, jv_string("invMass"),
+				jv_number(from->inv_mass));
+	if (!fallback || !_hb_number_is(from->damping, fallback->damping))
+		out = jv_object_set(out, jv_string("damping"),
+				jv_number(from->damping));
+	if (!fallback || from->color != fallback->color)
+		out = jv_object_set(out, jv_string("color"),
+				_hb_jv_to_json_color(from->color));
+	if (!fallback || !_hb_number_is(from->b_coef, fallback->b_coef))
+		out = jv_object_set(out, jv_string("bCoef"),
+				jv_number(from->b_coef));
+	if (!fallback || from->c_mask != fallback->c_mask)
+		out = jv_object_set(out, jv_string("cMask"),
+				_hb_jv_to_json_collision_flags(from->c_mask));
+	if (!fallback || from->c_group != fallback->c_group)
+		out = jv_object_set(out, jv_string("cGroup"),
+				_hb_jv_to_json_collision_flags(from->c_group));
 	return out;
 }
 
 static jv
-_hb_jv_to_json_plane(const struct hb_plane *from)
+_hb_jv_to_json_plane(const struct hb_plane *from,
+		const struct hb_plane *fallback)
 {
 	jv out;
 	out = jv_object();
@@ -2078,12 +2244,15 @@ _hb_jv_to_json_plane(const struct hb_plane *from)
 				jv_number(from->normal[1])));
 	out = jv_object_set(out, jv_string("dist"),
 			jv_number(from->dist));
-	out = jv_object_set(out, jv_string("bCoef"),
-			jv_number(from->b_coef));
-	out = jv_object_set(out, jv_string("cMask"),
-			_hb_jv_to_json_collision_flags(from->c_mask));
-	out = jv_object_set(out, jv_string("cGroup"),
-			_hb_jv_to_json_collision_flags(from->c_group));
+	if (!fallback || !_hb_number_is(from->b_coef, fallback->b_coef))
+		out = jv_object_set(out, jv_string("bCoef"),
+				jv_number(from->b_coef));
+	if (!fallback || from->c_mask != fallback->c_mask)
+		out = jv_object_set(out, jv_string("cMask"),
+				_hb_jv_to_json_collision_flags(from->c_mask));
+	if (!fallback || from->c_group != fallback->c_group)
+		out = jv_object_set(out, jv_string("cGroup"),
+				_hb_jv_to_json_collision_flags(from->c_group));
 	return out;
 }
 
@@ -2112,7 +2281,8 @@ _hb_jv_to_json_joint_strength(const struct hb_joint_strength *from)
 }
 
 static jv
-_hb_jv_to_json_joint(const struct hb_joint *from)
+_hb_jv_to_json_joint(const struct hb_joint *from,
+		const struct hb_joint *fallback)
 {
 	jv out;
 	out = jv_object();
@@ -2120,12 +2290,15 @@ _hb_jv_to_json_joint(const struct hb_joint *from)
 			jv_number(from->d0));
 	out = jv_object_set(out, jv_string("d1"),
 			jv_number(from->d1));
-	out = jv_object_set(out, jv_string("length"),
-			_hb_jv_to_json_joint_length(&from->length));
-	out = jv_object_set(out, jv_string("strength"),
-			_hb_jv_to_json_joint_strength(&from->strength));
-	out = jv_object_set(out, jv_string("color"),
-			_hb_jv_to_json_color(from->color));
+	if (!fallback || from->length.kind != fallback->length.kind)
+		out = jv_object_set(out, jv_string("length"),
+				_hb_jv_to_json_joint_length(&from->length));
+	if (!fallback || from->strength.is_rigid != fallback->strength.is_rigid)
+		out = jv_object_set(out, jv_string("strength"),
+				_hb_jv_to_json_joint_strength(&from->strength));
+	if (!fallback || from->color != fallback->color)
+		out = jv_object_set(out, jv_string("color"),
+				_hb_jv_to_json_color(from->color));
 	return out;
 }
 
@@ -2139,10 +2312,424 @@ _hb_jv_to_json_point(const struct hb_point *from)
 	return out;
 }
 
+/* traits synthesized by HB_STADIUM_JSON_TRAITS, a field can only be
+   inherited by the element kinds whose parser looks it up in a trait */
+struct _hb_trait_table {
+	struct hb_trait                         *traits;
+	int                                       count;
+	int                                    capacity;
+};
+
+struct _hb_trait_kind {
+	void (*resolve)(const struct hb_trait *trait, void *fallback);
+	bool (*equals)(const void *a, const void *b);
+	void (*derive)(const void *from, struct hb_trait *to);
+};
+
+static void
+_hb_trait_resolve_vertex(const struct hb_trait *trait, void *fallback)
+{
+	struct hb_vertex *vert;
+	vert = fallback;
+	*vert = _hb_fallback_vertex;
+	if (NULL == trait) return;
+	if (trait->has_b_coef) vert->b_coef = trait->b_coef;
+	if (trait->has_c_group) vert->c_group = trait->c_group;
+	if (trait->has_c_mask) vert->c_mask = trait->c_mask;
+}
+
+static bool
+_hb_trait_equals_vertex(const void *a, const void *b)
+{
+	const struct hb_vertex *va, *vb;
+	va = a;
+	vb = b;
+	return _hb_number_is(va->b_coef, vb->b_coef) &&
+		va->c_group == vb->c_group &&
+		va->c_mask == vb->c_mask;
+}
+
+static void
+_hb_trait_derive_vertex(const void *from, struct hb_trait *to)
+{
+	const struct hb_vertex *vert;
+	vert = from;
+	memset(to, 0, sizeof(struct hb_trait));
+	if (!_hb_number_is(vert->b_coef, _hb_fallback_vertex.b_coef)) {
+		to->has_b_coef = true;
+		to->b_coef = vert->b_coef;
+	}
+	if (vert->c_group != _hb_fallback_vertex.c_group) {
+		to->has_c_group = true;
+		to->c_group = vert->c_group;
+	}
+	if (vert->c_mask != _hb_fallback_vertex.c_mask) {
+		to->has_c_mask = true;
+		to->c_mask = vert->c_mask;
+	}
+}
+
+static void
+_hb_trait_resolve_segment(const struct hb_trait *trait, void *fallback)
+{
+	struct hb_segment *segm;
+	segm = fallback;
+	*segm = _hb_fallback_segment;
+	if (NULL == trait) return;
+	if (trait->has_b_coef) segm->b_coef = trait->b_coef;
+	if (trait->has_c_group) segm->c_group = trait->c_group;
+	if (trait->has_c_mask) segm->c_mask = trait->c_mask;
+	if (trait->has_vis) segm->vis = trait->vis;
+	if (trait->has_color) segm->color = trait->color;
+}
+
+static bool
+_hb_trait_equals_segment(const void *a, const void *b)
+{
+	const struct hb_segment *sa, *sb;
+	sa = a;
+	sb = b;
+	return _hb_number_is(sa->b_coef, sb->b_coef) &&
+		sa->c_group == sb->c_group &&
+		sa->c_mask == sb->c_mask &&
+		sa->vis == sb->vis &&
+		sa->color == sb->color;
+}
+
+static void
+_hb_trait_derive_segment(const void *from, struct hb_trait *to)
+{
+	const struct hb_segment *segm;
+	segm = from;
+	memset(to, 0, sizeof(struct hb_trait));
+	if (!_hb_number_is(segm->b_coef, _hb_fallback_segment.b_coef)) {
+		to->has_b_coef = true;
+		to->b_coef = segm->b_coef;
+	}
+	if (segm->c_group != _hb_fallback_segment.c_group) {
+		to->has_c_group = true;
+		to->c_group = segm->c_group;
+	}
+	if (segm->c_mask != _hb_fallback_segment.c_mask) {
+		to->has_c_mask = true;
+		to->c_mask = segm->c_mask;
+	}
+	if (segm->vis != _hb_fallback_segment.vis) {
+		to->has_vis = true;
+		to->vis = segm->vis;
+	}
+	if (segm->color != _hb_fallback_segment.color) {
+		to->has_color = true;
+		to->color = segm->color;
+	}
+}
+
+static void
+_hb_trait_resolve_disc(const struct hb_trait *trait, void *fallback)
+{
+	struct hb_disc *disc;
+	disc = fallback;
+	*disc = _hb_fallback_disc;
+	if (NULL == trait) return;
+	if (trait->has_radius) disc->radius = trait->radius;
+	if (trait->has_inv_mass) disc->inv_mass = trait->inv_mass;
+	if (trait->has_color) disc->color = trait->color;
+	if (trait->has_b_coef) disc->b_coef = trait->b_coef;
+	if (trait->has_c_mask) disc->c_mask = trait->c_mask;
+	if (trait->has_c_group) disc->c_group = trait->c_group;
+}
+
+static bool
+_hb_trait_equals_disc(const void *a, const void *b)
+{
+	const struct hb_disc *da, *db;
+	da = a;
+	db = b;
+	return _hb_number_is(da->radius, db->radius) &&
+		_hb_number_is(da->inv_mass, db->inv_mass) &&
+		da->color == db->color &&
+		_hb_number_is(da->b_coef, db->b_coef) &&
+		da->c_mask == db->c_mask &&
+		da->c_group == db->c_group;
+}
+
+static void
+_hb_trait_derive_disc(const void *from, struct hb_trait *to)
+{
+	const struct hb_disc *disc;
+	disc = from;
+	memset(to, 0, sizeof(struct hb_trait));
+	if (!_hb_number_is(disc->radius, _hb_fallback_disc.radius)) {
+		to->has_radius = true;
+		to->radius = disc->radius;
+	}
+	if (!_hb_number_is(disc->inv_mass, _hb_fallback_disc.inv_mass)) {
+		to->has_inv_mass = true;
+		to->inv_mass = disc->inv_mass;
+	}
+	if (disc->color != _hb_fallback_disc.color) {
+		to->has_color = true;
+		to->color = disc->color;
+	}
+	if (!_hb_number_is(disc->b_coef, _hb_fallback_disc.b_coef)) {
+		to->has_b_coef = true;
+		to->b_coef = disc->b_coef;
+	}
+	if (disc->c_mask != _hb_fallback_disc.c_mask) {
+		to->has_c_mask = true;
+		to->c_mask = disc->c_mask;
+	}
+	if (disc->c_group != _hb_fallback_disc.c_group) {
+		to->has_c_group = true;
+		to->c_group = disc->c_group;
+	}
+}
+
+static void
+_hb_trait_resolve_plane(const struct hb_trait *trait, void *fallback)
+{
+	struct hb_plane *plane;
+	plane = fallback;
+	*plane = _hb_fallback_plane;
+	if (NULL == trait) return;
+	if (trait->has_b_coef) plane->b_coef = trait->b_coef;
+	if (trait->has_c_mask) plane->c_mask = trait->c_mask;
+	if (trait->has_c_group) plane->c_group = trait->c_group;
+}
+
+static bool
+_hb_trait_equals_plane(const void *a, const void *b)
+{
+	const struct hb_plane *pa, *pb;
+	pa = a;
+	pb = b;
+	return _hb_number_is(pa->b_coef, pb->b_coef) &&
+		pa->c_mask == pb->c_mask &&
+		pa->c_group == pb->c_group;
+}
+
+static void
+_hb_trait_derive_plane(const void *from, struct hb_trait *to)
+{
+	const struct hb_plane *plane;
+	plane = from;
+	memset(to, 0, sizeof(struct hb_trait));
+	if (!_hb_number_is(plane->b_coef, _hb_fallback_plane.b_coef)) {
+		to->has_b_coef = true;
+		to->b_coef = plane->b_coef;
+	}
+	if (plane->c_mask != _hb_fallback_plane.c_mask) {
+		to->has_c_mask = true;
+		to->c_mask = plane->c_mask;
+	}
+	if (plane->c_group != _hb_fallback_plane.c_group) {
+		to->has_c_group = true;
+		to->c_group = plane->c_group;
+	}
+}
+
+static const struct _hb_trait_kind _hb_trait_kind_vertex = {
+	_hb_trait_resolve_vertex, _hb_trait_equals_vertex, _hb_trait_derive_vertex
+};
+
+static const struct _hb_trait_kind _hb_trait_kind_segment = {
+	_hb_trait_resolve_segment, _hb_trait_equals_segment, _hb_trait_derive_segment
+};
+
+static const struct _hb_trait_kind _hb_trait_kind_disc = {
+	_hb_trait_resolve_disc, _hb_trait_equals_disc, _hb_trait_derive_disc
+};
+
+static const struct _hb_trait_kind _hb_trait_kind_plane = {
+	_hb_trait_resolve_plane, _hb_trait_equals_plane, _hb_trait_derive_plane
+};
+
+static int
+_hb_trait_field_count(const struct hb_trait *trait)
+{
+	return trait->has_curve + trait->has_damping + trait->has_inv_mass +
+		trait->has_radius + trait->has_b_coef + trait->has_color +
+		trait->has_vis + trait->has_c_group + trait->has_c_mask;
+}
+
+static int
+_hb_trait_table_assign(struct _hb_trait_table *table,
+		const struct _hb_trait_kind *kind, const void *const *elements,
+		int count, int *assigned)
+{
+	union {
+		struct hb_vertex vertex;
+		struct hb_segment segment;
+		struct hb_disc disc;
+		struct hb_plane plane;
+	} fallback;
+	struct hb_trait derived, *traits;
+	int *group_first, *group_count;
+	int group, groups, i, t, fields, capacity;
+
+	group_first = malloc((count + 1) * sizeof(int));
+	group_count = malloc((count + 1) * sizeof(int));
+	groups = 0;
+
+	if (!group_first || !group_count)
+		goto err;
+
+	for (i = 0; i < count; ++i) {
+		for (group = 0; group < groups; ++group)
+			if (kind->equals(elements[group_first[group]], elements[i]))
+				break;
+		if (group == groups) {
+			group_first[groups] = i;
+			group_count[groups++] = 0;
+		}
+		group_count[group]++;
+		assigned[i] = group;
+	}
+
+	for (group = 0; group < groups; ++group) {
+		/* reuse any trait that already resolves to this tuple */
+		for (t = 0; t < table->count; ++t) {
+			kind->resolve(&table->traits[t], &fallback);
+			if (kind->equals(&fallback, elements[group_first[group]]))
+				break;
+		}
+		if (t == table->count) {
+			kind->derive(elements[group_first[group]], &derived);
+			fields = _hb_trait_field_count(&derived);
+			/* the "trait" key costs about as much as one field */
+			if ((group_count[group] - 1) * fields > group_count[group] + 1) {
+				if (table->count == table->capacity) {
+					capacity = table->capacity ? table->capacity * 2 : 8;
+					if (NULL == (traits = realloc(table->traits,
+								capacity * sizeof(struct hb_trait))))
+						goto err;
+					table->traits = traits;
+					table->capacity = capacity;
+				}
+				table->traits[table->count++] = derived;
+			} else {
+				t = -1;
+			}
+		}
+		group_first[group] = t;
+	}
+
+	for (i = 0; i < count; ++i)
+		assigned[i] = group_first[assigned[i]];
+
+	free(group_first);
+	free(group_count);
+	return 0;
+
+err:
+	free(group_first);
+	free(group_count);
+	return -1;
+}
+
+static jv
+_hb_jv_to_json_trait(const struct hb_trait *from)
+{
+	jv out;
+	out = jv_object();
+	if (from->has_curve)
+		out = jv_object_set(out, jv_string("curve"),
+				jv_number(from->curve));
+	if (from->has_damping)
+		out = jv_object_set(out, jv_string("damping"),
+				jv_number(from->damping));
+	if (from->has_inv_mass)
+		out = jv_object_set(out, jv_string("invMass"),
+				jv_number(from->inv_mass));
+	if (from->has_radius)
+		out = jv_object_set(out, jv_string("radius"),
+				jv_number(from->radius));
+	if (from->has_b_coef)
+		out = jv_object_set(out, jv_string("bCoef"),
+				jv_number(from->b_coef));
+	if (from->has_color)
+		out = jv_object_set(out, jv_string("color"),
+				_hb_jv_to_json_color(from->color));
+	if (from->has_vis)
+		out = jv_object_set(out, jv_string("vis"),
+				jv_bool(from->vis));
+	if (from->has_c_group)
+		out = jv_object_set(out, jv_string("cGroup"),
+				_hb_jv_to_json_collision_flags(from->c_group));
+	if (from->has_c_mask)
+		out = jv_object_set(out, jv_string("cMask"),
+				_hb_jv_to_json_collision_flags(from->c_mask));
+	return out;
+}
+
 static jv
-_hb_jv_to_json_stadium(const struct hb_stadium *s)
+_hb_jv_set_trait(jv elem, int trait)
+{
+	if (trait < 0)
+		return elem;
+	return jv_object_set(elem, jv_string("trait"),
+			jv_string_fmt("t%d", trait));
+}
+
+static int
+_hb_list_length(const void *const *list)
+{
+	int count;
+	count = 0;
+	if (list)
+		while (list[count])
+			++count;
+	return count;
+}
+
+static jv
+_hb_jv_object_set_list(jv root, const char *key, jv list, bool compact)
+{
+	if (compact && jv_array_length(jv_copy(list)) == 0) {
+		jv_free(list);
+		return root;
+	}
+	return jv_object_set(root, jv_string(key), list);
+}
+
+static jv
+_hb_jv_to_json_stadium(const struct hb_stadium *s, int flags)
 {
 	jv root;
+	bool compact;
+	struct _hb_trait_table table;
+	int *vertex_traits, *segment_traits, *disc_traits, *plane_traits;
+	int vertex_count, segment_count, disc_count, plane_count, i;
+
+	compact = flags & (HB_STADIUM_JSON_COMPACT | HB_STADIUM_JSON_TRAITS);
+	memset(&table, 0, sizeof(table));
+	vertex_traits = segment_traits = disc_traits = plane_traits = NULL;
+	vertex_count = _hb_list_length((const void *const *)s->vertexes);
+	segment_count = _hb_list_length((const void *const *)s->segments);
+	disc_count = _hb_list_length((const void *const *)s->discs);
+	plane_count = _hb_list_length((const void *const *)s->planes);
+
+	if (flags & HB_STADIUM_JSON_TRAITS) {
+		vertex_traits = malloc((vertex_count + 1) * sizeof(int));
+		segment_traits = malloc((segment_count + 1) * sizeof(int));
+		disc_traits = malloc((disc_count + 1) * sizeof(int));
+		plane_traits = malloc((plane_count + 1) * sizeof(int));
+		if (!vertex_traits || !segment_traits || !disc_traits || !plane_traits)
+			goto err;
+		/* segments first, they read the most fields from a trait.
+		   disc0 is skipped since ballPhysics ignores traits */
+		disc_traits[0] = -1;
+		if (_hb_trait_table_assign(&table, &_hb_trait_kind_segment,
+					(const void *const *)s->segments, segment_count, segment_traits) < 0 ||
+				(disc_count > 1 && _hb_trait_table_assign(&table, &_hb_trait_kind_disc,
+					(const void *const *)s->discs + 1, disc_count - 1, disc_traits + 1) < 0) ||
+				_hb_trait_table_assign(&table, &_hb_trait_kind_vertex,
+					(const void *const *)s->vertexes, vertex_count, vertex_traits) < 0 ||
+				_hb_trait_table_assign(&table, &_hb_trait_kind_plane,
+					(const void *const *)s->planes, plane_count, plane_traits) < 0)
+			goto err;
+	}
+
 	root = jv_object();
 	root = jv_object_set(root, jv_string("name"),
 			jv_string(s->name));
@@ -2156,49 +2743,96 @@ _hb_jv_to_json_stadium(const struct hb_stadium *s)
 		root = jv_object_set(root, jv_string("cameraHeight"),
 				jv_number(s->camera_height));
 	}
-	root = jv_object_set(root, jv_string("maxViewWidth"),
-			jv_number(s->max_view_width));
-	root = jv_object_set(root, jv_string("cameraFollow"),
-			_hb_jv_to_json_camera_follow(s->camera_follow));
-	root = jv_object_set(root, jv_string("spawnDistance"),
-			jv_number(s->spawn_distance));
-	root = jv_object_set(root, jv_string("canBeStored"),
-			jv_bool(s->can_be_stored));
-	root = jv_object_set(root, jv_string("kickOffReset"),
-			_hb_jv_to_json_kick_off_reset(s->kick_off_reset));
+	if (!compact || !_hb_number_is(s->max_view_width, 0))
+		root = jv_object_set(root, jv_string("maxViewWidth"),
+				jv_number(s->max_view_width));
+	if (!compact || s->camera_follow != HB_CAMERA_FOLLOW_BALL)
+		root = jv_object_set(root, jv_string("cameraFollow"),
+				_hb_jv_to_json_camera_follow(s->camera_follow));
+	if (!compact || !_hb_number_is(s->spawn_distance, 0))
+		root = jv_object_set(root, jv_string("spawnDistance"),
+				jv_number(s->spawn_distance));
+	if (!compact || !s->can_be_stored)
+		root = jv_object_set(root, jv_string("canBeStored"),
+				jv_bool(s->can_be_stored));
+	if (!compact || s->kick_off_reset != HB_KICK_OFF_RESET_PARTIAL)
+		root = jv_object_set(root, jv_string("kickOffReset"),
+				_hb_jv_to_json_kick_off_reset(s->kick_off_reset));
 	root = jv_object_set(root, jv_string("ballPhysics"),
 			jv_string("disc0"));
-	root = jv_object_set(root, jv_string("playerPhysics"),
-			_hb_jv_to_json_player_physics(s->player_physics));
-	root = jv_object_set(root, jv_string("bg"),
-			_hb_jv_to_json_bg(s->bg));
+
+	/////////////playerPhysics
+	{
+		jv player_physics;
+		player_physics = _hb_jv_to_json_player_physics(s->player_physics,
+				compact ? &_hb_fallback_player_physics : NULL);
+		if (compact && jv_object_length(jv_copy(player_physics)) == 0)
+			jv_free(player_physics);
+		else
+			root = jv_object_set(root, jv_string("playerPhysics"),
+					player_physics);
+	}
+
+	/////////////bg
+	{
+		jv bg;
+		bg = _hb_jv_to_json_bg(s->bg, compact ? &_hb_fallback_bg : NULL);
+		if (compact && jv_object_length(jv_copy(bg)) == 0)
+			jv_free(bg);
+		else
+			root = jv_object_set(root, jv_string("bg"), bg);
+	}
+
+	/////////////traits
+	if (table.count > 0) {
+		jv traits;
+		traits = jv_object();
+
+		for (i = 0; i < table.count; ++i) {
+			traits = jv_object_set(traits, jv_string_fmt("t%d", i),
+					_hb_jv_to_json_trait(&table.traits[i]));
+		}
+
+		root = jv_object_set(root, jv_string("traits"),
+			traits);
+	}
 
 	/////////////vertexes
 	{
 		jv vertexes;
+		struct hb_vertex fallback;
+		int trait;
 		vertexes = jv_array();
 
-		hb_stadium_vertexes_foreach(s, vertex) {
+		for (i = 0; i < vertex_count; ++i) {
+			trait = vertex_traits ? vertex_traits[i] : -1;
+			_hb_trait_resolve_vertex(trait < 0 ? NULL : &table.traits[trait], &fallback);
 			vertexes = jv_array_append(vertexes,
-					_hb_jv_to_json_vertex(vertex));
+					_hb_jv_set_trait(_hb_jv_to_json_vertex(s->vertexes[i],
+							compact ? &fallback : NULL), trait));
 		}
 
-		root = jv_object_set(root, jv_string("vertexes"),
-			vertexes);
+		root = _hb_jv_object_set_list(root, "vertexes",
+			vertexes, compact);
 	}
 
 	/////////////segments
 	{
 		jv segments;
+		struct hb_segment fallback;
+		int trait;
 		segments = jv_array();
 
-		hb_stadium_segments_foreach(s, segment) {
+		for (i = 0; i < segment_count; ++i) {
+			trait = segment_traits ? segment_traits[i] : -1;
+			_hb_trait_resolve_segment(trait < 0 ? NULL : &table.traits[trait], &fallback);
 			segments = jv_array_append(segments,
-					_hb_jv_to_json_segment(segment));
+					_hb_jv_set_trait(_hb_jv_to_json_segment(s->segments[i],
+							compact ? &fallback : NULL), trait));
 		}
 
-		root = jv_object_set(root, jv_string("segments"),
-			segments);
+		root = _hb_jv_object_set_list(root, "segments",
+			segments, compact);
 	}
 
 	/////////////goals
@@ -2211,18 +2845,26 @@ _hb_jv_to_json_stadium(const struct hb_stadium *s)
 					_hb_jv_to_json_goal(goal));
 		}
 
-		root = jv_object_set(root, jv_string("goals"),
-			goals);
+		root = _hb_jv_object_set_list(root, "goals",
+			goals, compact);
 	}
 
 	/////////////discs
 	{
 		jv discs;
+		struct hb_disc fallback;
+		int trait;
 		discs = jv_array();
 
-		hb_stadium_discs_foreach(s, disc) {
+		for (i = 0; i < disc_count; ++i) {
+			trait = disc_traits ? disc_traits[i] : -1;
+			_hb_trait_resolve_disc(trait < 0 ? NULL : &table.traits[trait], &fallback);
+			/* disc0 is read back through _hb_jv_parse_ball_physics */
+			if (i == 0)
+				fallback = _hb_fallback_ball_physics;
 			discs = jv_array_append(discs,
-					_hb_jv_to_json_disc(disc));
+					_hb_jv_set_trait(_hb_jv_to_json_disc(s->discs[i],
+							compact ? &fallback : NULL), trait));
 		}
 
 		root = jv_object_set(root, jv_string("discs"),
@@ -2232,15 +2874,20 @@ _hb_jv_to_json_stadium(const struct hb_stadium *s)
 	/////////////planes
 	{
 		jv planes;
+		struct hb_plane fallback;
+		int trait;
 		planes = jv_array();
 
-		hb_stadium_planes_foreach(s, plane) {
+		for (i = 0; i < plane_count; ++i) {
+			trait = plane_traits ? plane_traits[i] : -1;
+			_hb_trait_resolve_plane(trait < 0 ? NULL : &table.traits[trait], &fallback);
 			planes = jv_array_append(planes,
-					_hb_jv_to_json_plane(plane));
+					_hb_jv_set_trait(_hb_jv_to_json_plane(s->planes[i],
+							compact ? &fallback : NULL), trait));
 		}
 
-		root = jv_object_set(root, jv_string("planes"),
-			planes);
+		root = _hb_jv_object_set_list(root, "planes",
+			planes, compact);
 	}
 
 	///////////joints
@@ -2250,11 +2897,12 @@ _hb_jv_to_json_stadium(const struct hb_stadium *s)
 
 		hb_stadium_joints_foreach(s, joint) {
 			joints = jv_array_append(joints,
-					_hb_jv_to_json_joint(joint));
+					_hb_jv_to_json_joint(joint,
+						compact ? &_hb_fallback_joint : NULL));
 		}
 
-		root = jv_object_set(root, jv_string("joints"),
-			joints);
+		root = _hb_jv_object_set_list(root, "joints",
+			joints, compact);
 	}
 
 	/////////////redSpawnPoints
@@ -2267,8 +2915,8 @@ _hb_jv_to_json_stadium(const struct hb_stadium *s)
 					_hb_jv_to_json_point(point));
 		}
 
-		root = jv_object_set(root, jv_string("redSpawnPoints"),
-			red_spawn_points);
+		root = _hb_jv_object_set_list(root, "redSpawnPoints",
+			red_spawn_points, compact);
 	}
 
 	/////////////blueSpawnPoints
@@ -2281,11 +2929,238 @@ _hb_jv_to_json_stadium(const struct hb_stadium *s)
 					_hb_jv_to_json_point(point));
 		}
 
-		root = jv_object_set(root, jv_string("blueSpawnPoints"),
-			blue_spawn_points);
+		root = _hb_jv_object_set_list(root, "blueSpawnPoints",
+			blue_spawn_points, compact);
 	}
 
+	free(table.traits);
+	free(vertex_traits);
+	free(segment_traits);
+	free(disc_traits);
+	free(plane_traits);
+
 	return root;
+
+err:
+	free(table.traits);
+	free(vertex_traits);
+	free(segment_traits);
+	free(disc_traits);
+	free(plane_traits);
+
+	return jv_invalid();
+}
+
+/* a failed append leaves err set and the buffer as it was */
+struct _hb_strbuf {
+	char                                  *data;
+	size_t                                  len;
+	size_t                                  cap;
+	bool                                    err;
+};
+
+static int
+_hb_strbuf_reserve(struct _hb_strbuf *buf, size_t n)
+{
+	char *data;
+	size_t cap;
+
+	if (buf->len + n + 1 <= buf->cap)
+		return 0;
+	for (cap = buf->cap; buf->len + n + 1 > cap; )
+		cap = cap ? cap * 2 : 4096;
+	if (NULL == (data = realloc(buf->data, cap))) {
+		buf->err = true;
+		return -1;
+	}
+	buf->data = data;
+	buf->cap = cap;
+	return 0;
+}
+
+static int
+_hb_strbuf_append(struct _hb_strbuf *buf, const char *str, size_t n)
+{
+	if (buf->err || _hb_strbuf_reserve(buf, n) < 0)
+		return -1;
+	memcpy(buf->data + buf->len, str, n);
+	buf->len += n;
+	buf->data[buf->len] = '\0';
+	return 0;
+}
+
+static int
+_hb_format_uint(uint64_t from, char *to)
+{
+	char tmp[20];
+	int len, i;
+	len = 0;
+	do {
+		tmp[len++] = '0' + from % 10;
+		from /= 10;
+	} while (from);
+	for (i = 0; i < len; ++i)
+		to[i] = tmp[len - i - 1];
+	return len;
+}
+
+/* shortest decimal that reads back as exactly the same double, every
+   candidate is checked before it is accepted so the fast paths can never
+   lose a bit, they only have to be right often enough to pay off */
+static int
+_hb_format_number(double from, char *to)
+{
+	static const double pow10[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8,
+		1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15
+	};
+	double abs, scaled, rounded;
+	uint64_t mantissa;
+	int len, digits, frac, prec, i;
+	char *end;
+
+	/* same as jv_dump_string */
+	if (from != from)
+		return sprintf(to, "null");
+	if (from > DBL_MAX) from = DBL_MAX;
+	if (from < -DBL_MAX) from = -DBL_MAX;
+
+	len = 0;
+	if (signbit(from))
+		to[len++] = '-';
+	abs = fabs(from);
+
+	/////////////integers
+	if (abs < 1e15 && abs == (double)(uint64_t)abs)
+		return len + _hb_format_uint((uint64_t)abs, to + len);
+
+	/////////////short decimals
+	if (abs >= 1e-4 && abs < 1e15) {
+		for (frac = 1; frac < 16; ++frac) {
+			scaled = abs * pow10[frac];
+			/* past 15 digits the product is too coarse to pick the
+			   closest candidate, leave those to printf */
+			if (scaled >= 1e15)
+				break;
+			rounded = floor(scaled + 0.5);
+			if (rounded / pow10[frac] != abs)
+				continue;
+			mantissa = (uint64_t)rounded;
+			digits = _hb_format_uint(mantissa, to + len);
+			if (digits <= frac) {
+				memmove(to + len + 2 + frac - digits, to + len, digits);
+				to[len] = '0';
+				to[len + 1] = '.';
+				for (i = 0; i < frac - digits; ++i)
+					to[len + 2 + i] = '0';
+				return len + 2 + frac;
+			}
+			memmove(to + len + digits - frac + 1, to + len + digits - frac, frac);
+			to[len + digits - frac] = '.';
+			return len + digits + 1;
+		}
+	}
+
+	/////////////everything else
+	for (prec = 15; prec < 17; ++prec) {
+		sprintf(to, "%.*g", prec, from);
+		if (strtod(to, &end) == from)
+			return end - to;
+	}
+	return sprintf(to, "%.17g", from);
+}
+
+static void
+_hb_strbuf_append_json_string(struct _hb_strbuf *buf, const char *str)
+{
+	static const char hex[] = "0123456789abcdef";
+	const char *run;
+	char esc[6];
+	unsigned char c;
+
+	_hb_strbuf_append(buf, "\"", 1);
+	for (run = str; (c = *str); ++str) {
+		if (c >= 0x20 && c != '"' && c != '\\' && c != 0x7f)
+			continue;
+		_hb_strbuf_append(buf, run, str - run);
+		run = str + 1;
+		esc[0] = '\\';
+		switch (c) {
+		case '"': esc[1] = '"'; break;
+		case '\\': esc[1] = '\\'; break;
+		case '\b': esc[1] = 'b'; break;
+		case '\f': esc[1] = 'f'; break;
+		case '\n': esc[1] = 'n'; break;
+		case '\r': esc[1] = 'r'; break;
+		case '\t': esc[1] = 't'; break;
+		default:
+			esc[1] = 'u';
+			esc[2] = '0';
+			esc[3] = '0';
+			esc[4] = hex[c >> 4];
+			esc[5] = hex[c & 0xf];
+			_hb_strbuf_append(buf, esc, 6);
+			continue;
+		}
+		_hb_strbuf_append(buf, esc, 2);
+	}
+	_hb_strbuf_append(buf, run, str - run);
+	_hb_strbuf_append(buf, "\"", 1);
+}
+
+/* stands in for jv_dump_string(from, 0), mainly to get numbers out
+   without going through jq's arbitrary precision dtoa */
+static void
+_hb_jv_dump(jv from, struct _hb_strbuf *buf)
+{
+	char num[32];
+	bool first;
+
+	switch (jv_get_kind(from)) {
+	case JV_KIND_NULL:
+		_hb_strbuf_append(buf, "null", 4);
+		break;
+	case JV_KIND_FALSE:
+		_hb_strbuf_append(buf, "false", 5);
+		break;
+	case JV_KIND_TRUE:
+		_hb_strbuf_append(buf, "true", 4);
+		break;
+	case JV_KIND_NUMBER:
+		_hb_strbuf_append(buf, num,
+				_hb_format_number(jv_number_value(from), num));
+		break;
+	case JV_KIND_STRING:
+		_hb_strbuf_append_json_string(buf, jv_string_value(from));
+		break;
+	case JV_KIND_ARRAY:
+		_hb_strbuf_append(buf, "[", 1);
+		jv_array_foreach(from, index, value) {
+			if (index > 0)
+				_hb_strbuf_append(buf, ",", 1);
+			_hb_jv_dump(value, buf);
+		}
+		_hb_strbuf_append(buf, "]", 1);
+		break;
+	case JV_KIND_OBJECT:
+		first = true;
+		_hb_strbuf_append(buf, "{", 1);
+		jv_object_foreach(from, key, value) {
+			if (!first)
+				_hb_strbuf_append(buf, ",", 1);
+			first = false;
+			_hb_strbuf_append_json_string(buf, jv_string_value(key));
+			_hb_strbuf_append(buf, ":", 1);
+			_hb_jv_dump(value, buf);
+			jv_free(key);
+		}
+		_hb_strbuf_append(buf, "}", 1);
+		break;
+	default:
+		break;
+	}
+
+	jv_free(from);
 }
 
 extern struct hb_stadium *
@@ -2532,57 +3407,103 @@ hb_stadium_from_file(const char *file)
 extern char *
 hb_stadium_to_json(const struct hb_stadium *s)
 {
-	jv root, out;
-	char *str;
+	return hb_stadium_to_json_ex(s, 0);
+}
 
-	root = _hb_jv_to_json_stadium(s);
-	out = jv_dump_string(root, 0);
-	str = strdup(jv_string_value(out));
-	jv_free(out);
+extern char *
+hb_stadium_to_json_ex(const struct hb_stadium *s, int flags)
+{
+	struct _hb_strbuf buf;
+	jv root;
 
-	return str;
+	root = _hb_jv_to_json_stadium(s, flags);
+	if (jv_get_kind(root) == JV_KIND_INVALID) {
+		jv_free(root);
+		return NULL;
+	}
+
+	memset(&buf, 0, sizeof(buf));
+	_hb_jv_dump(root, &buf);
+
+	if (buf.err) {
+		free(buf.data);
+		return NULL;
+	}
+
+	return buf.data;
 }
 
 extern void
 hb_stadium_print(const struct hb_stadium *s)
 {
-	jv root, out;
+	char *str;
 
-	root = _hb_jv_to_json_stadium(s);
-	out = jv_dump_string(root, 0);
-	printf("%s\n", jv_string_value(out));
-	jv_free(out);
+	if (NULL == (str = hb_stadium_to_json(s)))
+		return;
+	printf("%s\n", str);
+	free(str);
+}
+
+static void
+_hb_stadium_release(struct hb_stadium *s, unsigned sections)
+{
+	sections &= ~s->borrowed;
+
+	if (sections & HB_STADIUM_SECTION_NAME) free(s->name);
+	if (sections & HB_STADIUM_SECTION_BG) free(s->bg);
+	if (sections & HB_STADIUM_SECTION_PLAYER_PHYSICS) free(s->player_physics);
+
+	if (sections & HB_STADIUM_SECTION_TRAITS) {
+		hb_stadium_traits_foreach(s, trait) {
+			free(trait->name);
+			free(trait);
+		}
+		free(s->traits);
+	}
+
+#define _HB_RELEASE_LIST(section,list) \
+	if ((sections & section) && s->list) { \
+		for (size_t i = 0; s->list[i]; ++i) \
+			free(s->list[i]); \
+		free(s->list); \
+	}
+
+	_HB_RELEASE_LIST(HB_STADIUM_SECTION_VERTEXES, vertexes)
+	_HB_RELEASE_LIST(HB_STADIUM_SECTION_SEGMENTS, segments)
+	_HB_RELEASE_LIST(HB_STADIUM_SECTION_GOALS, goals)
+	_HB_RELEASE_LIST(HB_STADIUM_SECTION_DISCS, discs)
+	_HB_RELEASE_LIST(HB_STADIUM_SECTION_PLANES, planes)
+	_HB_RELEASE_LIST(HB_STADIUM_SECTION_JOINTS, joints)
+	_HB_RELEASE_LIST(HB_STADIUM_SECTION_RED_SPAWN_POINTS, red_spawn_points)
+	_HB_RELEASE_LIST(HB_STADIUM_SECTION_BLUE_SPAWN_POINTS, blue_spawn_points)
+
+#undef _HB_RELEASE_LIST
+}
+
+static void
+_hb_stadium_drop_tessellations(struct hb_stadium *s)
+{
+	struct hb_tessellation *t, *next;
+
+	for (t = s->tessellation; t; t = next) {
+		next = t->next;
+		free(t);
+	}
+
+	s->tessellation = NULL;
 }
 
 extern void
 hb_stadium_free(struct hb_stadium *s)
 {
-	free(s->name);
-	free(s->bg);
-
-	hb_stadium_traits_foreach(s, trait) {
-		free(trait->name);
-		free(trait);
-	}
-
-	hb_stadium_vertexes_foreach(s, vertex) free(vertex);
-	hb_stadium_segments_foreach(s, segment) free(segment);
-	hb_stadium_goals_foreach(s, goal) free(goal);
-	hb_stadium_discs_foreach(s, disc) free(disc);
-	hb_stadium_planes_foreach(s, plane) free(plane);
-	hb_stadium_joints_foreach(s, joint) free(joint);
-	hb_stadium_red_spawn_points_foreach(s, point) free(point);
-	hb_stadium_blue_spawn_points_foreach(s, point) free(point);
-
-	free(s->traits);
-	free(s->vertexes);
-	free(s->segments);
-	free(s->goals);
-	free(s->discs);
-	free(s->planes);
-	free(s->joints);
-	free(s->red_spawn_points);
-	free(s->blue_spawn_points);
-	free(s->player_physics);
+	_hb_stadium_release(s, HB_STADIUM_SECTION_ALL);
+	_hb_stadium_drop_tessellations(s);
 	free(s);
 }
+
+extern void
+hb_stadium_invalidate(struct hb_stadium *s)
+{
+	_hb_stadium_drop_tessellations(s);
+	++s->version;
+}
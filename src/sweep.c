@@ -0,0 +1,164 @@
+#include <hb/sweep.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int
+_hb_sweep_grow(void **array, size_t size, size_t capacity)
+{
+	void *p;
+	if (NULL == (p = realloc(*array, size * capacity)))
+		return -1;
+	*array = p;
+	return 0;
+}
+
+static int
+_hb_sweep_reserve(struct hb_sweep *sp, size_t n)
+{
+	size_t capacity;
+
+	if (n <= sp->capacity)
+		return 0;
+
+	capacity = sp->capacity ? sp->capacity : 16;
+	while (capacity < n)
+		capacity *= 2;
+
+	if (_hb_sweep_grow((void **)&sp->order, sizeof(uint32_t), capacity) < 0 ||
+			_hb_sweep_grow((void **)&sp->key, sizeof(double), capacity) < 0 ||
+			_hb_sweep_grow((void **)&sp->start, sizeof(size_t), capacity + 1) < 0)
+		return -1;
+
+	sp->capacity = capacity;
+
+	return 0;
+}
+
+static int
+_hb_sweep_push(struct hb_sweep *sp, uint32_t a, uint32_t b)
+{
+	size_t capacity;
+
+	if (sp->pairs_count == sp->pairs_capacity) {
+		capacity = sp->pairs_capacity ? sp->pairs_capacity * 2 : 64;
+		if (_hb_sweep_grow((void **)&sp->pair_a, sizeof(uint32_t), capacity) < 0 ||
+				_hb_sweep_grow((void **)&sp->pair_b, sizeof(uint32_t), capacity) < 0 ||
+				_hb_sweep_grow((void **)&sp->partner, sizeof(uint32_t), capacity) < 0)
+			return -1;
+		sp->pairs_capacity = capacity;
+	}
+
+	sp->pair_a[sp->pairs_count] = a < b ? a : b;
+	sp->pair_b[sp->pairs_count] = a < b ? b : a;
+	++sp->pairs_count;
+
+	return 0;
+}
+
+extern struct hb_sweep *
+hb_sweep_create(void)
+{
+	return calloc(1, sizeof(struct hb_sweep));
+}
+
+extern void
+hb_sweep_free(struct hb_sweep *sp)
+{
+	if (!sp)
+		return;
+	free(sp->order);
+	free(sp->key);
+	free(sp->pair_a);
+	free(sp->pair_b);
+	free(sp->start);
+	free(sp->partner);
+	free(sp);
+}
+
+/* ties go by index so the order does not depend on the history */
+#define _hb_sweep_before(sp,a,b) \
+	((sp)->key[a] < (sp)->key[b] || ((sp)->key[a] == (sp)->key[b] && (a) < (b)))
+
+extern int
+hb_sweep_update(struct hb_sweep *sp, size_t n, const double *x, const double *y,
+		const double *radius, const uint32_t *c_class,
+		const struct hb_collision_table *t, double margin)
+{
+	size_t i, j, k;
+	uint32_t d, e;
+	double hi;
+
+	if (n > UINT32_MAX || _hb_sweep_reserve(sp, n) < 0)
+		return -1;
+
+	/////////////membership
+	if (n != sp->count) {
+		for (i = j = 0; i < sp->count; ++i)
+			if (sp->order[i] < n)
+				sp->order[j++] = sp->order[i];
+		for (i = sp->count; i < n; ++i)
+			sp->order[j++] = i;
+		sp->count = n;
+	}
+
+	/////////////sort
+	for (i = 0; i < n; ++i)
+		sp->key[i] = x[i] - radius[i] - margin;
+
+	/* next to nothing moves when the discs barely did */
+	for (i = 1; i < n; ++i) {
+		d = sp->order[i];
+		for (j = i; j > 0 && _hb_sweep_before(sp, d, sp->order[j - 1]); --j)
+			sp->order[j] = sp->order[j - 1];
+		sp->order[j] = d;
+	}
+
+	/////////////sweep
+	sp->pairs_count = 0;
+
+	for (i = 0; i < n; ++i) {
+		d = sp->order[i];
+		hi = x[d] + radius[d] + margin;
+		for (j = i + 1; j < n && sp->key[sp->order[j]] <= hi; ++j) {
+			e = sp->order[j];
+			if (y[d] - y[e] > radius[d] + radius[e] + 2 * margin ||
+					y[e] - y[d] > radius[d] + radius[e] + 2 * margin)
+				continue;
+			if (!hb_collision_table_test(t, c_class[d], c_class[e]))
+				continue;
+			if (_hb_sweep_push(sp, d, e) < 0)
+				return -1;
+		}
+	}
+
+	/////////////partners
+	memset(sp->start, 0, (n + 1) * sizeof(size_t));
+
+	for (k = 0; k < sp->pairs_count; ++k)
+		++sp->start[sp->pair_a[k] + 1];
+
+	for (i = 0; i < n; ++i)
+		sp->start[i + 1] += sp->start[i];
+
+	/* start[a] runs ahead while filling and is put back after */
+	for (k = 0; k < sp->pairs_count; ++k)
+		sp->partner[sp->start[sp->pair_a[k]]++] = sp->pair_b[k];
+
+	for (i = n; i > 0; --i)
+		sp->start[i] = sp->start[i - 1];
+	sp->start[0] = 0;
+
+	for (i = 0; i < n; ++i) {
+		for (k = sp->start[i] + 1; k < sp->start[i + 1]; ++k) {
+			e = sp->partner[k];
+			for (j = k; j > sp->start[i] && sp->partner[j - 1] > e; --j)
+				sp->partner[j] = sp->partner[j - 1];
+			sp->partner[j] = e;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,169 @@
+#include <hb/tessellation.h>
+#include <hb/stadium.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+#define _HB_TESSELLATION_ALIGN(n) (((n) + 15) & ~(size_t)15)
+
+/* same bounds hb_stadium_compile uses to tell arcs from straight lines */
+#define _HB_TESSELLATION_MIN_CURVE (10.0 * M_PI / 180.0)
+#define _HB_TESSELLATION_MAX_CURVE (340.0 * M_PI / 180.0)
+
+/* keeps a tiny max_error from asking for millions of points */
+#define _HB_TESSELLATION_MAX_STEPS 1024
+
+static size_t
+_hb_tessellation_count(void *const *list)
+{
+	size_t count;
+	count = 0;
+	if (list)
+		while (list[count])
+			++count;
+	return count;
+}
+
+/* the number of chords an arc is split into, 0 for straight segments */
+static size_t
+_hb_tessellation_steps(const struct hb_stadium *s, const struct hb_segment *segm,
+		double max_error)
+{
+	const struct hb_vertex *a, *b;
+	double curve, chord, r, step;
+	size_t steps;
+
+	curve = fabs(segm->curve) * (M_PI / 180.0);
+	if (!(curve > _HB_TESSELLATION_MIN_CURVE && curve < _HB_TESSELLATION_MAX_CURVE))
+		return 0;
+
+	a = s->vertexes[segm->v0];
+	b = s->vertexes[segm->v1];
+	chord = hypot(b->x - a->x, b->y - a->y);
+	if (chord == 0)
+		return 0;
+
+	/* a chord spanning step strays r (1 - cos(step / 2)) from the arc */
+	r = chord / (2 * sin(curve / 2));
+	step = max_error >= 2 * r ? M_PI : 2 * acos(1 - max_error / r);
+	steps = step > 0 ? (size_t)ceil(curve / step) : _HB_TESSELLATION_MAX_STEPS;
+
+	if (steps < 1) steps = 1;
+	if (steps > _HB_TESSELLATION_MAX_STEPS) steps = _HB_TESSELLATION_MAX_STEPS;
+
+	return steps;
+}
+
+static void
+_hb_tessellation_fill(const struct hb_stadium *s, const struct hb_segment *segm,
+		size_t steps, double *x, double *y)
+{
+	const struct hb_vertex *a, *b;
+	double curve, cot, c, d, cx, cy, r, start;
+	size_t i;
+
+	a = s->vertexes[segm->v0];
+	b = s->vertexes[segm->v1];
+
+	if (steps > 1) {
+		/* the center formula holds for negative curves as they are */
+		curve = segm->curve * (M_PI / 180.0);
+		cot = 1 / tan(curve / 2);
+		c = 0.5 * (b->x - a->x);
+		d = 0.5 * (b->y - a->y);
+		cx = a->x + c - d * cot;
+		cy = a->y + d + c * cot;
+		r = hypot(a->x - cx, a->y - cy);
+		start = atan2(a->y - cy, a->x - cx);
+		for (i = 1; i < steps; ++i) {
+			x[i] = cx + r * cos(start + curve * i / steps);
+			y[i] = cy + r * sin(start + curve * i / steps);
+		}
+	}
+
+	/* the ends are exact so neighbouring polylines meet */
+	x[0] = a->x;
+	y[0] = a->y;
+	x[steps] = b->x;
+	y[steps] = b->y;
+}
+
+extern const struct hb_tessellation *
+hb_stadium_tessellate(struct hb_stadium *s, double max_error)
+{
+	struct hb_tessellation *t;
+	struct hb_tessellation **link;
+	unsigned char *block;
+	size_t ns, points, i, size, *steps;
+
+	if (!(max_error > 0))
+		return NULL;
+
+	/* the list runs from the most recently used, a hit goes first */
+	for (link = &s->tessellation; (t = *link); link = &t->next) {
+		if (t->max_error == max_error) {
+			*link = t->next;
+			t->next = s->tessellation;
+			s->tessellation = t;
+			return t;
+		}
+	}
+
+	ns = _hb_tessellation_count((void *const *)s->segments);
+
+	if (NULL == (steps = malloc((ns + 1) * sizeof(*steps))))
+		return NULL;
+
+	for (i = 0, points = 0; i < ns; ++i) {
+		steps[i] = _hb_tessellation_steps(s, s->segments[i], max_error);
+		if (steps[i] == 0)
+			steps[i] = 1;
+		points += steps[i] + 1;
+	}
+
+	size = _HB_TESSELLATION_ALIGN(sizeof(*t));
+	size = _HB_TESSELLATION_ALIGN(size + ns * sizeof(size_t));
+	size = _HB_TESSELLATION_ALIGN(size + ns * sizeof(size_t));
+	size = _HB_TESSELLATION_ALIGN(size + points * sizeof(double));
+	size += points * sizeof(double);
+
+	if (NULL == (block = malloc(size))) {
+		free(steps);
+		return NULL;
+	}
+
+	t = (struct hb_tessellation *)block;
+	t->max_error = max_error;
+	t->segments_count = ns;
+	t->points_count = points;
+	size = _HB_TESSELLATION_ALIGN(sizeof(*t));
+	t->offset = (size_t *)(block + size);
+	size = _HB_TESSELLATION_ALIGN(size + ns * sizeof(size_t));
+	t->count = (size_t *)(block + size);
+	size = _HB_TESSELLATION_ALIGN(size + ns * sizeof(size_t));
+	t->x = (double *)(block + size);
+	size = _HB_TESSELLATION_ALIGN(size + points * sizeof(double));
+	t->y = (double *)(block + size);
+
+	for (i = 0, points = 0; i < ns; ++i) {
+		t->offset[i] = points;
+		t->count[i] = steps[i] + 1;
+		_hb_tessellation_fill(s, s->segments[i], steps[i],
+				t->x + points, t->y + points);
+		points += t->count[i];
+	}
+
+	free(steps);
+	t->next = s->tessellation;
+	s->tessellation = t;
+
+	/* the least recently used one past the limit goes */
+	for (i = 1, link = &t->next; *link && i < HB_TESSELLATION_CACHE; ++i)
+		link = &(*link)->next;
+	if (*link) {
+		free(*link);
+		*link = NULL;
+	}
+
+	return t;
+}
@@ -0,0 +1,149 @@
+#include <hb/stadium.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+static int
+_hb_trait_set(struct hb_trait *t, enum hb_trait_field field, double value)
+{
+	switch (field) {
+	case HB_TRAIT_FIELD_CURVE:
+		t->has_curve = true;
+		t->curve = value;
+		return 0;
+	case HB_TRAIT_FIELD_DAMPING:
+		t->has_damping = true;
+		t->damping = value;
+		return 0;
+	case HB_TRAIT_FIELD_INV_MASS:
+		t->has_inv_mass = true;
+		t->inv_mass = value;
+		return 0;
+	case HB_TRAIT_FIELD_RADIUS:
+		t->has_radius = true;
+		t->radius = value;
+		return 0;
+	case HB_TRAIT_FIELD_B_COEF:
+		t->has_b_coef = true;
+		t->b_coef = value;
+		return 0;
+	case HB_TRAIT_FIELD_COLOR:
+		t->has_color = true;
+		t->color = (uint32_t)value;
+		return 0;
+	case HB_TRAIT_FIELD_VIS:
+		t->has_vis = true;
+		t->vis = value != 0;
+		return 0;
+	case HB_TRAIT_FIELD_C_GROUP:
+		t->has_c_group = true;
+		t->c_group = (enum hb_collision_flags)(int)value;
+		return 0;
+	case HB_TRAIT_FIELD_C_MASK:
+		t->has_c_mask = true;
+		t->c_mask = (enum hb_collision_flags)(int)value;
+		return 0;
+	}
+	return -1;
+}
+
+/* only the fields the parser takes from a trait for each kind */
+static void
+_hb_trait_apply_vertex(struct hb_vertex *v, const struct hb_trait *t,
+		enum hb_trait_field field)
+{
+	switch (field) {
+	case HB_TRAIT_FIELD_B_COEF: v->b_coef = t->b_coef; break;
+	case HB_TRAIT_FIELD_C_GROUP: v->c_group = t->c_group; break;
+	case HB_TRAIT_FIELD_C_MASK: v->c_mask = t->c_mask; break;
+	default: break;
+	}
+}
+
+static void
+_hb_trait_apply_segment(struct hb_segment *seg, const struct hb_trait *t,
+		enum hb_trait_field field)
+{
+	switch (field) {
+	case HB_TRAIT_FIELD_B_COEF: seg->b_coef = t->b_coef; break;
+	case HB_TRAIT_FIELD_C_GROUP: seg->c_group = t->c_group; break;
+	case HB_TRAIT_FIELD_C_MASK: seg->c_mask = t->c_mask; break;
+	case HB_TRAIT_FIELD_VIS: seg->vis = t->vis; break;
+	case HB_TRAIT_FIELD_COLOR: seg->color = t->color; break;
+	default: break;
+	}
+}
+
+static void
+_hb_trait_apply_disc(struct hb_disc *d, const struct hb_trait *t,
+		enum hb_trait_field field)
+{
+	switch (field) {
+	case HB_TRAIT_FIELD_RADIUS: d->radius = t->radius; break;
+	case HB_TRAIT_FIELD_INV_MASS: d->inv_mass = t->inv_mass; break;
+	case HB_TRAIT_FIELD_COLOR: d->color = t->color; break;
+	case HB_TRAIT_FIELD_B_COEF: d->b_coef = t->b_coef; break;
+	case HB_TRAIT_FIELD_C_MASK: d->c_mask = t->c_mask; break;
+	case HB_TRAIT_FIELD_C_GROUP: d->c_group = t->c_group; break;
+	default: break;
+	}
+}
+
+static void
+_hb_trait_apply_plane(struct hb_plane *p, const struct hb_trait *t,
+		enum hb_trait_field field)
+{
+	switch (field) {
+	case HB_TRAIT_FIELD_B_COEF: p->b_coef = t->b_coef; break;
+	case HB_TRAIT_FIELD_C_MASK: p->c_mask = t->c_mask; break;
+	case HB_TRAIT_FIELD_C_GROUP: p->c_group = t->c_group; break;
+	default: break;
+	}
+}
+
+extern int
+hb_stadium_set_trait_field(struct hb_stadium *s, const char *name,
+		enum hb_trait_field field, double value)
+{
+	struct hb_trait *t;
+	size_t i;
+
+	if (!s->traits)
+		return -1;
+
+	for (i = 0; s->traits[i]; ++i)
+		if (!strcmp(s->traits[i]->name, name))
+			break;
+
+	if (!s->traits[i])
+		return -1;
+
+	if (hb_stadium_unshare(s, HB_STADIUM_SECTION_TRAITS) < 0)
+		return -1;
+
+	t = s->traits[i];
+
+	if (_hb_trait_set(t, field, value) < 0)
+		return -1;
+
+	hb_stadium_vertexes_foreach(s, vertex)
+		if (vertex->trait == t && !(vertex->overrides & field))
+			_hb_trait_apply_vertex(vertex, t, field);
+
+	hb_stadium_segments_foreach(s, segment)
+		if (segment->trait == t && !(segment->overrides & field))
+			_hb_trait_apply_segment(segment, t, field);
+
+	hb_stadium_discs_foreach(s, disc)
+		if (disc->trait == t && !(disc->overrides & field))
+			_hb_trait_apply_disc(disc, t, field);
+
+	hb_stadium_planes_foreach(s, plane)
+		if (plane->trait == t && !(plane->overrides & field))
+			_hb_trait_apply_plane(plane, t, field);
+
+	hb_stadium_invalidate(s);
+
+	return 0;
+}
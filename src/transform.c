@@ -0,0 +1,172 @@
+#include <hb/stadium.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+struct _hb_transform {
+	double                             m[6];
+	double                            scale;
+	bool                           diagonal;
+	bool                            reflect;
+};
+
+static void
+_hb_transform_point(const struct _hb_transform *t, double *x, double *y)
+{
+	double px;
+	if (t->diagonal) {
+		*x = t->m[0] * *x + t->m[2];
+		*y = t->m[4] * *y + t->m[5];
+		return;
+	}
+	px = *x;
+	*x = t->m[0] * px + t->m[1] * *y + t->m[2];
+	*y = t->m[3] * px + t->m[4] * *y + t->m[5];
+}
+
+/* directions only take the linear part */
+static void
+_hb_transform_vector(const struct _hb_transform *t, double v[2])
+{
+	double vx;
+	vx = v[0];
+	v[0] = t->m[0] * vx + t->m[1] * v[1];
+	v[1] = t->m[3] * vx + t->m[4] * v[1];
+}
+
+/* the axis aligned extents of a box of half sizes w and h */
+static void
+_hb_transform_extents(const struct _hb_transform *t, double *w, double *h)
+{
+	double pw;
+	pw = *w;
+	*w = fabs(t->m[0]) * pw + fabs(t->m[1]) * *h;
+	*h = fabs(t->m[3]) * pw + fabs(t->m[4]) * *h;
+}
+
+/* normals go through the inverse transpose. the game measures dist
+   along the normal once it is made unit length, so it is kept that way */
+static void
+_hb_transform_plane(const struct _hb_transform *t, double det,
+		struct hb_plane *plane)
+{
+	double nx, ny, len;
+
+	len = sqrt(plane->normal[0] * plane->normal[0] +
+			plane->normal[1] * plane->normal[1]);
+	if (len == 0)
+		return;
+
+	nx = (t->m[4] * plane->normal[0] - t->m[3] * plane->normal[1]) / (det * len);
+	ny = (t->m[0] * plane->normal[1] - t->m[1] * plane->normal[0]) / (det * len);
+	plane->dist += nx * t->m[2] + ny * t->m[5];
+	len = sqrt(nx * nx + ny * ny);
+	plane->normal[0] = nx / len;
+	plane->normal[1] = ny / len;
+	plane->dist /= len;
+}
+
+static void
+_hb_transform_disc(const struct _hb_transform *t, struct hb_disc *disc)
+{
+	_hb_transform_point(t, &disc->pos[0], &disc->pos[1]);
+	_hb_transform_vector(t, disc->speed);
+	_hb_transform_vector(t, disc->gravity);
+	disc->radius *= t->scale;
+}
+
+extern int
+hb_stadium_transform(struct hb_stadium *s, const double m[6])
+{
+	struct _hb_transform t;
+	double det;
+	size_t i;
+
+	det = m[0] * m[4] - m[1] * m[3];
+	if (det == 0 || !isfinite(det))
+		return -1;
+
+	for (i = 0; i < 6; ++i)
+		t.m[i] = m[i];
+	t.scale = sqrt(fabs(det));
+	t.diagonal = m[1] == 0 && m[3] == 0;
+	t.reflect = det < 0;
+
+	if (hb_stadium_unshare(s, HB_STADIUM_SECTION_ALL & ~HB_STADIUM_SECTION_NAME) < 0)
+		return -1;
+
+	/////////////dimensions
+	_hb_transform_extents(&t, &s->width, &s->height);
+	_hb_transform_extents(&t, &s->camera_width, &s->camera_height);
+	s->max_view_width *= t.scale;
+	s->spawn_distance *= t.scale;
+
+	if (s->bg) {
+		_hb_transform_extents(&t, &s->bg->width, &s->bg->height);
+		s->bg->kick_off_radius *= t.scale;
+		s->bg->corner_radius *= t.scale;
+		s->bg->goal_line *= t.scale;
+	}
+
+	if (s->player_physics) {
+		_hb_transform_vector(&t, s->player_physics->gravity);
+		s->player_physics->radius *= t.scale;
+	}
+
+	/////////////traits
+	hb_stadium_traits_foreach(s, trait) {
+		trait->radius *= t.scale;
+		if (t.reflect)
+			trait->curve = -trait->curve;
+	}
+
+	/////////////vertexes
+	hb_stadium_vertexes_foreach(s, vertex)
+		_hb_transform_point(&t, &vertex->x, &vertex->y);
+
+	/////////////segments
+	/* a mirror moves the left side of every segment to its right */
+	hb_stadium_segments_foreach(s, segment) {
+		segment->bias *= t.reflect ? -t.scale : t.scale;
+		if (t.reflect)
+			segment->curve = -segment->curve;
+	}
+
+	/////////////goals
+	hb_stadium_goals_foreach(s, goal) {
+		_hb_transform_point(&t, &goal->p0[0], &goal->p0[1]);
+		_hb_transform_point(&t, &goal->p1[0], &goal->p1[1]);
+	}
+
+	/////////////discs
+	hb_stadium_discs_foreach(s, disc)
+		_hb_transform_disc(&t, disc);
+
+	if (s->ball_physics && (!s->discs || s->ball_physics != s->discs[0]))
+		_hb_transform_disc(&t, s->ball_physics);
+
+	/////////////planes
+	hb_stadium_planes_foreach(s, plane)
+		_hb_transform_plane(&t, det, plane);
+
+	/////////////joints
+	hb_stadium_joints_foreach(s, joint) {
+		if (joint->length.kind == HB_JOINT_LENGTH_FIXED) {
+			joint->length.val.f *= t.scale;
+		} else if (joint->length.kind == HB_JOINT_LENGTH_RANGE) {
+			joint->length.val.range[0] *= t.scale;
+			joint->length.val.range[1] *= t.scale;
+		}
+	}
+
+	/////////////spawn points
+	hb_stadium_red_spawn_points_foreach(s, point)
+		_hb_transform_point(&t, &point->x, &point->y);
+
+	hb_stadium_blue_spawn_points_foreach(s, point)
+		_hb_transform_point(&t, &point->x, &point->y);
+
+	hb_stadium_invalidate(s);
+
+	return 0;
+}
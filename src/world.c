@@ -0,0 +1,1048 @@
+#include <hb/world.h>
+#include <hb/ccd.h>
+#include <hb/collision_table.h>
+#include <hb/geometry.h>
+#include <hb/grid.h>
+#include <hb/joints.h>
+#include <hb/narrowphase.h>
+#include <hb/stadium.h>
+#include <hb/sweep.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* how close a kickable disc has to be to the edge of a player */
+#define _HB_WORLD_KICK_REACH 4.0
+
+/* grid cells are at least this wide, and four times the widest disc */
+#define _HB_WORLD_MIN_CELL_SIZE 32.0
+
+/* how far a disc may be pushed from where the sweep saw it before the
+   pairs it found can no longer be trusted for the rest of the step */
+#define _HB_WORLD_SWEEP_MARGIN 2.0
+
+/* walls a fast disc bounces off in one tick before the rest of its way
+   is taken as is */
+#define _HB_WORLD_CCD_BOUNCES 4
+
+/* the mask every player disc gets */
+#define _HB_WORLD_PLAYER_C_MASK \
+	(HB_COLLISION_BALL | HB_COLLISION_RED | HB_COLLISION_BLUE | HB_COLLISION_WALL)
+
+static size_t
+_hb_world_count(void *const *list)
+{
+	size_t count;
+	count = 0;
+	if (list)
+		while (list[count])
+			++count;
+	return count;
+}
+
+static int
+_hb_world_grow(void **array, size_t size, size_t capacity)
+{
+	void *p;
+	if (NULL == (p = realloc(*array, size * capacity)))
+		return -1;
+	*array = p;
+	return 0;
+}
+
+/* arrays that were already grown stay that way when one of them fails */
+static int
+_hb_world_reserve(struct hb_world *w, size_t capacity)
+{
+	if (capacity <= w->discs_capacity)
+		return 0;
+
+	if (_hb_world_grow((void **)&w->x, sizeof(double), capacity) < 0 ||
+			_hb_world_grow((void **)&w->y, sizeof(double), capacity) < 0 ||
+			_hb_world_grow((void **)&w->speed_x, sizeof(double), capacity) < 0 ||
+			_hb_world_grow((void **)&w->speed_y, sizeof(double), capacity) < 0 ||
+			_hb_world_grow((void **)&w->gravity_x, sizeof(double), capacity) < 0 ||
+			_hb_world_grow((void **)&w->gravity_y, sizeof(double), capacity) < 0 ||
+			_hb_world_grow((void **)&w->radius, sizeof(double), capacity) < 0 ||
+			_hb_world_grow((void **)&w->inv_mass, sizeof(double), capacity) < 0 ||
+			_hb_world_grow((void **)&w->damping, sizeof(double), capacity) < 0 ||
+			_hb_world_grow((void **)&w->b_coef, sizeof(double), capacity) < 0 ||
+			_hb_world_grow((void **)&w->c_group, sizeof(enum hb_collision_flags), capacity) < 0 ||
+			_hb_world_grow((void **)&w->c_mask, sizeof(enum hb_collision_flags), capacity) < 0 ||
+			_hb_world_grow((void **)&w->c_class, sizeof(uint32_t), capacity) < 0 ||
+			_hb_world_grow((void **)&w->team, sizeof(enum hb_team), capacity) < 0 ||
+			_hb_world_grow((void **)&w->input, sizeof(unsigned), capacity) < 0 ||
+			_hb_world_grow((void **)&w->kick_armed, sizeof(bool), capacity) < 0 ||
+			_hb_world_grow((void **)&w->sweep_x, sizeof(double), capacity) < 0 ||
+			_hb_world_grow((void **)&w->sweep_y, sizeof(double), capacity) < 0)
+		return -1;
+
+	w->discs_capacity = capacity;
+
+	return 0;
+}
+
+static void
+_hb_world_set_disc(struct hb_world *w, size_t i, const struct hb_disc *disc)
+{
+	w->x[i] = disc->pos[0];
+	w->y[i] = disc->pos[1];
+	w->speed_x[i] = disc->speed[0];
+	w->speed_y[i] = disc->speed[1];
+	w->gravity_x[i] = disc->gravity[0];
+	w->gravity_y[i] = disc->gravity[1];
+	w->radius[i] = disc->radius;
+	w->inv_mass[i] = disc->inv_mass;
+	w->damping[i] = disc->damping;
+	w->b_coef[i] = disc->b_coef;
+	w->c_group[i] = disc->c_group;
+	w->c_mask[i] = disc->c_mask;
+}
+
+static void
+_hb_world_copy_disc(struct hb_world *w, size_t to, size_t from)
+{
+	w->x[to] = w->x[from];
+	w->y[to] = w->y[from];
+	w->speed_x[to] = w->speed_x[from];
+	w->speed_y[to] = w->speed_y[from];
+	w->gravity_x[to] = w->gravity_x[from];
+	w->gravity_y[to] = w->gravity_y[from];
+	w->radius[to] = w->radius[from];
+	w->inv_mass[to] = w->inv_mass[from];
+	w->damping[to] = w->damping[from];
+	w->b_coef[to] = w->b_coef[from];
+	w->c_group[to] = w->c_group[from];
+	w->c_mask[to] = w->c_mask[from];
+	w->c_class[to] = w->c_class[from];
+}
+
+static int
+_hb_world_load_goals(struct hb_world *w, const struct hb_stadium *s)
+{
+	size_t count, i;
+
+	count = _hb_world_count((void *const *)s->goals);
+
+	if (NULL == (w->goal_p0x = malloc((count + 1) * sizeof(double))) ||
+			NULL == (w->goal_p0y = malloc((count + 1) * sizeof(double))) ||
+			NULL == (w->goal_p1x = malloc((count + 1) * sizeof(double))) ||
+			NULL == (w->goal_p1y = malloc((count + 1) * sizeof(double))) ||
+			NULL == (w->goal_team = malloc((count + 1) * sizeof(enum hb_team))))
+		return -1;
+
+	for (i = 0; i < count; ++i) {
+		w->goal_p0x[i] = s->goals[i]->p0[0];
+		w->goal_p0y[i] = s->goals[i]->p0[1];
+		w->goal_p1x[i] = s->goals[i]->p1[0];
+		w->goal_p1y[i] = s->goals[i]->p1[1];
+		w->goal_team[i] = s->goals[i]->team;
+	}
+
+	w->goals_count = count;
+
+	return 0;
+}
+
+static enum hb_collision_flags
+_hb_world_player_c_group(const struct hb_world *w, enum hb_team team)
+{
+	return w->player_physics.c_group |
+		(team == HB_TEAM_RED ? HB_COLLISION_RED : HB_COLLISION_BLUE);
+}
+
+/* sorts discs and walls into classes, the players that may join later
+   included, and drops the walls none of them collide with */
+static int
+_hb_world_load_classes(struct hb_world *w)
+{
+	uint32_t *classes;
+	long c;
+	size_t i, k, n;
+
+	if (NULL == (w->classes = hb_collision_table_create()) ||
+			hb_geometry_classify(w->geometry, w->classes) < 0 ||
+			NULL == (classes = malloc((w->discs_count + 2) * sizeof(uint32_t))))
+		return -1;
+
+	for (i = n = 0; i < w->discs_count + 2; ++i) {
+		if (i < w->discs_count)
+			c = hb_collision_table_add(w->classes, w->c_group[i], w->c_mask[i]);
+		else
+			c = hb_collision_table_add(w->classes,
+					_hb_world_player_c_group(w, i == w->discs_count ?
+						HB_TEAM_RED : HB_TEAM_BLUE),
+					_HB_WORLD_PLAYER_C_MASK);
+		if (c < 0) {
+			free(classes);
+			return -1;
+		}
+		if (i < w->discs_count)
+			w->c_class[i] = c;
+		for (k = 0; k < n && classes[k] != (uint32_t)c; ++k)
+			;
+		if (k == n)
+			classes[n++] = c;
+	}
+
+	hb_geometry_drop_unreachable(w->geometry, w->classes, classes, n);
+	free(classes);
+
+	return 0;
+}
+
+static int
+_hb_world_load_grid(struct hb_world *w)
+{
+	double cell_size;
+	size_t i;
+
+	cell_size = 4 * w->player_physics.radius;
+	for (i = 0; i < w->discs_count; ++i)
+		if (4 * w->radius[i] > cell_size)
+			cell_size = 4 * w->radius[i];
+	if (!(cell_size > _HB_WORLD_MIN_CELL_SIZE))
+		cell_size = _HB_WORLD_MIN_CELL_SIZE;
+
+	if (NULL == (w->grid = hb_static_grid_from_geometry(w->geometry, cell_size)) ||
+			NULL == (w->segment_candidates = malloc((w->geometry->segments_count + 1) *
+					sizeof(uint32_t))) ||
+			NULL == (w->vertex_candidates = malloc((w->geometry->vertexes_count + 1) *
+					sizeof(uint32_t))))
+		return -1;
+
+	return 0;
+}
+
+extern struct hb_world *
+hb_world_create(const struct hb_stadium *s)
+{
+	struct hb_world *w;
+	size_t count, i;
+
+	if (NULL == (w = calloc(1, sizeof(*w))))
+		return NULL;
+
+	w->goal = -1;
+
+	if (s->player_physics)
+		w->player_physics = *s->player_physics;
+
+	count = _hb_world_count((void *const *)s->discs);
+
+	if (NULL == (w->geometry = hb_stadium_compile(s)) ||
+			_hb_world_reserve(w, count + 16) < 0)
+		goto err;
+
+	/* the parser always puts the ball first, keep a slot for it anyway */
+	if (count == 0 && s->ball_physics) {
+		_hb_world_set_disc(w, 0, s->ball_physics);
+		w->discs_count = 1;
+	}
+
+	for (i = 0; i < count; ++i)
+		_hb_world_set_disc(w, w->discs_count++, s->discs[i]);
+
+	if (NULL == (w->joints = hb_joints_build(s, w->x, w->y, w->discs_count)) ||
+			_hb_world_load_goals(w, s) < 0 ||
+			_hb_world_load_classes(w) < 0 ||
+			_hb_world_load_grid(w) < 0 ||
+			NULL == (w->sweep = hb_sweep_create()))
+		goto err;
+
+	return w;
+
+err:
+	hb_world_free(w);
+	return NULL;
+}
+
+extern void
+hb_world_free(struct hb_world *w)
+{
+	if (!w)
+		return;
+	hb_geometry_free(w->geometry);
+	hb_collision_table_free(w->classes);
+	hb_static_grid_free(w->grid);
+	free(w->segment_candidates);
+	free(w->vertex_candidates);
+	hb_sweep_free(w->sweep);
+	free(w->sweep_x);
+	free(w->sweep_y);
+	free(w->x);
+	free(w->y);
+	free(w->speed_x);
+	free(w->speed_y);
+	free(w->gravity_x);
+	free(w->gravity_y);
+	free(w->radius);
+	free(w->inv_mass);
+	free(w->damping);
+	free(w->b_coef);
+	free(w->c_group);
+	free(w->c_mask);
+	free(w->c_class);
+	free(w->team);
+	free(w->input);
+	free(w->kick_armed);
+	hb_joints_free(w->joints);
+	free(w->goal_p0x);
+	free(w->goal_p0y);
+	free(w->goal_p1x);
+	free(w->goal_p1y);
+	free(w->goal_team);
+	free(w);
+}
+
+extern long
+hb_world_add_player(struct hb_world *w, enum hb_team team, double x, double y)
+{
+	const struct hb_player_physics *pp;
+	size_t i, p;
+	long c;
+
+	if (team != HB_TEAM_RED && team != HB_TEAM_BLUE)
+		return -1;
+
+	if ((w->discs_count == w->discs_capacity &&
+				_hb_world_reserve(w, w->discs_capacity * 2) < 0) ||
+			(c = hb_collision_table_add(w->classes, _hb_world_player_c_group(w, team),
+				_HB_WORLD_PLAYER_C_MASK)) < 0)
+		return -1;
+
+	pp = &w->player_physics;
+	i = w->discs_count++;
+	p = w->players_count++;
+
+	w->x[i] = x;
+	w->y[i] = y;
+	w->speed_x[i] = w->speed_y[i] = 0;
+	w->gravity_x[i] = pp->gravity[0];
+	w->gravity_y[i] = pp->gravity[1];
+	w->radius[i] = pp->radius;
+	w->inv_mass[i] = pp->inv_mass;
+	w->damping[i] = pp->damping;
+	w->b_coef[i] = pp->b_coef;
+	w->c_group[i] = _hb_world_player_c_group(w, team);
+	w->c_mask[i] = _HB_WORLD_PLAYER_C_MASK;
+	w->c_class[i] = c;
+	w->team[p] = team;
+	w->input[p] = 0;
+	w->kick_armed[p] = true;
+
+	return p;
+}
+
+extern void
+hb_world_remove_player(struct hb_world *w, size_t player)
+{
+	size_t i, last;
+
+	if (player >= w->players_count)
+		return;
+
+	i = hb_world_player_disc(w, player);
+	last = w->discs_count - 1;
+
+	_hb_world_copy_disc(w, i, last);
+	w->team[player] = w->team[w->players_count - 1];
+	w->input[player] = w->input[w->players_count - 1];
+	w->kick_armed[player] = w->kick_armed[w->players_count - 1];
+
+	--w->discs_count;
+	--w->players_count;
+}
+
+/////////////players
+
+/* kicks every kickable disc within reach, the same push goes to the
+   kicked disc and back to the player, both scaled by inverse mass */
+static bool
+_hb_world_kick(struct hb_world *w, size_t d)
+{
+	double dx, dy, dist, strength, kickback;
+	bool kicked;
+	size_t j;
+
+	strength = w->player_physics.kick_strength;
+	kickback = w->player_physics.kickback;
+	kicked = false;
+
+	for (j = 0; j < w->discs_count; ++j) {
+		if (j == d || !(w->c_group[j] & HB_COLLISION_KICK))
+			continue;
+		dx = w->x[j] - w->x[d];
+		dy = w->y[j] - w->y[d];
+		dist = sqrt(dx * dx + dy * dy);
+		if (dist == 0 || dist - w->radius[d] - w->radius[j] >= _HB_WORLD_KICK_REACH)
+			continue;
+		dx /= dist;
+		dy /= dist;
+		w->speed_x[j] += dx * strength * w->inv_mass[j];
+		w->speed_y[j] += dy * strength * w->inv_mass[j];
+		w->speed_x[d] -= dx * kickback * w->inv_mass[d];
+		w->speed_y[d] -= dy * kickback * w->inv_mass[d];
+		kicked = true;
+	}
+
+	return kicked;
+}
+
+static unsigned
+_hb_world_players(struct hb_world *w, const unsigned *inputs)
+{
+	const struct hb_player_physics *pp;
+	double dx, dy, len, acceleration;
+	unsigned input, events;
+	bool kicking;
+	size_t p, d;
+
+	pp = &w->player_physics;
+	events = 0;
+
+	for (p = 0; p < w->players_count; ++p) {
+		d = hb_world_player_disc(w, p);
+		input = inputs ? inputs[p] : 0;
+		kicking = (input & HB_INPUT_KICK) != 0;
+
+		/* holding kick kicks once, on contact, until it is let go */
+		if (!kicking) {
+			w->kick_armed[p] = true;
+		} else if (w->kick_armed[p] && _hb_world_kick(w, d)) {
+			w->kick_armed[p] = false;
+			events |= HB_WORLD_EVENT_KICK;
+		}
+
+		dx = dy = 0;
+		if (input & HB_INPUT_UP) --dy;
+		if (input & HB_INPUT_DOWN) ++dy;
+		if (input & HB_INPUT_LEFT) --dx;
+		if (input & HB_INPUT_RIGHT) ++dx;
+
+		if (dx != 0 || dy != 0) {
+			len = sqrt(dx * dx + dy * dy);
+			acceleration = kicking ? pp->kicking_acceleration : pp->acceleration;
+			w->speed_x[d] += dx / len * acceleration;
+			w->speed_y[d] += dy / len * acceleration;
+		}
+
+		w->damping[d] = kicking ? pp->kicking_damping : pp->damping;
+		w->input[p] = input;
+	}
+
+	return events;
+}
+
+/////////////collisions
+
+static void
+_hb_world_collide_discs(struct hb_world *w, size_t a, size_t b)
+{
+	double dx, dy, dist, sum, share, pen, move, v;
+
+	dx = w->x[a] - w->x[b];
+	dy = w->y[a] - w->y[b];
+	dist = dx * dx + dy * dy;
+	sum = w->radius[a] + w->radius[b];
+
+	if (!(dist > 0 && dist <= sum * sum))
+		return;
+
+	/* two immovable discs have nothing to resolve */
+	if (w->inv_mass[a] + w->inv_mass[b] == 0)
+		return;
+
+	dist = sqrt(dist);
+	dx /= dist;
+	dy /= dist;
+	share = w->inv_mass[a] / (w->inv_mass[a] + w->inv_mass[b]);
+
+	pen = sum - dist;
+	move = pen * share;
+	w->x[a] += dx * move;
+	w->y[a] += dy * move;
+	move = pen - move;
+	w->x[b] -= dx * move;
+	w->y[b] -= dy * move;
+
+	v = dx * (w->speed_x[a] - w->speed_x[b]) + dy * (w->speed_y[a] - w->speed_y[b]);
+	if (v < 0) {
+		v *= w->b_coef[a] * w->b_coef[b] + 1;
+		w->speed_x[a] -= dx * v * share;
+		w->speed_y[a] -= dy * v * share;
+		w->speed_x[b] += dx * v * (1 - share);
+		w->speed_y[b] += dy * v * (1 - share);
+	}
+}
+
+/* pushes disc i out along n and takes away the speed going into it */
+static void
+_hb_world_resolve(struct hb_world *w, size_t i, double nx, double ny,
+		double pen, double b_coef)
+{
+	double v;
+
+	w->x[i] += nx * pen;
+	w->y[i] += ny * pen;
+
+	v = nx * w->speed_x[i] + ny * w->speed_y[i];
+	if (v < 0) {
+		v *= w->b_coef[i] * b_coef + 1;
+		w->speed_x[i] -= nx * v;
+		w->speed_y[i] -= ny * v;
+	}
+}
+
+static void
+_hb_world_collide_plane(struct hb_world *w, size_t i, size_t k)
+{
+	const struct hb_geometry *g;
+	double pen;
+
+	g = w->geometry;
+	pen = g->plane_dist[k] - (g->plane_normal_x[k] * w->x[i] +
+			g->plane_normal_y[k] * w->y[i]) + w->radius[i];
+
+	if (pen > 0)
+		_hb_world_resolve(w, i, g->plane_normal_x[k], g->plane_normal_y[k],
+				pen, g->plane_b_coef[k]);
+}
+
+static void
+_hb_world_collide_segment(struct hb_world *w, size_t i, size_t k)
+{
+	const struct hb_geometry *g;
+	double dx, dy, ex, ey, nx, ny, dist, len, bias;
+
+	g = w->geometry;
+
+	if (!g->arc[k]) {
+		ex = g->v1_x[k] - g->v0_x[k];
+		ey = g->v1_y[k] - g->v0_y[k];
+		/* past either end the vertexes take over */
+		if ((w->x[i] - g->v0_x[k]) * ex + (w->y[i] - g->v0_y[k]) * ey <= 0 ||
+				(w->x[i] - g->v1_x[k]) * ex + (w->y[i] - g->v1_y[k]) * ey >= 0)
+			return;
+		nx = g->normal_x[k];
+		ny = g->normal_y[k];
+		dist = nx * (w->x[i] - g->v0_x[k]) + ny * (w->y[i] - g->v0_y[k]);
+	} else {
+		dx = w->x[i] - g->center_x[k];
+		dy = w->y[i] - g->center_y[k];
+		if (!hb_geometry_arc_contains(g, k, dx, dy))
+			return;
+		len = sqrt(dx * dx + dy * dy);
+		if (len == 0)
+			return;
+		/* inwards, the left of v0 -> v1 as for straight segments */
+		nx = -dx / len;
+		ny = -dy / len;
+		dist = g->radius[k] - len;
+	}
+
+	/* a bias makes the segment one sided, and that many units thick */
+	bias = g->bias[k];
+	if (bias == 0) {
+		if (dist < 0) {
+			dist = -dist;
+			nx = -nx;
+			ny = -ny;
+		}
+	} else {
+		if (bias < 0) {
+			bias = -bias;
+			dist = -dist;
+			nx = -nx;
+			ny = -ny;
+		}
+		if (dist < -bias)
+			return;
+	}
+
+	if (dist < w->radius[i])
+		_hb_world_resolve(w, i, nx, ny, w->radius[i] - dist, g->b_coef[k]);
+}
+
+static void
+_hb_world_collide_vertex(struct hb_world *w, size_t i, size_t k)
+{
+	const struct hb_geometry *g;
+	double dx, dy, dist;
+
+	g = w->geometry;
+	dx = w->x[i] - g->vertex_x[k];
+	dy = w->y[i] - g->vertex_y[k];
+	dist = dx * dx + dy * dy;
+
+	if (!(dist > 0 && dist <= w->radius[i] * w->radius[i]))
+		return;
+
+	dist = sqrt(dist);
+	_hb_world_resolve(w, i, dx / dist, dy / dist, w->radius[i] - dist,
+			g->vertex_b_coef[k]);
+}
+
+/* the walls in index order, as when testing all of them. a collision
+   can push the disc out of the box the candidates came from, the grid
+   is asked again then and walls already passed are skipped */
+struct _hb_world_box {
+	double                            min_x;
+	double                            min_y;
+	double                            max_x;
+	double                            max_y;
+	size_t                       nsegments;
+	size_t                       nvertexes;
+};
+
+static void
+_hb_world_query(struct hb_world *w, size_t i, struct _hb_world_box *box)
+{
+	double reach;
+	reach = 2 * w->radius[i];
+	box->min_x = w->x[i] - reach;
+	box->min_y = w->y[i] - reach;
+	box->max_x = w->x[i] + reach;
+	box->max_y = w->y[i] + reach;
+	hb_static_grid_query(w->grid, box->min_x, box->min_y, box->max_x, box->max_y,
+			w->segment_candidates, &box->nsegments,
+			w->vertex_candidates, &box->nvertexes);
+}
+
+static bool
+_hb_world_inside(const struct hb_world *w, size_t i, const struct _hb_world_box *box)
+{
+	return w->x[i] - w->radius[i] >= box->min_x && w->x[i] + w->radius[i] <= box->max_x &&
+		w->y[i] - w->radius[i] >= box->min_y && w->y[i] + w->radius[i] <= box->max_y;
+}
+
+typedef unsigned (*_hb_world_kernel)(const struct hb_geometry *, const uint32_t *,
+		size_t, double, double, double, double *);
+
+/* the first wall disc i is into from candidate *c on, skipping walls
+   before next and walls of a class it does not collide with, or -1.
+   the walls are tested a batch at a time and *c is left past the one
+   found. without candidates every wall up to count is one, in order */
+static long
+_hb_world_next_hit(struct hb_world *w, size_t i, _hb_world_kernel kernel,
+		const uint32_t *c_class, const uint32_t *candidates, size_t count,
+		size_t *c, size_t next)
+{
+	uint32_t batch[HB_NARROWPHASE_BATCH];
+	size_t at[HB_NARROWPHASE_BATCH], m, j, k;
+	unsigned hits;
+
+	while (*c < count) {
+		for (m = 0; m < HB_NARROWPHASE_BATCH && *c < count; ++*c) {
+			k = candidates ? candidates[*c] : *c;
+			if (k < next || !hb_collision_table_test(w->classes, w->c_class[i], c_class[k]))
+				continue;
+			at[m] = *c;
+			batch[m++] = k;
+		}
+		hits = kernel(w->geometry, batch, m, w->x[i], w->y[i], w->radius[i], NULL);
+		if (hits) {
+			for (j = 0; !(hits >> j & 1); ++j)
+				;
+			*c = at[j] + 1;
+			return batch[j];
+		}
+	}
+
+	return -1;
+}
+
+static void
+_hb_world_collide_planes(struct hb_world *w, size_t i)
+{
+	size_t c;
+	long k;
+
+	c = 0;
+	while ((k = _hb_world_next_hit(w, i, hb_narrowphase_planes,
+					w->geometry->plane_c_class, NULL, w->geometry->planes_count,
+					&c, 0)) >= 0)
+		_hb_world_collide_plane(w, i, k);
+}
+
+static void
+_hb_world_collide_walls(struct hb_world *w, size_t i)
+{
+	const struct hb_geometry *g;
+	struct _hb_world_box box;
+	size_t c, next;
+	long k;
+
+	g = w->geometry;
+
+	if (!w->grid) {
+		c = 0;
+		while ((k = _hb_world_next_hit(w, i, hb_narrowphase_segments, g->c_class,
+						NULL, g->segments_count, &c, 0)) >= 0)
+			_hb_world_collide_segment(w, i, k);
+		c = 0;
+		while ((k = _hb_world_next_hit(w, i, hb_narrowphase_vertexes, g->vertex_c_class,
+						NULL, g->vertexes_count, &c, 0)) >= 0)
+			_hb_world_collide_vertex(w, i, k);
+		return;
+	}
+
+	_hb_world_query(w, i, &box);
+
+	c = next = 0;
+	while ((k = _hb_world_next_hit(w, i, hb_narrowphase_segments, g->c_class,
+					w->segment_candidates, box.nsegments, &c, next)) >= 0) {
+		_hb_world_collide_segment(w, i, k);
+		next = k + 1;
+		if (!_hb_world_inside(w, i, &box)) {
+			_hb_world_query(w, i, &box);
+			c = 0;
+		}
+	}
+
+	if (!_hb_world_inside(w, i, &box))
+		_hb_world_query(w, i, &box);
+
+	c = next = 0;
+	while ((k = _hb_world_next_hit(w, i, hb_narrowphase_vertexes, g->vertex_c_class,
+					w->vertex_candidates, box.nvertexes, &c, next)) >= 0) {
+		_hb_world_collide_vertex(w, i, k);
+		next = k + 1;
+		if (!_hb_world_inside(w, i, &box)) {
+			_hb_world_query(w, i, &box);
+			c = 0;
+		}
+	}
+}
+
+/* updates the sweep on where the discs are now, false when there is
+   no sweep to use and every pair has to be tested */
+static bool
+_hb_world_sweep(struct hb_world *w)
+{
+	if (!w->sweep || hb_sweep_update(w->sweep, w->discs_count, w->x, w->y,
+				w->radius, w->c_class, w->classes, _HB_WORLD_SWEEP_MARGIN) < 0)
+		return false;
+	memcpy(w->sweep_x, w->x, w->discs_count * sizeof(double));
+	memcpy(w->sweep_y, w->y, w->discs_count * sizeof(double));
+	return true;
+}
+
+/* whether disc i left the margin the sweep found its pairs with */
+static bool
+_hb_world_strayed(const struct hb_world *w, size_t i)
+{
+	return fabs(w->x[i] - w->sweep_x[i]) > _HB_WORLD_SWEEP_MARGIN ||
+		fabs(w->y[i] - w->sweep_y[i]) > _HB_WORLD_SWEEP_MARGIN;
+}
+
+/////////////fast discs
+
+/* the first wall disc i hits moving by dx, dy, and its b_coef */
+static bool
+_hb_world_first_impact(struct hb_world *w, size_t i, double dx, double dy,
+		struct hb_ccd_hit *first, double *b_coef)
+{
+	const struct hb_geometry *g;
+	struct hb_ccd_hit hit;
+	size_t c, k, nsegments, nvertexes;
+	double x, y, r;
+	bool found;
+
+	g = w->geometry;
+	x = w->x[i];
+	y = w->y[i];
+	r = w->radius[i];
+	found = false;
+
+	for (k = 0; k < g->planes_count; ++k) {
+		if (!hb_collision_table_test(w->classes, w->c_class[i], g->plane_c_class[k]) ||
+				!hb_ccd_plane(g, k, x, y, dx, dy, r, &hit) ||
+				(found && hit.t >= first->t))
+			continue;
+		*first = hit;
+		*b_coef = g->plane_b_coef[k];
+		found = true;
+	}
+
+	if (w->grid) {
+		hb_static_grid_query(w->grid, (dx < 0 ? x + dx : x) - r, (dy < 0 ? y + dy : y) - r,
+				(dx > 0 ? x + dx : x) + r, (dy > 0 ? y + dy : y) + r,
+				w->segment_candidates, &nsegments, w->vertex_candidates, &nvertexes);
+	} else {
+		nsegments = g->segments_count;
+		nvertexes = g->vertexes_count;
+	}
+
+	for (c = 0; c < nsegments; ++c) {
+		k = w->grid ? w->segment_candidates[c] : c;
+		if (!hb_collision_table_test(w->classes, w->c_class[i], g->c_class[k]) ||
+				!hb_ccd_segment(g, k, x, y, dx, dy, r, &hit) ||
+				(found && hit.t >= first->t))
+			continue;
+		*first = hit;
+		*b_coef = g->b_coef[k];
+		found = true;
+	}
+
+	for (c = 0; c < nvertexes; ++c) {
+		k = w->grid ? w->vertex_candidates[c] : c;
+		if (!hb_collision_table_test(w->classes, w->c_class[i], g->vertex_c_class[k]) ||
+				!hb_ccd_vertex(g, k, x, y, dx, dy, r, &hit) ||
+				(found && hit.t >= first->t))
+			continue;
+		*first = hit;
+		*b_coef = g->vertex_b_coef[k];
+		found = true;
+	}
+
+	return found;
+}
+
+/* a disc moving further than its radius in a tick could pass through a
+   wall the collision step never sees it touch. it is moved up to the
+   walls on its way instead and bounces off them like it would there */
+static void
+_hb_world_move_fast(struct hb_world *w, size_t i)
+{
+	struct hb_ccd_hit hit;
+	double left, b_coef, v;
+	int bounce;
+
+	left = 1;
+
+	for (bounce = 0; bounce < _HB_WORLD_CCD_BOUNCES; ++bounce) {
+		if (!_hb_world_first_impact(w, i, w->speed_x[i] * left,
+					w->speed_y[i] * left, &hit, &b_coef))
+			break;
+		w->x[i] += w->speed_x[i] * left * hit.t;
+		w->y[i] += w->speed_y[i] * left * hit.t;
+		left -= left * hit.t;
+		v = hit.normal_x * w->speed_x[i] + hit.normal_y * w->speed_y[i];
+		if (v < 0) {
+			v *= w->b_coef[i] * b_coef + 1;
+			w->speed_x[i] -= hit.normal_x * v;
+			w->speed_y[i] -= hit.normal_y * v;
+		}
+	}
+
+	w->x[i] += w->speed_x[i] * left;
+	w->y[i] += w->speed_y[i] * left;
+}
+
+static void
+_hb_world_move(struct hb_world *w, size_t i)
+{
+	if (w->ccd && w->inv_mass[i] != 0 && w->speed_x[i] * w->speed_x[i] +
+			w->speed_y[i] * w->speed_y[i] > w->radius[i] * w->radius[i]) {
+		_hb_world_move_fast(w, i);
+	} else {
+		w->x[i] += w->speed_x[i];
+		w->y[i] += w->speed_y[i];
+	}
+	w->speed_x[i] = (w->speed_x[i] + w->gravity_x[i]) * w->damping[i];
+	w->speed_y[i] = (w->speed_y[i] + w->gravity_y[i]) * w->damping[i];
+}
+
+/////////////goals
+
+static bool
+_hb_world_crosses(double ax, double ay, double bx, double by,
+		double cx, double cy, double dx, double dy)
+{
+	double d0, d1, e0, e1;
+	d0 = (dx - cx) * (ay - cy) - (dy - cy) * (ax - cx);
+	d1 = (dx - cx) * (by - cy) - (dy - cy) * (bx - cx);
+	e0 = (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+	e1 = (bx - ax) * (dy - ay) - (by - ay) * (dx - ax);
+	return d0 * d1 < 0 && e0 * e1 <= 0;
+}
+
+/* the first goal line crossed going from a to b, or -1 */
+static long
+_hb_world_goal_crossed(const struct hb_world *w, double ax, double ay,
+		double bx, double by)
+{
+	size_t k;
+	for (k = 0; k < w->goals_count; ++k)
+		if (_hb_world_crosses(ax, ay, bx, by, w->goal_p0x[k], w->goal_p0y[k],
+					w->goal_p1x[k], w->goal_p1y[k]))
+			return k;
+	return -1;
+}
+
+extern unsigned
+hb_world_step(struct hb_world *w, const unsigned *inputs)
+{
+	double ball_x, ball_y;
+	unsigned events;
+	size_t n, i, j, c, next;
+	bool swept;
+
+	n = w->discs_count;
+	w->goal = -1;
+
+	events = _hb_world_players(w, inputs);
+
+	ball_x = n > 0 ? w->x[0] : 0;
+	ball_y = n > 0 ? w->y[0] : 0;
+
+	/////////////move
+	for (i = 0; i < n; ++i)
+		_hb_world_move(w, i);
+
+	/////////////collide
+	/* the pairs of the sweep, in the order testing all of them would
+	   take. once a push strays a disc too far the rest are all tested */
+	swept = _hb_world_sweep(w);
+
+	for (i = 0; i < n; ++i) {
+		next = i + 1;
+		if (swept) {
+			for (c = w->sweep->start[i]; c < w->sweep->start[i + 1]; ++c) {
+				j = w->sweep->partner[c];
+				_hb_world_collide_discs(w, i, j);
+				next = j + 1;
+				if (_hb_world_strayed(w, i) || _hb_world_strayed(w, j)) {
+					swept = false;
+					break;
+				}
+			}
+			if (swept)
+				next = n;
+		}
+
+		for (j = next; j < n; ++j)
+			if (hb_collision_table_test(w->classes, w->c_class[i], w->c_class[j]))
+				_hb_world_collide_discs(w, i, j);
+
+		if (w->inv_mass[i] == 0)
+			continue;
+
+		_hb_world_collide_planes(w, i);
+
+		_hb_world_collide_walls(w, i);
+	}
+
+	/////////////joints
+	for (i = 0; i < 2; ++i)
+		hb_joints_solve(w->joints, w->x, w->y, w->speed_x, w->speed_y, w->inv_mass);
+
+	/////////////goals
+	if (n > 0 && (w->goal = _hb_world_goal_crossed(w, ball_x, ball_y, w->x[0], w->y[0])) >= 0)
+		events |= HB_WORLD_EVENT_GOAL;
+
+	++w->tick;
+
+	return events;
+}
+
+/////////////prediction
+
+/* the one slot of a world of a single disc, sharing the walls, grid and
+   classes of the world it came from but none of what a step writes */
+struct _hb_world_lone {
+	double                                x;
+	double                                y;
+	double                          speed_x;
+	double                          speed_y;
+	double                        gravity_x;
+	double                        gravity_y;
+	double                           radius;
+	double                         inv_mass;
+	double                          damping;
+	double                           b_coef;
+	enum hb_collision_flags         c_group;
+	enum hb_collision_flags          c_mask;
+	uint32_t                        c_class;
+};
+
+static int
+_hb_world_lone(const struct hb_world *w, size_t disc, struct hb_world *p,
+		struct _hb_world_lone *d)
+{
+	d->x = w->x[disc];
+	d->y = w->y[disc];
+	d->speed_x = w->speed_x[disc];
+	d->speed_y = w->speed_y[disc];
+	d->gravity_x = w->gravity_x[disc];
+	d->gravity_y = w->gravity_y[disc];
+	d->radius = w->radius[disc];
+	d->inv_mass = w->inv_mass[disc];
+	d->damping = w->damping[disc];
+	d->b_coef = w->b_coef[disc];
+	d->c_group = w->c_group[disc];
+	d->c_mask = w->c_mask[disc];
+	d->c_class = w->c_class[disc];
+
+	*p = *w;
+	p->x = &d->x;
+	p->y = &d->y;
+	p->speed_x = &d->speed_x;
+	p->speed_y = &d->speed_y;
+	p->gravity_x = &d->gravity_x;
+	p->gravity_y = &d->gravity_y;
+	p->radius = &d->radius;
+	p->inv_mass = &d->inv_mass;
+	p->damping = &d->damping;
+	p->b_coef = &d->b_coef;
+	p->c_group = &d->c_group;
+	p->c_mask = &d->c_mask;
+	p->c_class = &d->c_class;
+	p->discs_count = p->discs_capacity = 1;
+	p->players_count = 0;
+	p->team = NULL;
+	p->input = NULL;
+	p->kick_armed = NULL;
+	p->sweep = NULL;
+	p->sweep_x = p->sweep_y = NULL;
+	p->joints = NULL;
+	p->segment_candidates = NULL;
+	p->vertex_candidates = NULL;
+
+	/* candidates of its own so callers on other threads do not share them */
+	if (p->grid && (NULL == (p->segment_candidates =
+					malloc((p->geometry->segments_count + 1) * sizeof(uint32_t))) ||
+				NULL == (p->vertex_candidates =
+					malloc((p->geometry->vertexes_count + 1) * sizeof(uint32_t))))) {
+		free(p->segment_candidates);
+		return -1;
+	}
+
+	return 0;
+}
+
+extern size_t
+hb_world_predict_disc(const struct hb_world *w, size_t disc, size_t ticks,
+		double *positions)
+{
+	struct hb_world p;
+	struct _hb_world_lone d;
+	double x, y;
+	size_t t;
+
+	if (disc >= w->discs_count || _hb_world_lone(w, disc, &p, &d) < 0)
+		return 0;
+
+	for (t = 0; t < ticks; ++t) {
+		x = d.x;
+		y = d.y;
+		_hb_world_move(&p, 0);
+		if (d.inv_mass != 0) {
+			_hb_world_collide_planes(&p, 0);
+			_hb_world_collide_walls(&p, 0);
+		}
+		positions[2 * t] = d.x;
+		positions[2 * t + 1] = d.y;
+		if (_hb_world_goal_crossed(&p, x, y, d.x, d.y) >= 0)
+			break;
+	}
+
+	free(p.segment_candidates);
+	free(p.vertex_candidates);
+
+	return t < ticks ? t + 1 : ticks;
+}
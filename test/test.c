@@ -1,8 +1,29 @@
 #include <hb/stadium.h>
+#include <hb/shared.h>
+#include <hb/hash.h>
+#include <hb/cache.h>
+#include <hb/registry.h>
+#include <hb/diff.h>
+#include <hb/builder.h>
+#include <hb/geometry.h>
+#include <hb/optimize.h>
+#include <hb/tessellation.h>
+#include <hb/world.h>
+#include <hb/cast.h>
+#include <hb/ccd.h>
+#include <hb/collision_table.h>
+#include <hb/grid.h>
+#include <hb/joints.h>
+#include <hb/narrowphase.h>
+#include <hb/sdf.h>
+#include <hb/sweep.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 #include <assert.h>
+#include <stddef.h>
+#include <unistd.h>
 
 static struct hb_stadium *
 _test_load(const char *path)
@@ -11,6 +32,14 @@ _test_load(const char *path)
 	return hb_stadium_from_file(path);
 }
 
+/* a small lcg so the randomized tests see the same values everywhere */
+static double
+_test_random(uint32_t *seed, double lo, double hi)
+{
+	*seed = *seed * 1103515245 + 12345;
+	return lo + (double)(*seed >> 8 & 0xffff) / 0xffff * (hi - lo);
+}
+
 static void
 test_invalid_json(void)
 {
@@ -32,6 +61,1394 @@ test_name(void)
 	hb_stadium_free(s);
 }
 
+static void
+test_compact_round_trip(const char *path, int flags)
+{
+	struct hb_stadium *s, *r;
+	char *full, *compact, *again;
+	assert(NULL != (s = _test_load(path)));
+	full = hb_stadium_to_json(s);
+	compact = hb_stadium_to_json_ex(s, flags);
+	assert(strlen(compact) < strlen(full));
+	assert(NULL != (r = hb_stadium_parse(compact)));
+	again = hb_stadium_to_json(r);
+	assert(!strcmp(full, again));
+	free(full);
+	free(compact);
+	free(again);
+	hb_stadium_free(r);
+	hb_stadium_free(s);
+}
+
+static void
+test_number_round_trip(void)
+{
+	struct hb_stadium *s, *r;
+	char *json;
+	assert(NULL != (s = hb_stadium_parse("{\"name\":\"n\",\"width\":0.1,"
+			"\"height\":-0,\"spawnDistance\":1e21,\"vertexes\":["
+			"{\"x\":335.50000000000006,\"y\":1e-7},"
+			"{\"x\":0.30000000000000004,\"y\":-12345.678}]}")));
+	json = hb_stadium_to_json(s);
+	assert(strstr(json, "\"width\":0.1,"));
+	assert(strstr(json, "\"height\":-0,"));
+	assert(NULL != (r = hb_stadium_parse(json)));
+	assert(!memcmp(&s->height, &r->height, sizeof(double)));
+	assert(s->spawn_distance == r->spawn_distance);
+	assert(s->vertexes[0]->x == r->vertexes[0]->x);
+	assert(s->vertexes[0]->y == r->vertexes[0]->y);
+	assert(s->vertexes[1]->x == r->vertexes[1]->x);
+	assert(s->vertexes[1]->y == r->vertexes[1]->y);
+	free(json);
+	hb_stadium_free(r);
+	hb_stadium_free(s);
+}
+
+static void
+test_shared(const char *path)
+{
+	struct hb_stadium *s;
+	const struct hb_shared_stadium *ss;
+	struct hb_shared_section section, bad;
+	FILE *f;
+	size_t i;
+	off_t at;
+	int v0;
+	assert(NULL != (s = _test_load(path)));
+	assert(NULL != (f = tmpfile()));
+	assert(0 == hb_stadium_export_shared(s, fileno(f)));
+	assert(NULL != (ss = hb_stadium_map_shared(fileno(f))));
+	assert(!strcmp(hb_shared_stadium_name(ss), s->name));
+	assert(ss->width == s->width);
+	assert(ss->ball_physics.radius == s->ball_physics->radius);
+	i = 0;
+	hb_shared_stadium_segments_foreach(ss, seg) {
+		struct hb_segment copy = *s->segments[i];
+		copy.trait = NULL;
+		assert(!memcmp(seg, &copy, sizeof(*seg)));
+		++i;
+	}
+	assert(s->segments[i] == NULL);
+	i = 0;
+	hb_shared_stadium_discs_foreach(ss, disc) {
+		struct hb_disc copy = *s->discs[i];
+		copy.trait = NULL;
+		assert(!memcmp(disc, &copy, sizeof(*disc)));
+		++i;
+	}
+	assert(s->discs[i] == NULL);
+	assert(ss->vertexes.count > 0);
+	assert(hb_shared_stadium_vertexes(ss)[ss->vertexes.count - 1].x
+			== s->vertexes[ss->vertexes.count - 1]->x);
+	/* a misaligned section or a segment past the vertexes is refused */
+	assert(ss->segments.count > 0);
+	section = ss->segments;
+	v0 = (int)ss->vertexes.count;
+	hb_stadium_unmap_shared(ss);
+	at = offsetof(struct hb_shared_stadium, segments);
+	bad = section;
+	bad.offset += 4;
+	assert((ssize_t)sizeof(bad) == pwrite(fileno(f), &bad, sizeof(bad), at));
+	assert(NULL == hb_stadium_map_shared(fileno(f)));
+	assert((ssize_t)sizeof(section) == pwrite(fileno(f), &section, sizeof(section), at));
+	assert((ssize_t)sizeof(v0) == pwrite(fileno(f), &v0, sizeof(v0),
+			section.offset + offsetof(struct hb_segment, v0)));
+	assert(NULL == hb_stadium_map_shared(fileno(f)));
+	fclose(f);
+	hb_stadium_free(s);
+}
+
+static void
+test_hash(const char *path)
+{
+	struct hb_stadium *s, *r;
+	struct hb_hash128 hs, hr;
+	char *json;
+	assert(NULL != (s = _test_load(path)));
+	/* the synthesized traits replace the stadium's own ones */
+	json = hb_stadium_to_json_ex(s, HB_STADIUM_JSON_TRAITS);
+	assert(NULL != (r = hb_stadium_parse(json)));
+	assert(!hb_stadium_equal(s, r));
+	free(json);
+	hb_stadium_free(r);
+	assert(NULL != (r = hb_stadium_clone(s, HB_STADIUM_SECTION_ALL)));
+	hs = hb_stadium_hash(s);
+	hr = hb_stadium_hash(r);
+	assert(hb_hash128_equal(hs, hr));
+	assert(hb_stadium_equal(s, r));
+	r->vertexes[0]->x += 1;
+	hr = hb_stadium_hash(r);
+	assert(!hb_hash128_equal(hs, hr));
+	assert(!hb_stadium_equal(s, r));
+	r->vertexes[0]->x -= 1;
+	r->width = -0.0 * s->width;
+	s->width = 0;
+	assert(hb_stadium_equal(s, r));
+	hb_stadium_free(r);
+	hb_stadium_free(s);
+	/* a field from a trait is not the same as one set on the element */
+	assert(NULL != (s = hb_stadium_parse("{\"name\":\"t\","
+		"\"width\":9,\"height\":9,\"traits\":{\"w\":{\"bCoef\":0.5}},"
+		"\"vertexes\":[{\"x\":0,\"y\":0,\"trait\":\"w\"}]}")));
+	assert(NULL != (r = hb_stadium_parse("{\"name\":\"t\","
+		"\"width\":9,\"height\":9,\"traits\":{\"w\":{\"bCoef\":0.5}},"
+		"\"vertexes\":[{\"x\":0,\"y\":0,\"bCoef\":0.5}]}")));
+	assert(s->vertexes[0]->b_coef == r->vertexes[0]->b_coef);
+	assert(!hb_hash128_equal(hb_stadium_hash(s), hb_stadium_hash(r)));
+	assert(!hb_stadium_equal(s, r));
+	hb_stadium_free(r);
+	hb_stadium_free(s);
+}
+
+static char *
+_test_read(const char *path)
+{
+	FILE *fp;
+	long size;
+	char *data;
+	assert(NULL != (fp = fopen(path, "r")));
+	fseek(fp, 0, SEEK_END);
+	size = ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	assert(NULL != (data = malloc(size + 1)));
+	assert((size_t)size == fread(data, 1, size, fp));
+	data[size] = '\0';
+	fclose(fp);
+	return data;
+}
+
+static void
+test_cache(void)
+{
+	struct hb_stadium_cache *cache;
+	const struct hb_stadium *a, *b, *c, *d;
+	struct hb_stadium *s;
+	char *json;
+	json = _test_read("stadiums/futsal.json");
+	assert(NULL != (cache = hb_stadium_cache_create(1 << 20)));
+	assert(NULL != (a = hb_stadium_cache_parse(cache, json)));
+	assert(a == hb_stadium_cache_parse(cache, json));
+	assert(NULL != (b = hb_stadium_cache_insert(cache, _test_load("stadiums/futsal.json"))));
+	assert(a == b);
+	assert(a == (c = hb_stadium_cache_lookup(cache, hb_stadium_hash(a))));
+	assert(NULL != (d = hb_stadium_cache_insert(cache, _test_load("stadiums/big.json"))));
+	assert(a != d);
+	hb_stadium_cache_release(cache, a);
+	hb_stadium_cache_release(cache, a);
+	hb_stadium_cache_release(cache, b);
+	hb_stadium_cache_release(cache, c);
+	hb_stadium_cache_release(cache, d);
+	hb_stadium_cache_free(cache);
+	/* a budget of zero keeps nothing once released */
+	assert(NULL != (cache = hb_stadium_cache_create(0)));
+	assert(NULL != (a = hb_stadium_cache_parse(cache, json)));
+	hb_stadium_cache_release(cache, a);
+	assert(NULL != (s = hb_stadium_parse(json)));
+	assert(NULL == hb_stadium_cache_lookup(cache, hb_stadium_hash(s)));
+	/* nor does giving back one it never handed out */
+	hb_stadium_cache_release(cache, s);
+	hb_stadium_free(s);
+	hb_stadium_cache_free(cache);
+	free(json);
+}
+
+static void
+test_registry(void)
+{
+	struct hb_stadium_registry *reg;
+	struct hb_stadium_slot *slot;
+	struct hb_stadium_reader *r0, *r1;
+	const struct hb_stadium *s;
+	assert(NULL != (reg = hb_stadium_registry_create()));
+	assert(NULL != (slot = hb_stadium_registry_slot(reg, "futsal")));
+	assert(NULL == hb_stadium_slot_get(slot));
+	assert(NULL != (r0 = hb_stadium_reader_register(reg)));
+	assert(NULL != (r1 = hb_stadium_reader_register(reg)));
+	assert(0 == hb_stadium_registry_publish(reg, "futsal", _test_load("stadiums/futsal.json")));
+	assert(NULL != (s = hb_stadium_slot_get(slot)));
+	assert(0 == hb_stadium_registry_publish(reg, "futsal", _test_load("stadiums/big.json")));
+	assert(s != hb_stadium_slot_get(slot));
+	/* the first version stays around until both readers moved on */
+	assert(!strcmp(s->name, "Futsal x3  by Bazinga from HaxMaps"));
+	hb_stadium_reader_quiescent(r0);
+	assert(1 == hb_stadium_registry_reclaim(reg));
+	hb_stadium_reader_offline(r1);
+	assert(0 == hb_stadium_registry_reclaim(reg));
+	hb_stadium_reader_online(r1);
+	assert(slot == hb_stadium_registry_slot(reg, "futsal"));
+	hb_stadium_reader_unregister(r0);
+	hb_stadium_reader_unregister(r1);
+	hb_stadium_registry_free(reg);
+}
+
+static void
+_test_patch(struct hb_stadium *a, const struct hb_stadium *b, size_t max_size)
+{
+	struct hb_stadium_delta *delta;
+	char *ja, *jb;
+	assert(NULL != (delta = hb_stadium_diff(a, b)));
+	assert(delta->size <= max_size);
+	assert(0 == hb_stadium_patch(a, delta));
+	ja = hb_stadium_to_json(a);
+	jb = hb_stadium_to_json(b);
+	assert(!strcmp(ja, jb));
+	assert(a->ball_physics == a->discs[0]);
+	free(ja);
+	free(jb);
+	hb_stadium_delta_free(delta);
+}
+
+static void
+test_diff(void)
+{
+	struct hb_stadium *a, *b, *c;
+	struct hb_stadium_delta bad, *delta;
+	char *ja, *jb;
+	unsigned char garbage[] = { 'h', 'd', 1, 5, 200, 1, 0, 0 };
+	assert(NULL != (a = _test_load("stadiums/futsal.json")));
+	assert(NULL != (b = _test_load("stadiums/futsal.json")));
+	_test_patch(a, b, 4);
+	b->vertexes[3]->x += 10;
+	b->segments[2]->b_coef = 0.25;
+	_test_patch(a, b, 40);
+	assert(NULL != (c = _test_load("stadiums/big.json")));
+	_test_patch(a, c, (size_t)-1);
+	hb_stadium_free(b);
+	assert(NULL != (b = _test_load("stadiums/fish_hunt.json")));
+	_test_patch(a, b, (size_t)-1);
+	bad.size = sizeof(garbage);
+	bad.data = garbage;
+	assert(-1 == hb_stadium_patch(a, &bad));
+	hb_stadium_free(a);
+	hb_stadium_free(b);
+	hb_stadium_free(c);
+	/* dropping a vertex shifts the indexes of every segment after it */
+	assert(NULL != (a = hb_stadium_parse("{\"name\":\"a\",\"width\":9,\"height\":9,"
+			"\"vertexes\":[{\"x\":0,\"y\":0},{\"x\":1,\"y\":0},"
+			"{\"x\":2,\"y\":0},{\"x\":3,\"y\":0}],"
+			"\"segments\":[{\"v0\":0,\"v1\":1},{\"v0\":2,\"v1\":3}]}")));
+	assert(NULL != (b = hb_stadium_parse("{\"name\":\"a\",\"width\":9,\"height\":9,"
+			"\"vertexes\":[{\"x\":0,\"y\":0},{\"x\":2,\"y\":0},"
+			"{\"x\":3,\"y\":0}],"
+			"\"segments\":[{\"v0\":0,\"v1\":0},{\"v0\":1,\"v1\":2}]}")));
+	_test_patch(a, b, 20);
+	hb_stadium_free(b);
+	/* a delta naming a vertex the patched stadium lacks is refused whole */
+	ja = hb_stadium_to_json(a);
+	assert(NULL != (b = hb_stadium_parse("{\"name\":\"b\",\"width\":9,\"height\":9,"
+			"\"vertexes\":[{\"x\":0,\"y\":0},{\"x\":2,\"y\":0},"
+			"{\"x\":3,\"y\":0}],"
+			"\"segments\":[{\"v0\":0,\"v1\":0},{\"v0\":1,\"v1\":2},"
+			"{\"v0\":2,\"v1\":1}]}")));
+	b->segments[1]->v1 = 3;
+	assert(NULL != (delta = hb_stadium_diff(a, b)));
+	assert(-1 == hb_stadium_patch(a, delta));
+	hb_stadium_delta_free(delta);
+	b->segments[1]->v1 = 2;
+	b->segments[2]->v0 = -1;
+	assert(NULL != (delta = hb_stadium_diff(a, b)));
+	assert(-1 == hb_stadium_patch(a, delta));
+	hb_stadium_delta_free(delta);
+	jb = hb_stadium_to_json(a);
+	assert(!strcmp(ja, jb));
+	free(ja);
+	free(jb);
+	hb_stadium_free(a);
+	hb_stadium_free(b);
+	/* patched elements keep their trait and the fields set stay their own */
+	assert(NULL != (a = hb_stadium_parse("{\"name\":\"a\",\"width\":9,\"height\":9,"
+			"\"traits\":{\"w\":{\"bCoef\":0.5}},"
+			"\"vertexes\":[{\"x\":0,\"y\":0},{\"x\":1,\"y\":0}],"
+			"\"segments\":[{\"v0\":0,\"v1\":1,\"trait\":\"w\"}]}")));
+	assert(NULL != (b = hb_stadium_parse("{\"name\":\"a\",\"width\":9,\"height\":9,"
+			"\"traits\":{\"w\":{\"bCoef\":0.5}},"
+			"\"vertexes\":[{\"x\":0,\"y\":0},{\"x\":1,\"y\":0}],"
+			"\"segments\":[{\"v0\":0,\"v1\":1,\"trait\":\"w\"},"
+			"{\"v0\":1,\"v1\":0,\"trait\":\"w\"}]}")));
+	b->segments[0]->b_coef = 0.25;
+	_test_patch(a, b, (size_t)-1);
+	assert(a->segments[1]->trait == a->traits[0]);
+	assert(a->segments[0]->overrides & HB_TRAIT_FIELD_B_COEF);
+	assert(0 == hb_stadium_set_trait_field(a, "w", HB_TRAIT_FIELD_B_COEF, 0.75));
+	assert(a->segments[0]->b_coef == 0.25);
+	assert(a->segments[1]->b_coef == 0.75);
+	hb_stadium_free(a);
+	hb_stadium_free(b);
+}
+
+static void
+test_clone(void)
+{
+	struct hb_stadium *s, *c, *d;
+	struct hb_stadium_delta *delta;
+	char *js, *jc;
+	assert(NULL != (s = _test_load("stadiums/fish_hunt.json")));
+	assert(NULL != (c = hb_stadium_clone(s, HB_STADIUM_SECTION_JOINTS)));
+	assert(c->vertexes == s->vertexes);
+	assert(c->segments == s->segments);
+	assert(c->discs != s->discs);
+	assert(c->joints != s->joints);
+	assert(c->ball_physics == c->discs[0]);
+	js = hb_stadium_to_json(s);
+	jc = hb_stadium_to_json(c);
+	assert(!strcmp(js, jc));
+	free(jc);
+	c->discs[1]->pos[0] += 5;
+	assert(s->discs[1]->pos[0] + 5 == c->discs[1]->pos[0]);
+	/* patching a clone leaves the stadium it borrows from alone */
+	assert(NULL != (d = hb_stadium_clone(s, 0)));
+	d->discs[0]->radius = 1;
+	assert(0 == hb_stadium_unshare(d, HB_STADIUM_SECTION_VERTEXES));
+	d->vertexes[0]->x = 12345;
+	assert(NULL != (delta = hb_stadium_diff(c, d)));
+	assert(0 == hb_stadium_patch(c, delta));
+	assert(c->vertexes != s->vertexes);
+	assert(c->vertexes[0]->x == 12345);
+	assert(c->ball_physics->radius == 1);
+	jc = hb_stadium_to_json(s);
+	assert(!strcmp(js, jc));
+	free(js);
+	free(jc);
+	hb_stadium_delta_free(delta);
+	hb_stadium_free(d);
+	hb_stadium_free(c);
+	hb_stadium_free(s);
+}
+
+static void
+test_builder(void)
+{
+	struct hb_stadium_builder *b;
+	struct hb_stadium *s, *r;
+	struct hb_vertex v = { .b_coef = 1, .c_mask = HB_COLLISION_ALL };
+	struct hb_segment seg = { .b_coef = 1, .vis = true, .color = 0xff000000 };
+	char *js, *jr;
+	int i;
+	assert(NULL != (b = hb_stadium_builder_create()));
+	assert(0 == hb_stadium_builder_set_name(b, "built"));
+	assert(b->discs_count == 1);
+	for (i = 0; i < 4; ++i) {
+		v.x = i;
+		assert(i == hb_stadium_builder_add_vertex(b, &v));
+	}
+	for (i = 0; i < 3; ++i) {
+		seg.v0 = i;
+		seg.v1 = i + 1;
+		assert(i == hb_stadium_builder_add_segment(b, &seg));
+	}
+	seg.v1 = 4;
+	assert(-1 == hb_stadium_builder_add_segment(b, &seg));
+	/* vertex 3 moves into slot 1 and the two segments using 1 go away */
+	assert(0 == hb_stadium_builder_remove_vertex(b, 1));
+	assert(b->vertexes_count == 3 && b->vertexes[1].x == 3);
+	assert(b->segments_count == 1);
+	assert(b->segments[0].v0 == 2 && b->segments[0].v1 == 1);
+	assert(-1 == hb_stadium_builder_remove_disc(b, 0));
+	assert(NULL != (s = hb_stadium_builder_finalize(b)));
+	assert(!strcmp(s->name, "built"));
+	assert(s->ball_physics == s->discs[0]);
+	js = hb_stadium_to_json(s);
+	assert(NULL != (r = hb_stadium_parse(js)));
+	jr = hb_stadium_to_json(r);
+	assert(!strcmp(js, jr));
+	free(js);
+	free(jr);
+	hb_stadium_free(r);
+	hb_stadium_free(s);
+	hb_stadium_builder_free(b);
+	/* a round trip through the builder keeps everything */
+	assert(NULL != (r = _test_load("stadiums/fish_hunt.json")));
+	assert(NULL != (b = hb_stadium_builder_from(r)));
+	assert(NULL != (s = hb_stadium_builder_finalize(b)));
+	js = hb_stadium_to_json(s);
+	jr = hb_stadium_to_json(r);
+	assert(!strcmp(js, jr));
+	free(js);
+	free(jr);
+	hb_stadium_free(r);
+	hb_stadium_free(s);
+	hb_stadium_builder_free(b);
+}
+
+static void
+test_set_trait_field(void)
+{
+	struct hb_stadium *s, *c;
+	const struct hb_trait *net;
+	size_t inherit;
+	assert(NULL != (s = _test_load("stadiums/futsal.json")));
+	assert(NULL != (c = hb_stadium_clone(s, 0)));
+	assert(-1 == hb_stadium_set_trait_field(c, "nope", HB_TRAIT_FIELD_B_COEF, 0.7));
+	assert(0 == hb_stadium_set_trait_field(c, "goalNet", HB_TRAIT_FIELD_B_COEF, 0.7));
+	assert(c->traits != s->traits);
+	inherit = 0;
+	net = NULL;
+	hb_stadium_segments_foreach(c, segment) {
+		if (!segment->trait || strcmp(segment->trait->name, "goalNet"))
+			continue;
+		assert(!net || net == segment->trait);
+		net = segment->trait;
+		if (segment->overrides & HB_TRAIT_FIELD_B_COEF)
+			continue;
+		assert(segment->b_coef == 0.7);
+		++inherit;
+	}
+	assert(inherit > 0);
+	assert(net && net->has_b_coef && net->b_coef == 0.7);
+	/* the stadium the clone borrowed from keeps its values */
+	hb_stadium_segments_foreach(s, segment)
+		if (segment->trait && !strcmp(segment->trait->name, "goalNet"))
+			assert(segment->b_coef != 0.7);
+	hb_stadium_free(c);
+	hb_stadium_free(s);
+}
+
+static void
+test_compile(void)
+{
+	struct hb_stadium *s;
+	struct hb_geometry *g;
+	size_t i;
+	assert(NULL != (s = hb_stadium_parse("{\"name\":\"g\",\"width\":9,\"height\":9,"
+			"\"vertexes\":[{\"x\":0,\"y\":0},{\"x\":2,\"y\":0}],"
+			"\"segments\":[{\"v0\":0,\"v1\":1},{\"v0\":0,\"v1\":1,\"curve\":90},"
+			"{\"v0\":1,\"v1\":0,\"curve\":-90,\"bias\":3},{\"v0\":0,\"v1\":1,\"curve\":270},"
+			"{\"v0\":0,\"v1\":1,\"curve\":5}],"
+			"\"planes\":[{\"normal\":[0,2],\"dist\":-5}]}")));
+	assert(NULL != (g = hb_stadium_compile(s)));
+	assert(g->segments_count == 5 && g->vertexes_count == 2 && g->planes_count == 1);
+	/* straight, the normal points left of v0 -> v1 */
+	assert(!g->arc[0] && g->normal_x[0] == 0 && g->normal_y[0] == 1);
+	assert(g->min_x[0] == 0 && g->max_x[0] == 2 && g->min_y[0] == 0 && g->max_y[0] == 0);
+	/* quarter arc below its chord */
+	assert(g->arc[1]);
+	assert(fabs(g->center_x[1] - 1) < 1e-9 && fabs(g->center_y[1] - 1) < 1e-9);
+	assert(fabs(g->radius[1] - sqrt(2)) < 1e-9);
+	assert(fabs(g->min_y[1] - (1 - sqrt(2))) < 1e-9 && g->max_y[1] == 0);
+	assert(hb_geometry_arc_contains(g, 1, 0, -1));
+	assert(!hb_geometry_arc_contains(g, 1, 0, 1));
+	/* a negative curve is the same arc the other way round */
+	assert(g->arc[2] && g->v0_x[2] == 0 && g->v1_x[2] == 2 && g->bias[2] == -3);
+	assert(fabs(g->center_y[2] - g->center_y[1]) < 1e-9);
+	/* a wide arc bulges the same way, around a center on that side */
+	assert(g->arc[3] && g->cot[3] < 0);
+	assert(fabs(g->center_y[3] + 1) < 1e-9);
+	assert(hb_geometry_arc_contains(g, 3, 0, -1));
+	assert(!hb_geometry_arc_contains(g, 3, 0, 1));
+	assert(fabs(g->min_y[3] + 1 + sqrt(2)) < 1e-9 && g->max_y[3] == 0);
+	assert(fabs(g->min_x[3] - (1 - sqrt(2))) < 1e-9);
+	assert(fabs(g->max_x[3] - (1 + sqrt(2))) < 1e-9);
+	/* too flat to be an arc */
+	assert(!g->arc[4]);
+	assert(g->plane_normal_x[0] == 0 && g->plane_normal_y[0] == 1 && g->plane_dist[0] == -5);
+	hb_geometry_free(g);
+	hb_stadium_free(s);
+	/* every arc of a real stadium passes through its own ends */
+	assert(NULL != (s = _test_load("stadiums/futsal.json")));
+	assert(NULL != (g = hb_stadium_compile(s)));
+	for (i = 0; i < g->segments_count; ++i) {
+		if (!g->arc[i])
+			continue;
+		assert(fabs(hypot(g->v1_x[i] - g->center_x[i], g->v1_y[i] - g->center_y[i]) - g->radius[i]) < 1e-6);
+		assert(g->min_x[i] <= g->v0_x[i] && g->v0_x[i] <= g->max_x[i]);
+	}
+	hb_geometry_free(g);
+	hb_stadium_free(s);
+}
+
+static void
+test_optimize(void)
+{
+	struct hb_stadium *s, *c;
+	struct hb_optimize_report r;
+	size_t vertexes, segments;
+	assert(NULL != (s = hb_stadium_parse("{\"name\":\"o\",\"width\":9,\"height\":9,"
+			"\"vertexes\":[{\"x\":0,\"y\":0},{\"x\":1,\"y\":0},{\"x\":2,\"y\":0},"
+			"{\"x\":0,\"y\":0},{\"x\":5,\"y\":5,\"cMask\":[]},{\"x\":3,\"y\":1}],"
+			"\"segments\":[{\"v0\":0,\"v1\":1},{\"v0\":1,\"v1\":2},{\"v0\":3,\"v1\":0},"
+			"{\"v0\":2,\"v1\":5,\"curve\":30},{\"v0\":0,\"v1\":2,\"vis\":false,\"cMask\":[]}]}")));
+	assert(0 == hb_stadium_optimize(s, HB_OPTIMIZE_ALL, &r));
+	assert(r.vertexes_welded == 1 && r.vertexes_unreachable == 1);
+	assert(r.segments_degenerate == 1 && r.segments_unreachable == 1 && r.segments_merged == 1);
+	/* the vertex in the middle of the merged segment still collides */
+	assert(s->vertexes[0]->x == 0 && s->vertexes[1]->x == 1);
+	assert(s->vertexes[2]->x == 2 && s->vertexes[3]->x == 3 && !s->vertexes[4]);
+	assert(s->segments[0]->v0 == 0 && s->segments[0]->v1 == 2);
+	assert(s->segments[1]->v0 == 2 && s->segments[1]->v1 == 3 && !s->segments[2]);
+	hb_stadium_free(s);
+	/* segments of different traits stay apart, even when they agree now */
+	assert(NULL != (s = hb_stadium_parse("{\"name\":\"o\",\"width\":9,\"height\":9,"
+			"\"traits\":{\"a\":{\"bCoef\":0.5},\"b\":{\"bCoef\":0.5}},"
+			"\"vertexes\":[{\"x\":0,\"y\":0},{\"x\":10,\"y\":0},{\"x\":20,\"y\":0}],"
+			"\"segments\":[{\"v0\":0,\"v1\":1,\"trait\":\"a\"},{\"v0\":1,\"v1\":2,\"trait\":\"b\"}]}")));
+	assert(0 == hb_stadium_optimize(s, HB_OPTIMIZE_ALL, &r));
+	assert(r.segments_merged == 0);
+	assert(0 == hb_stadium_set_trait_field(s, "b", HB_TRAIT_FIELD_B_COEF, 2));
+	assert(s->segments[0]->b_coef == 0.5 && s->segments[1]->b_coef == 2);
+	hb_stadium_free(s);
+	/* borrowed sections are copied before they shrink */
+	assert(NULL != (s = _test_load("stadiums/chairs.json")));
+	assert(NULL != (c = hb_stadium_clone(s, 0)));
+	assert(0 == hb_stadium_optimize(c, HB_OPTIMIZE_ALL, &r));
+	assert(r.vertexes_welded + r.vertexes_unreachable > 0);
+	vertexes = segments = 0;
+	hb_stadium_vertexes_foreach(s, vertex) ++vertexes;
+	hb_stadium_segments_foreach(s, segment) ++segments;
+	hb_stadium_vertexes_foreach(c, vertex) --vertexes;
+	hb_stadium_segments_foreach(c, segment) --segments;
+	assert(vertexes == r.vertexes_welded + r.vertexes_unreachable);
+	assert(segments == r.segments_degenerate + r.segments_unreachable + r.segments_merged);
+	hb_stadium_free(c);
+	assert(0 == hb_stadium_optimize(s, 0, NULL));
+	hb_stadium_free(s);
+}
+
+static void
+test_transform(void)
+{
+	struct hb_stadium *s, *r;
+	struct hb_geometry *gs, *gr;
+	const double mirror[6] = { -1, 0, 0, 0, 1, 0 };
+	const double grow[6] = { 2, 0, 3, 0, 2, 10 };
+	const double turn[6] = { 0, -1, 0, 1, 0, 0 };
+	const double flat[6] = { 1, 2, 0, 2, 4, 0 };
+	size_t i;
+	assert(NULL != (s = _test_load("stadiums/futsal.json")));
+	assert(NULL != (r = hb_stadium_clone(s, 0)));
+	assert(-1 == hb_stadium_transform(r, flat));
+	assert(0 == hb_stadium_transform(r, mirror));
+	/* a mirrored arc has the mirrored center, not the one across its chord */
+	assert(NULL != (gs = hb_stadium_compile(s)));
+	assert(NULL != (gr = hb_stadium_compile(r)));
+	for (i = 0; i < gs->segments_count; ++i) {
+		assert(gs->arc[i] == gr->arc[i]);
+		if (!gs->arc[i])
+			continue;
+		assert(fabs(gs->center_x[i] + gr->center_x[i]) < 1e-9);
+		assert(fabs(gs->center_y[i] - gr->center_y[i]) < 1e-9);
+		assert(fabs(gs->radius[i] - gr->radius[i]) < 1e-9);
+	}
+	hb_geometry_free(gs);
+	hb_geometry_free(gr);
+	assert(0 == hb_stadium_transform(r, mirror));
+	assert(hb_stadium_equal(s, r));
+	hb_stadium_free(r);
+	hb_stadium_free(s);
+	assert(NULL != (s = hb_stadium_parse("{\"name\":\"t\",\"width\":9,\"height\":4,"
+			"\"planes\":[{\"normal\":[0,3],\"dist\":5}],"
+			"\"joints\":[],\"discs\":[{\"pos\":[1,1],\"radius\":2}]}")));
+	assert(0 == hb_stadium_transform(s, grow));
+	assert(s->width == 18 && s->height == 8);
+	assert(s->discs[1]->pos[0] == 5 && s->discs[1]->pos[1] == 12 && s->discs[1]->radius == 4);
+	assert(s->planes[0]->normal[0] == 0 && s->planes[0]->normal[1] == 1);
+	assert(s->planes[0]->dist == 20);
+	assert(0 == hb_stadium_transform(s, turn));
+	assert(s->width == 8 && s->height == 18);
+	assert(s->discs[1]->pos[0] == -12 && s->discs[1]->pos[1] == 5);
+	assert(s->planes[0]->normal[0] == -1 && s->planes[0]->normal[1] == 0);
+	assert(s->planes[0]->dist == 20);
+	hb_stadium_free(s);
+}
+
+static void
+test_tessellate(void)
+{
+	struct hb_stadium *s;
+	struct hb_geometry *g;
+	const struct hb_tessellation *t, *other;
+	const double mirror[6] = { -1, 0, 0, 0, 1, 0 };
+	unsigned long version;
+	size_t i, j, k;
+	double mx, my;
+	assert(NULL != (s = _test_load("stadiums/futsal.json")));
+	assert(NULL == hb_stadium_tessellate(s, 0));
+	assert(NULL != (t = hb_stadium_tessellate(s, 0.5)));
+	assert(t == hb_stadium_tessellate(s, 0.5));
+	assert(NULL != (g = hb_stadium_compile(s)));
+	assert(t->segments_count == g->segments_count);
+	for (i = 0; i < t->segments_count; ++i) {
+		k = t->offset[i];
+		if (!g->arc[i]) {
+			assert(t->count[i] == 2);
+			continue;
+		}
+		assert(t->count[i] > 2);
+		/* every point is on the arc and every chord stays close to it */
+		for (j = k; j < k + t->count[i]; ++j) {
+			assert(fabs(hypot(t->x[j] - g->center_x[i], t->y[j] - g->center_y[i]) - g->radius[i]) < 1e-6);
+			if (j + 1 == k + t->count[i])
+				continue;
+			mx = 0.5 * (t->x[j] + t->x[j + 1]);
+			my = 0.5 * (t->y[j] + t->y[j + 1]);
+			assert(g->radius[i] - hypot(mx - g->center_x[i], my - g->center_y[i]) <= 0.5);
+		}
+	}
+	hb_geometry_free(g);
+	/* anything that moves the geometry drops the cache */
+	version = s->version;
+	assert(0 == hb_stadium_transform(s, mirror));
+	assert(s->version != version && !s->tessellation);
+	assert(NULL != (t = hb_stadium_tessellate(s, 4)));
+	assert(t->max_error == 4);
+	/* another max_error leaves the first result alone */
+	assert(NULL != (other = hb_stadium_tessellate(s, 0.5)));
+	assert(other != t && other->max_error == 0.5);
+	assert(t == hb_stadium_tessellate(s, 4));
+	assert(t->max_error == 4 && t->segments_count == other->segments_count);
+	assert(other == hb_stadium_tessellate(s, 0.5));
+	/* a new max_error every call keeps only the last few */
+	for (i = 0; i < 100; ++i)
+		assert(NULL != (t = hb_stadium_tessellate(s, 1 + i * 0.01)));
+	for (k = 0, other = s->tessellation; other; other = other->next, ++k)
+		;
+	assert(k == HB_TESSELLATION_CACHE && s->tessellation == t);
+	assert(NULL != hb_stadium_tessellate(s, 1.98) && s->tessellation->max_error == 1.98);
+	hb_stadium_invalidate(s);
+	assert(!s->tessellation);
+	hb_stadium_free(s);
+}
+
+static void
+test_world(void)
+{
+	struct hb_stadium *s;
+	struct hb_world *w;
+	unsigned input, events;
+	size_t discs;
+	long player;
+	int i;
+	assert(NULL != (s = _test_load("stadiums/futsal.json")));
+	assert(NULL != (w = hb_world_create(s)));
+	hb_stadium_free(s);
+	assert(-1 == hb_world_add_player(w, HB_TEAM_SPECTATOR, 0, 0));
+	discs = w->discs_count;
+	assert(0 == (player = hb_world_add_player(w, HB_TEAM_RED, -100, 0)));
+	assert(w->players_count == 1 && w->discs_count == discs + 1);
+	/* a free ball only slows down */
+	w->speed_x[0] = 2;
+	assert(0 == hb_world_step(w, NULL));
+	assert(w->x[0] == 2 && w->speed_x[0] == 2 * w->damping[0]);
+	/* run at the ball and kick it, once per press */
+	input = HB_INPUT_RIGHT | HB_INPUT_KICK;
+	events = 0;
+	for (i = 0; i < 200 && !(events & HB_WORLD_EVENT_KICK); ++i)
+		events = hb_world_step(w, &input);
+	assert(events & HB_WORLD_EVENT_KICK);
+	assert(w->speed_x[0] > 3);
+	assert(!(hb_world_step(w, &input) & HB_WORLD_EVENT_KICK));
+	/* straight into the blue goal */
+	for (i = 0; i < 600 && !(events & HB_WORLD_EVENT_GOAL); ++i)
+		events = hb_world_step(w, NULL);
+	assert(events & HB_WORLD_EVENT_GOAL);
+	assert(w->goal_team[w->goal] == HB_TEAM_BLUE);
+	/* the net and the walls keep it in */
+	for (i = 0; i < 600; ++i)
+		hb_world_step(w, NULL);
+	assert(fabs(w->x[0]) < 700 && fabs(w->y[0]) < 400);
+	hb_world_remove_player(w, player);
+	assert(w->players_count == 0 && w->discs_count == discs);
+	hb_world_free(w);
+	/* a ball thrown around inside a ring of two arcs never leaves it */
+	assert(NULL != (s = hb_stadium_parse("{\"name\":\"r\",\"width\":9,\"height\":9,"
+			"\"vertexes\":[{\"x\":-100,\"y\":0},{\"x\":100,\"y\":0}],"
+			"\"segments\":[{\"v0\":0,\"v1\":1,\"curve\":180},{\"v0\":1,\"v1\":0,\"curve\":180}],"
+			"\"discs\":[{\"pos\":[0,40],\"radius\":10},{\"pos\":[50,40],\"radius\":5}],"
+			"\"joints\":[{\"d0\":1,\"d1\":2,\"length\":30}]}")));
+	assert(NULL != (w = hb_world_create(s)));
+	hb_stadium_free(s);
+	assert(w->joints->count == 1);
+	w->speed_x[0] = 7;
+	w->speed_y[0] = 3;
+	w->speed_x[1] = -5;
+	for (i = 0; i < 1000; ++i) {
+		hb_world_step(w, NULL);
+		assert(hypot(w->x[0], w->y[0]) < 100);
+		assert(hypot(w->x[1] - w->x[2], w->y[1] - w->y[2]) < 30 + 1e-6);
+	}
+	hb_world_free(w);
+}
+
+static void
+test_static_grid(void)
+{
+	struct hb_stadium *s;
+	struct hb_geometry *g;
+	struct hb_static_grid *grid;
+	struct hb_world *a, *b;
+	uint32_t *segments, *vertexes, seed;
+	size_t nsegments, nvertexes, i, k, c;
+	unsigned inputs[6];
+	double x, y, pad;
+	assert(NULL != (s = _test_load("stadiums/fish_hunt.json")));
+	assert(NULL == hb_static_grid_build(s, 0));
+	assert(NULL != (grid = hb_static_grid_build(s, 40)));
+	assert(NULL != (g = hb_stadium_compile(s)));
+	assert(NULL != (segments = malloc(grid->segments_count * sizeof(*segments))));
+	assert(NULL != (vertexes = malloc(grid->vertexes_count * sizeof(*vertexes))));
+	/* every wall touching the box comes back, sorted and once */
+	for (i = 0, seed = 1; i < 2000; ++i) {
+		x = _test_random(&seed, -850, 850);
+		y = _test_random(&seed, -450, 450);
+		hb_static_grid_query(grid, x - 30, y - 30, x + 30, y + 30,
+				segments, &nsegments, vertexes, &nvertexes);
+		for (c = 1; c < nsegments; ++c)
+			assert(segments[c - 1] < segments[c]);
+		for (c = 1; c < nvertexes; ++c)
+			assert(vertexes[c - 1] < vertexes[c]);
+		for (k = 0, c = 0; k < g->segments_count; ++k) {
+			pad = fabs(g->bias[k]);
+			if (g->min_x[k] - pad > x + 30 || g->max_x[k] + pad < x - 30 ||
+					g->min_y[k] - pad > y + 30 || g->max_y[k] + pad < y - 30)
+				continue;
+			while (c < nsegments && segments[c] < k)
+				++c;
+			assert(c < nsegments && segments[c] == k);
+		}
+		for (k = 0, c = 0; k < g->vertexes_count; ++k) {
+			if (fabs(g->vertex_x[k] - x) > 30 || fabs(g->vertex_y[k] - y) > 30)
+				continue;
+			while (c < nvertexes && vertexes[c] < k)
+				++c;
+			assert(c < nvertexes && vertexes[c] == k);
+		}
+	}
+	hb_static_grid_query(grid, 1e6, 1e6, 1e6 + 1, 1e6 + 1,
+			segments, &nsegments, vertexes, &nvertexes);
+	assert(nsegments == 0 && nvertexes == 0);
+	free(segments);
+	free(vertexes);
+	hb_geometry_free(g);
+	hb_static_grid_free(grid);
+	/* a world stepping through the grid matches one testing every wall */
+	assert(NULL != (a = hb_world_create(s)));
+	assert(NULL != (b = hb_world_create(s)));
+	hb_stadium_free(s);
+	hb_static_grid_free(b->grid);
+	b->grid = NULL;
+	for (i = 0; i < 6; ++i) {
+		assert(hb_world_add_player(a, i & 1 ? HB_TEAM_BLUE : HB_TEAM_RED, i * 60.0 - 150, 0) >= 0);
+		assert(hb_world_add_player(b, i & 1 ? HB_TEAM_BLUE : HB_TEAM_RED, i * 60.0 - 150, 0) >= 0);
+	}
+	for (i = 0; i < 3000; ++i) {
+		for (k = 0; k < 6; ++k)
+			inputs[k] = (i / 40 + k * 5) % 32;
+		assert(hb_world_step(a, inputs) == hb_world_step(b, inputs));
+	}
+	assert(!memcmp(a->x, b->x, a->discs_count * sizeof(double)));
+	assert(!memcmp(a->y, b->y, a->discs_count * sizeof(double)));
+	assert(!memcmp(a->speed_x, b->speed_x, a->discs_count * sizeof(double)));
+	hb_world_free(a);
+	hb_world_free(b);
+}
+
+static void
+test_sweep(void)
+{
+	struct hb_stadium *s;
+	struct hb_sweep *sp;
+	struct hb_world *a, *b;
+	struct hb_collision_table *classes;
+	enum hb_collision_flags group[64], mask[64];
+	double x[64], y[64], r[64];
+	uint32_t seed, c_class[64];
+	size_t i, j, k, c, n;
+	unsigned inputs[6];
+	assert(NULL != (sp = hb_sweep_create()));
+	assert(NULL != (classes = hb_collision_table_create()));
+	for (i = 0, seed = 7; i < 64; ++i) {
+		x[i] = _test_random(&seed, 0, 400);
+		y[i] = _test_random(&seed, 0, 400);
+		r[i] = 5 + i % 7;
+		group[i] = i % 3 ? HB_COLLISION_RED : HB_COLLISION_BALL;
+		mask[i] = i % 5 ? HB_COLLISION_ALL : HB_COLLISION_WALL;
+		c_class[i] = hb_collision_table_add(classes, group[i], mask[i]);
+	}
+	/* the same pairs a test of every pair finds, whatever the count */
+	for (n = 64; n > 0; n = n > 40 ? 17 : n > 10 ? 3 : 0) {
+		for (k = 0; k < 10; ++k) {
+			assert(hb_sweep_update(sp, n, x, y, r, c_class, classes, 1) == 0);
+			for (i = 0; i < n; ++i) {
+				c = sp->start[i];
+				for (j = i + 1; j < n; ++j) {
+					if (fabs(x[i] - x[j]) <= r[i] + r[j] + 2 &&
+							fabs(y[i] - y[j]) <= r[i] + r[j] + 2 &&
+							(group[i] & mask[j]) && (mask[i] & group[j]))
+						assert(c < sp->start[i + 1] && sp->partner[c++] == j);
+				}
+				assert(c == sp->start[i + 1]);
+			}
+			for (i = 0; i < 64; ++i)
+				x[i] += (i & 1 ? 3.0 : -3.0) * (k & 1 ? 1 : -1) * (double)(i % 4);
+		}
+	}
+	hb_sweep_free(sp);
+	hb_collision_table_free(classes);
+	/* a world stepping through the sweep matches one testing every pair */
+	assert(NULL != (s = _test_load("stadiums/fish_hunt.json")));
+	assert(NULL != (a = hb_world_create(s)));
+	assert(NULL != (b = hb_world_create(s)));
+	hb_stadium_free(s);
+	hb_sweep_free(b->sweep);
+	b->sweep = NULL;
+	for (i = 0; i < 6; ++i) {
+		assert(hb_world_add_player(a, i & 1 ? HB_TEAM_BLUE : HB_TEAM_RED, i * 60.0 - 150, 0) >= 0);
+		assert(hb_world_add_player(b, i & 1 ? HB_TEAM_BLUE : HB_TEAM_RED, i * 60.0 - 150, 0) >= 0);
+	}
+	for (i = 0; i < 3000; ++i) {
+		for (k = 0; k < 6; ++k)
+			inputs[k] = (i / 40 + k * 3) % 32;
+		if (i == 1500) {
+			hb_world_remove_player(a, 2);
+			hb_world_remove_player(b, 2);
+		}
+		assert(hb_world_step(a, inputs) == hb_world_step(b, inputs));
+	}
+	assert(!memcmp(a->x, b->x, a->discs_count * sizeof(double)));
+	assert(!memcmp(a->y, b->y, a->discs_count * sizeof(double)));
+	assert(!memcmp(a->speed_x, b->speed_x, a->discs_count * sizeof(double)));
+	hb_world_free(a);
+	hb_world_free(b);
+}
+
+static void
+test_collision_table(void)
+{
+	struct hb_collision_table *t;
+	struct hb_stadium *s;
+	struct hb_geometry *g;
+	struct hb_world *w;
+	enum hb_collision_flags group, mask;
+	uint32_t classes[1];
+	long a, b, c, i, j;
+	assert(NULL != (t = hb_collision_table_create()));
+	assert((a = hb_collision_table_add(t, HB_COLLISION_BALL, HB_COLLISION_ALL)) == 0);
+	assert((b = hb_collision_table_add(t, HB_COLLISION_RED, HB_COLLISION_WALL)) == 1);
+	assert((c = hb_collision_table_add(t, HB_COLLISION_WALL, HB_COLLISION_ALL)) == 2);
+	assert(hb_collision_table_add(t, HB_COLLISION_RED, HB_COLLISION_WALL) == b);
+	assert(hb_collision_table_test(t, a, a) && !hb_collision_table_test(t, a, b));
+	assert(hb_collision_table_test(t, b, c) && hb_collision_table_test(t, c, b));
+	/* past the first word of a row */
+	for (i = 3; i < 200; ++i) {
+		group = 1u << (i % 6);
+		mask = (enum hb_collision_flags)(i * 2654435761u) & HB_COLLISION_ALL;
+		assert((c = hb_collision_table_add(t, group, mask)) >= 0);
+		assert(t->c_group[c] == group && t->c_mask[c] == mask);
+	}
+	for (i = 0; i < (long)t->count; ++i)
+		for (j = 0; j < (long)t->count; ++j)
+			assert(!hb_collision_table_test(t, i, j) ==
+					(!(t->c_group[i] & t->c_mask[j]) || !(t->c_mask[i] & t->c_group[j])));
+	hb_collision_table_free(t);
+	/* walls only a disc of one class hits are dropped without it */
+	assert(NULL != (s = _test_load("stadiums/futsal.json")));
+	assert(NULL != (g = hb_stadium_compile(s)));
+	assert(NULL != (t = hb_collision_table_create()));
+	assert(hb_geometry_classify(g, t) == 0);
+	classes[0] = hb_collision_table_add(t, HB_COLLISION_RED, HB_COLLISION_ALL);
+	b = g->segments_count + g->vertexes_count + g->planes_count;
+	a = hb_geometry_drop_unreachable(g, t, classes, 1);
+	assert(a > 0 && (long)(g->segments_count + g->vertexes_count + g->planes_count) == b - a);
+	for (i = 0; i < (long)g->segments_count; ++i)
+		assert(g->c_group[i] & HB_COLLISION_ALL && g->c_mask[i] & HB_COLLISION_RED);
+	hb_geometry_free(g);
+	hb_collision_table_free(t);
+	/* a world keeps the walls one of its discs or a player can hit */
+	assert(NULL != (w = hb_world_create(s)));
+	assert(hb_world_add_player(w, HB_TEAM_RED, 0, 0) == 0);
+	assert(hb_world_add_player(w, HB_TEAM_BLUE, 0, 0) == 1);
+	for (i = 0; i < (long)w->geometry->segments_count; ++i) {
+		for (j = 0; j < (long)w->discs_count; ++j)
+			if (hb_collision_table_test(w->classes, w->c_class[j], w->geometry->c_class[i]))
+				break;
+		assert(j < (long)w->discs_count);
+	}
+	hb_world_free(w);
+	hb_stadium_free(s);
+}
+
+/* the segment test of hb_world_step, one segment at a time */
+static bool
+_test_segment_hit(const struct hb_geometry *g, size_t k, double x, double y, double r)
+{
+	double dx, dy, dist, bias;
+	if (!g->arc[k]) {
+		if ((x - g->v0_x[k]) * (g->v1_x[k] - g->v0_x[k]) +
+				(y - g->v0_y[k]) * (g->v1_y[k] - g->v0_y[k]) <= 0 ||
+				(x - g->v1_x[k]) * (g->v1_x[k] - g->v0_x[k]) +
+				(y - g->v1_y[k]) * (g->v1_y[k] - g->v0_y[k]) >= 0)
+			return false;
+		dist = g->normal_x[k] * (x - g->v0_x[k]) + g->normal_y[k] * (y - g->v0_y[k]);
+	} else {
+		dx = x - g->center_x[k];
+		dy = y - g->center_y[k];
+		if (!hb_geometry_arc_contains(g, k, dx, dy) || dx * dx + dy * dy == 0)
+			return false;
+		dist = g->radius[k] - sqrt(dx * dx + dy * dy);
+	}
+	bias = g->bias[k];
+	if (bias == 0)
+		dist = fabs(dist);
+	else if (bias < 0)
+		dist = -dist;
+	return (bias == 0 || dist >= -fabs(bias)) && dist < r;
+}
+
+static void
+test_narrowphase(void)
+{
+	struct hb_stadium *s;
+	struct hb_geometry *g;
+	uint32_t index[HB_NARROWPHASE_BATCH], seed;
+	double x, y, r, depth[HB_NARROWPHASE_BATCH], one;
+	size_t i, j, n, hits;
+	unsigned bits;
+	assert(NULL != (s = _test_load("stadiums/fish_hunt.json")));
+	assert(NULL != (g = hb_stadium_compile(s)));
+	hb_stadium_free(s);
+	for (i = 0, seed = 3, hits = 0; i < 20000; ++i) {
+		x = _test_random(&seed, -850, 850);
+		y = _test_random(&seed, -450, 450);
+		r = 5 + i % 30;
+		n = 1 + i % HB_NARROWPHASE_BATCH;
+		/* a batch says what each wall says alone */
+		for (j = 0; j < n; ++j)
+			index[j] = (i * 7 + j * 31) % g->segments_count;
+		bits = hb_narrowphase_segments(g, index, n, x, y, r, depth);
+		for (j = 0; j < n; ++j) {
+			assert(!!(bits >> j & 1) == _test_segment_hit(g, index[j], x, y, r));
+			assert(hb_narrowphase_segments(g, index + j, 1, x, y, r, &one) == (bits >> j & 1));
+			if (bits >> j & 1)
+				assert(depth[j] == one && depth[j] > 0);
+			hits += bits >> j & 1;
+		}
+		for (j = 0; j < n; ++j)
+			index[j] = (i * 5 + j * 17) % g->vertexes_count;
+		bits = hb_narrowphase_vertexes(g, index, n, x, y, r, depth);
+		for (j = 0; j < n; ++j) {
+			one = hypot(x - g->vertex_x[index[j]], y - g->vertex_y[index[j]]);
+			assert(!!(bits >> j & 1) == (one > 0 && one <= r));
+			if (bits >> j & 1)
+				assert(fabs(depth[j] - (r - one)) < 1e-9);
+		}
+		assert(bits >> n == 0);
+	}
+	assert(hits > 0);
+	hb_geometry_free(g);
+	/* planes of a box, the disc is only into the ones it is past */
+	assert(NULL != (s = _test_load("stadiums/futsal.json")));
+	assert(NULL != (g = hb_stadium_compile(s)));
+	hb_stadium_free(s);
+	for (j = 0; j < g->planes_count && j < HB_NARROWPHASE_BATCH; ++j)
+		index[j] = j;
+	bits = hb_narrowphase_planes(g, index, j, 0, 0, 10, depth);
+	for (i = 0; i < j; ++i)
+		assert(!!(bits >> i & 1) == (g->plane_dist[i] - 0 + 10 > 0));
+	hb_geometry_free(g);
+}
+
+static void
+test_ccd(void)
+{
+	struct hb_stadium *s;
+	struct hb_geometry *g;
+	struct hb_world *w;
+	struct hb_ccd_hit hit;
+	double y, v;
+	size_t d;
+	int i;
+	assert(NULL != (s = hb_stadium_parse("{\"name\":\"c\",\"width\":9,\"height\":9,"
+			"\"vertexes\":[{\"x\":0,\"y\":-100},{\"x\":0,\"y\":100},"
+			"{\"x\":200,\"y\":-100},{\"x\":200,\"y\":100}],"
+			"\"segments\":[{\"v0\":0,\"v1\":1},{\"v0\":2,\"v1\":3,\"curve\":90,\"bias\":-1}],"
+			"\"planes\":[{\"normal\":[0,1],\"dist\":-300}],"
+			"\"discs\":[{\"pos\":[-50,0],\"radius\":10,\"damping\":1}]}")));
+	assert(NULL != (g = hb_stadium_compile(s)));
+	/* a thin wall is met at its side, from either side */
+	assert(hb_ccd_segment(g, 0, -50, 0, 200, 0, 10, &hit));
+	assert(fabs(hit.t - 0.2) < 1e-12 && hit.normal_x == -1);
+	assert(hb_ccd_segment(g, 0, 50, 0, -200, 0, 10, &hit));
+	assert(fabs(hit.t - 0.2) < 1e-12 && hit.normal_x == 1);
+	assert(!hb_ccd_segment(g, 0, -50, 0, 20, 0, 10, &hit));
+	assert(!hb_ccd_segment(g, 0, -50, 0, -200, 0, 10, &hit));
+	/* past its ends it is the vertexes that are hit */
+	assert(!hb_ccd_segment(g, 0, -50, 150, 200, 0, 10, &hit));
+	assert(hb_ccd_vertex(g, 1, -50, 100, 200, 0, 10, &hit));
+	assert(fabs(hit.t - 0.2) < 1e-12 && fabs(hit.normal_x + 1) < 1e-12);
+	/* a disc already into a wall is left to the collision step */
+	assert(!hb_ccd_segment(g, 0, -5, 0, 200, 0, 10, &hit));
+	/* the arc bulges right of v0 -> v1, only its outside counts */
+	assert(hb_ccd_segment(g, 1, 400, 0, -400, 0, 10, &hit));
+	assert(hit.normal_x > 0.99 && 400 - 400 * hit.t > 200 + 10);
+	assert(!hb_ccd_segment(g, 1, 200, 0, 400, 0, 10, &hit));
+	assert(hb_ccd_plane(g, 0, 0, 0, 0, -400, 10, &hit));
+	assert(fabs(hit.t - 0.725) < 1e-12 && hit.normal_y == 1);
+	hb_geometry_free(g);
+	/* a ball faster than its radius per tick bounces off the thin wall */
+	assert(NULL != (w = hb_world_create(s)));
+	hb_stadium_free(s);
+	assert(!w->ccd);
+	w->ccd = true;
+	/* the ball comes first, the disc given is the one after it */
+	d = w->discs_count - 1;
+	w->speed_x[d] = 150;
+	hb_world_step(w, NULL);
+	assert(w->x[d] < -10 && w->speed_x[d] < 0);
+	w->speed_x[d] = 0;
+	w->speed_y[d] = -500;
+	for (i = 0; i < 10; ++i) {
+		hb_world_step(w, NULL);
+		assert(w->x[d] < -10 && w->y[d] >= -290 - 1e-9);
+	}
+	hb_world_free(w);
+	/* off, the ball moves into the top wall and is pushed back out the
+	   way the game does it, not stopped where it first touches */
+	assert(NULL != (s = _test_load("stadiums/futsal.json")));
+	assert(NULL != (w = hb_world_create(s)));
+	hb_stadium_free(s);
+	w->x[0] = 100;
+	w->y[0] = y = -220;
+	w->speed_y[0] = v = -8;
+	for (i = 0; i < 2; ++i) {
+		hb_world_step(w, NULL);
+		y += v;
+		v *= w->damping[0];
+	}
+	assert(y + w->radius[0] > -240);
+	v -= v * (1 + w->b_coef[0] * 1);
+	assert(fabs(w->y[0] - (-240 + w->radius[0])) < 1e-9);
+	assert(fabs(w->speed_y[0] - v) < 1e-9 && w->x[0] == 100);
+	w->ccd = true;
+	w->y[0] = -220;
+	w->speed_y[0] = -8;
+	hb_world_step(w, NULL);
+	hb_world_step(w, NULL);
+	assert(fabs(w->y[0] - (-240 + w->radius[0])) > 1e-3);
+	hb_world_free(w);
+}
+
+/* the joint solver of the game, one joint at a time */
+static void
+_test_solve_joint(const struct hb_joints *j, size_t k, double *x, double *y,
+		double *speed_x, double *speed_y, const double *inv_mass)
+{
+	double dx, dy, dist, share, target, off, v, f;
+	size_t a, b;
+	int side;
+	a = j->d0[k];
+	b = j->d1[k];
+	dx = x[a] - x[b];
+	dy = y[a] - y[b];
+	dist = sqrt(dx * dx + dy * dy);
+	if (dist <= 0)
+		return;
+	dx /= dist;
+	dy /= dist;
+	share = inv_mass[a] / (inv_mass[a] + inv_mass[b]);
+	if (share != share)
+		share = 0.5;
+	if (j->min[k] >= j->max[k]) {
+		target = j->min[k];
+		side = 0;
+	} else if (dist <= j->min[k]) {
+		target = j->min[k];
+		side = 1;
+	} else if (dist >= j->max[k]) {
+		target = j->max[k];
+		side = -1;
+	} else {
+		return;
+	}
+	off = dist - target;
+	if (isinf(j->strength[k])) {
+		x[a] -= dx * off * share;
+		y[a] -= dy * off * share;
+		x[b] += dx * off * (1 - share);
+		y[b] += dy * off * (1 - share);
+		v = dx * (speed_x[a] - speed_x[b]) + dy * (speed_y[a] - speed_y[b]);
+		if (side == 0 || v * side < 0) {
+			speed_x[a] -= dx * v * share;
+			speed_y[a] -= dy * v * share;
+			speed_x[b] += dx * v * (1 - share);
+			speed_y[b] += dy * v * (1 - share);
+		}
+	} else {
+		f = off * j->strength[k];
+		speed_x[a] -= dx * f * inv_mass[a];
+		speed_y[a] -= dy * f * inv_mass[a];
+		speed_x[b] += dx * f * inv_mass[b];
+		speed_y[b] += dy * f * inv_mass[b];
+	}
+}
+
+static void
+test_joints(void)
+{
+	struct hb_stadium *s;
+	struct hb_joints *j;
+	double x[9], y[9], sx[9], sy[9], rx[9], ry[9], rsx[9], rsy[9], m[9];
+	size_t b, k, i, n, seen;
+	uint32_t seed;
+	bool used[9];
+	/* a chain of eight discs, rigid and elastic, fixed, ranged and auto,
+	   tied across as well */
+	assert(NULL != (s = hb_stadium_parse("{\"name\":\"j\",\"width\":9,\"height\":9,"
+			"\"discs\":[{\"pos\":[0,0]},{\"pos\":[20,0]},{\"pos\":[40,0]},"
+			"{\"pos\":[60,0]},{\"pos\":[80,0],\"invMass\":0},{\"pos\":[100,0],\"invMass\":0},"
+			"{\"pos\":[120,0],\"invMass\":2},{\"pos\":[140,0]}],"
+			"\"joints\":[{\"d0\":1,\"d1\":2},{\"d0\":2,\"d1\":3,\"length\":25,\"strength\":0.1},"
+			"{\"d0\":3,\"d1\":4,\"length\":[10,30]},{\"d0\":4,\"d1\":5,\"strength\":0.5},"
+			"{\"d0\":5,\"d1\":6,\"length\":[30,40]},{\"d0\":6,\"d1\":7,\"length\":15},"
+			"{\"d0\":7,\"d1\":8,\"length\":[5,10],\"strength\":0.2},{\"d0\":1,\"d1\":3},"
+			"{\"d0\":2,\"d1\":4,\"length\":50},{\"d0\":5,\"d1\":8},{\"d0\":1,\"d1\":8}]}")));
+	for (i = 0; i < 9; ++i) {
+		x[i] = i ? s->discs[i]->pos[0] : 0;
+		y[i] = 0;
+	}
+	assert(NULL != (j = hb_joints_build(s, x, y, 9)));
+	assert(j->count == 11 && j->start[0] == 0 && j->start[j->batches_count] == 11);
+	/* no two joints of a batch share a disc */
+	for (b = 0, seen = 0; b < j->batches_count; ++b) {
+		memset(used, 0, sizeof(used));
+		assert(j->start[b] < j->start[b + 1]);
+		for (k = j->start[b]; k < j->start[b + 1]; ++k) {
+			assert(!used[j->d0[k]] && !used[j->d1[k]]);
+			used[j->d0[k]] = used[j->d1[k]] = true;
+			if (j->d0[k] == 1 && j->d1[k] == 2)
+				assert(j->min[k] == 20 && j->max[k] == 20 && isinf(j->strength[k]));
+			if (j->d0[k] == 1 && j->d1[k] == 8)
+				assert(j->min[k] == 140 && j->max[k] == 140);
+			if (j->d0[k] == 4 && j->d1[k] == 5)
+				assert(j->min[k] == 20 && j->strength[k] == 0.5);
+			++seen;
+		}
+	}
+	assert(seen == 11);
+	/* a pass does what solving the joints one by one does */
+	for (n = 0, seed = 7; n < 200; ++n) {
+		for (i = 0; i < 9; ++i) {
+			rx[i] = x[i] = i * 20 + _test_random(&seed, -20, 20);
+			ry[i] = y[i] = _test_random(&seed, -20, 20);
+			rsx[i] = sx[i] = _test_random(&seed, -2, 2);
+			rsy[i] = sy[i] = _test_random(&seed, -2, 2);
+			m[i] = i == 0 || i == 5 || i == 6 ? 0 : i == 7 ? 2 : 1;
+		}
+		hb_joints_solve(j, x, y, sx, sy, m);
+		for (k = 0; k < j->count; ++k)
+			_test_solve_joint(j, k, rx, ry, rsx, rsy, m);
+		for (i = 0; i < 9; ++i)
+			assert(fabs(x[i] - rx[i]) < 1e-9 && fabs(y[i] - ry[i]) < 1e-9 &&
+					fabs(sx[i] - rsx[i]) < 1e-9 && fabs(sy[i] - rsy[i]) < 1e-9);
+	}
+	hb_joints_free(j);
+	hb_stadium_free(s);
+}
+
+static void
+test_predict(void)
+{
+	struct hb_stadium *s;
+	struct hb_world *w;
+	double positions[2 * 600];
+	size_t n, discs, capacity, t;
+	assert(NULL != (s = _test_load("stadiums/futsal.json")));
+	assert(NULL != (w = hb_world_create(s)));
+	hb_stadium_free(s);
+	discs = w->discs_count;
+	capacity = w->discs_capacity;
+	/* bouncing between the top and bottom walls, as the world has it */
+	w->speed_x[0] = 0.5;
+	w->speed_y[0] = -9;
+	assert(hb_world_predict_disc(w, 0, 600, positions) == 600);
+	/* the world is only read */
+	assert(w->discs_count == discs && w->discs_capacity == capacity);
+	assert(w->x[0] == 0 && w->y[0] == 0 && w->speed_y[0] == -9);
+	for (t = 0; t < 600; ++t) {
+		hb_world_step(w, NULL);
+		assert(positions[2 * t] == w->x[0] && positions[2 * t + 1] == w->y[0]);
+	}
+	/* straight into the red goal, the prediction stops at the line */
+	w->x[0] = w->y[0] = 0;
+	w->speed_x[0] = -8;
+	w->speed_y[0] = 0;
+	n = hb_world_predict_disc(w, 0, 600, positions);
+	assert(n > 0 && n < 600);
+	for (t = 0; t < n; ++t)
+		assert(!(hb_world_step(w, NULL) & HB_WORLD_EVENT_GOAL) == (t + 1 < n));
+	assert(positions[2 * (n - 1)] == w->x[0] && w->goal_team[w->goal] == HB_TEAM_RED);
+	assert(hb_world_predict_disc(w, discs, 600, positions) == 0);
+	hb_world_free(w);
+}
+
+static void
+test_sdf(void)
+{
+	struct hb_stadium *s;
+	struct hb_sdf *sdf;
+	/* a box, a wall only red collides with and a plane under the box */
+	assert(NULL != (s = hb_stadium_parse("{\"name\":\"f\",\"width\":9,\"height\":9,"
+			"\"vertexes\":[{\"x\":-100,\"y\":-50},{\"x\":100,\"y\":-50},"
+			"{\"x\":100,\"y\":50},{\"x\":-100,\"y\":50},"
+			"{\"x\":50,\"y\":-50,\"cMask\":[]},{\"x\":50,\"y\":50,\"cMask\":[]}],"
+			"\"segments\":[{\"v0\":0,\"v1\":1},{\"v0\":1,\"v1\":2},{\"v0\":2,\"v1\":3},"
+			"{\"v0\":3,\"v1\":0},{\"v0\":4,\"v1\":5,\"cMask\":[\"red\"]}],"
+			"\"planes\":[{\"normal\":[0,1],\"dist\":-53}]}")));
+	assert(NULL == hb_stadium_build_sdf(s, 0, HB_COLLISION_BALL));
+	assert(NULL != (sdf = hb_stadium_build_sdf(s, 5, HB_COLLISION_BALL)));
+	assert(sdf->resolution == 5 && sdf->min_x == -105 && sdf->min_y == -55);
+	assert(hb_sdf_sample(sdf, 0, 0) == 50);
+	assert(hb_sdf_sample(sdf, 40, 0) == 50);
+	assert(hb_sdf_sample(sdf, -95, 45) == 5);
+	/* between samples the distance is interpolated */
+	assert(fabs(hb_sdf_sample(sdf, 2.5, 47.5) - 2.5) < 1e-12);
+	/* past the plane it goes negative, off the grid the edge is kept */
+	assert(hb_sdf_sample(sdf, 0, -55) == -2);
+	assert(hb_sdf_sample(sdf, 0, -500) == -2);
+	assert(hb_sdf_sample(sdf, 1000, 0) == hb_sdf_sample(sdf, 105, 0));
+	hb_sdf_free(sdf);
+	assert(NULL != (sdf = hb_stadium_build_sdf(s, 5, HB_COLLISION_RED)));
+	assert(hb_sdf_sample(sdf, 40, 0) == 10);
+	assert(fabs(hb_sdf_sample(sdf, 50, 20)) < 1e-9);
+	hb_sdf_free(sdf);
+	assert(NULL != (sdf = hb_stadium_build_sdf(s, 5, HB_COLLISION_KICK)));
+	assert(isinf(hb_sdf_sample(sdf, 0, 0)));
+	hb_sdf_free(sdf);
+	/* a tiny resolution is made larger */
+	assert(NULL != (sdf = hb_stadium_build_sdf(s, 1e-6, HB_COLLISION_BALL)));
+	assert(sdf->columns * sdf->rows <= 1 << 22);
+	hb_sdf_free(sdf);
+	hb_stadium_free(s);
+	/* a ring of two arcs */
+	assert(NULL != (s = hb_stadium_parse("{\"name\":\"r\",\"width\":9,\"height\":9,"
+			"\"vertexes\":[{\"x\":-100,\"y\":0},{\"x\":100,\"y\":0}],"
+			"\"segments\":[{\"v0\":0,\"v1\":1,\"curve\":180},{\"v0\":1,\"v1\":0,\"curve\":180}]}")));
+	assert(NULL != (sdf = hb_stadium_build_sdf(s, 10, HB_COLLISION_BALL)));
+	assert(fabs(hb_sdf_sample(sdf, 0, 0) - 100) < 1e-9);
+	assert(fabs(hb_sdf_sample(sdf, 30, 40) - 50) < 1e-9);
+	assert(fabs(hb_sdf_sample(sdf, -60, -80)) < 1e-9);
+	assert(fabs(hb_sdf_sample(sdf, 0, 33) - 67) < 0.5);
+	hb_sdf_free(sdf);
+	hb_stadium_free(s);
+	/* a bias makes the side behind a wall negative as deep as it goes */
+	assert(NULL != (s = hb_stadium_parse("{\"name\":\"b\",\"width\":9,\"height\":90,"
+			"\"vertexes\":[{\"x\":-100,\"y\":0,\"cMask\":[]},{\"x\":100,\"y\":0,\"cMask\":[]}],"
+			"\"segments\":[{\"v0\":0,\"v1\":1,\"bias\":10}]}")));
+	assert(NULL != (sdf = hb_stadium_build_sdf(s, 10, HB_COLLISION_BALL)));
+	assert(fabs(hb_sdf_sample(sdf, 0, 20) - 20) < 1e-9);
+	assert(fabs(hb_sdf_sample(sdf, 0, -10) + 10) < 1e-9);
+	assert(fabs(hb_sdf_sample(sdf, 0, -20) - 20) < 1e-9);
+	/* past its ends the nearer end counts on either side */
+	assert(fabs(hb_sdf_sample(sdf, 110, -10) - sqrt(200)) < 1e-9);
+	hb_sdf_free(sdf);
+	hb_stadium_free(s);
+	assert(NULL != (s = hb_stadium_parse("{\"name\":\"r\",\"width\":9,\"height\":9,"
+			"\"vertexes\":[{\"x\":-100,\"y\":0},{\"x\":100,\"y\":0}],"
+			"\"segments\":[{\"v0\":0,\"v1\":1,\"curve\":180,\"bias\":10},"
+			"{\"v0\":1,\"v1\":0,\"curve\":180,\"bias\":10}]}")));
+	assert(NULL != (sdf = hb_stadium_build_sdf(s, 10, HB_COLLISION_BALL)));
+	assert(fabs(hb_sdf_sample(sdf, 0, 0) - 100) < 1e-9);
+	assert(fabs(hb_sdf_sample(sdf, 0, -110) + 10) < 1e-9);
+	hb_sdf_free(sdf);
+	hb_stadium_free(s);
+}
+
+/* the first wall a cast meets, trying every wall in turn */
+static struct hb_cast_hit
+_test_cast(const struct hb_geometry *g, const struct hb_ray *ray, double r,
+		enum hb_collision_flags mask)
+{
+	struct hb_cast_hit best = { .t = 1, .element = HB_CAST_NONE };
+	struct hb_ccd_hit hit;
+	size_t k;
+	for (k = 0; k < g->planes_count; ++k) {
+		if (!(g->plane_c_mask[k] & mask) ||
+				!hb_ccd_plane(g, k, ray->x, ray->y, ray->dx, ray->dy, r, &hit) ||
+				(best.element != HB_CAST_NONE && hit.t >= best.t))
+			continue;
+		best.t = hit.t;
+		best.element = HB_CAST_PLANE;
+		best.index = k;
+	}
+	for (k = 0; k < g->segments_count; ++k) {
+		if (!(g->c_mask[k] & mask) ||
+				!hb_ccd_segment(g, k, ray->x, ray->y, ray->dx, ray->dy, r, &hit) ||
+				(best.element != HB_CAST_NONE && hit.t >= best.t))
+			continue;
+		best.t = hit.t;
+		best.element = HB_CAST_SEGMENT;
+		best.index = k;
+	}
+	for (k = 0; r > 0 && k < g->vertexes_count; ++k) {
+		if (!(g->vertex_c_mask[k] & mask) ||
+				!hb_ccd_vertex(g, k, ray->x, ray->y, ray->dx, ray->dy, r, &hit) ||
+				(best.element != HB_CAST_NONE && hit.t >= best.t))
+			continue;
+		best.t = hit.t;
+		best.element = HB_CAST_VERTEX;
+		best.index = k;
+	}
+	return best;
+}
+
+static void
+test_cast(void)
+{
+	struct hb_stadium *s;
+	struct hb_cast_index *index;
+	struct hb_ray rays[37];
+	struct hb_cast_hit hits[37], one;
+	uint32_t seed;
+	size_t i, j, found;
+	long count;
+	double r;
+	assert(NULL != (s = hb_stadium_parse("{\"name\":\"c\",\"width\":9,\"height\":9,"
+			"\"vertexes\":[{\"x\":0,\"y\":-100},{\"x\":0,\"y\":100},{\"x\":0,\"y\":200}],"
+			"\"segments\":[{\"v0\":0,\"v1\":1}],"
+			"\"planes\":[{\"normal\":[-1,0],\"dist\":-300,\"cMask\":[\"red\"]}]}")));
+	assert(NULL != (index = hb_cast_index_build(s, 50)));
+	hb_stadium_free(s);
+	rays[0] = (struct hb_ray){ -50, 0, 400, 0 };
+	rays[1] = (struct hb_ray){ -50, 0, -400, 0 };
+	rays[2] = (struct hb_ray){ -50, 200, 400, 0 };
+	/* the wall stops the ray, the plane only stops red */
+	assert(hb_raycast_batch(index, rays, 3, HB_COLLISION_BALL, hits) == 1);
+	assert(hits[0].element == HB_CAST_SEGMENT && hits[0].index == 0);
+	assert(fabs(hits[0].distance - 50) < 1e-9 && hits[0].normal_x == -1);
+	assert(hits[1].element == HB_CAST_NONE && hits[1].t == 1);
+	assert(hits[2].element == HB_CAST_NONE);
+	assert(hb_raycast_batch(index, rays + 2, 1, HB_COLLISION_RED, hits) == 1);
+	assert(hits[0].element == HB_CAST_PLANE && fabs(hits[0].distance - 350) < 1e-9);
+	/* a circle meets the wall sooner and the vertex a ray goes by */
+	assert(hb_circle_cast_batch(index, rays, 3, 10, HB_COLLISION_BALL, hits) == 2);
+	assert(fabs(hits[0].distance - 40) < 1e-9);
+	assert(hits[2].element == HB_CAST_VERTEX && hits[2].index == 2);
+	hb_cast_index_free(index);
+	/* a batch finds what trying every wall finds */
+	assert(NULL != (s = _test_load("stadiums/fish_hunt.json")));
+	assert(NULL != (index = hb_cast_index_build(s, 40)));
+	hb_stadium_free(s);
+	for (i = 0, seed = 11, found = 0; i < 300; ++i) {
+		for (j = 0; j < 37; ++j) {
+			rays[j].x = _test_random(&seed, -850, 850);
+			rays[j].y = _test_random(&seed, -450, 450);
+			rays[j].dx = _test_random(&seed, -300, 300);
+			rays[j].dy = _test_random(&seed, -300, 300);
+		}
+		r = i % 3 ? i % 20 : 0;
+		count = hb_circle_cast_batch(index, rays, 37, r, HB_COLLISION_BALL, hits);
+		for (j = 0; j < 37; ++j) {
+			one = _test_cast(index->geometry, &rays[j], r, HB_COLLISION_BALL);
+			assert(hits[j].element == one.element);
+			assert(fabs(hits[j].t - one.t) < 1e-9);
+			assert(one.element == HB_CAST_NONE || hits[j].index == one.index);
+			found += hits[j].element != HB_CAST_NONE;
+			count -= hits[j].element != HB_CAST_NONE;
+		}
+		assert(count == 0);
+	}
+	assert(found > 0);
+	hb_cast_index_free(index);
+}
+
 int
 main(void)
 {
@@ -39,5 +1456,37 @@ main(void)
 	test_invalid_json();
 	test_name_missing();
 	test_name();
+	test_number_round_trip();
+	test_compact_round_trip("stadiums/futsal.json", HB_STADIUM_JSON_COMPACT);
+	test_compact_round_trip("stadiums/chairs.json", HB_STADIUM_JSON_COMPACT);
+	test_compact_round_trip("stadiums/fish_hunt.json", HB_STADIUM_JSON_COMPACT);
+	test_compact_round_trip("stadiums/empty.json", HB_STADIUM_JSON_COMPACT);
+	test_compact_round_trip("stadiums/futsal.json", HB_STADIUM_JSON_TRAITS);
+	test_compact_round_trip("stadiums/chairs.json", HB_STADIUM_JSON_TRAITS);
+	test_compact_round_trip("stadiums/fish_hunt.json", HB_STADIUM_JSON_TRAITS);
+	test_shared("stadiums/futsal.json");
+	test_shared("stadiums/fish_hunt.json");
+	test_hash("stadiums/futsal.json");
+	test_hash("stadiums/big.json");
+	test_cache();
+	test_registry();
+	test_diff();
+	test_clone();
+	test_builder();
+	test_set_trait_field();
+	test_compile();
+	test_optimize();
+	test_transform();
+	test_tessellate();
+	test_world();
+	test_static_grid();
+	test_sweep();
+	test_collision_table();
+	test_narrowphase();
+	test_ccd();
+	test_joints();
+	test_predict();
+	test_sdf();
+	test_cast();
 	return 0;
 }